@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+// Creates instances of a class with the given number of methods, which
+// shouldn't change the cost of creating them
+static void BM_ClassInstantiation(benchmark::State &state) {
+  std::string methods;
+  for (int i = 0; i < state.range(0); i++) {
+    methods += "m" + std::to_string(i) + "() { return " + std::to_string(i) +
+               "; }\n";
+  }
+  std::string code = "class A {\n" + methods + R"(}
+    for (var i = 0; i < 1000; i = i + 1) {
+      var a = A();
+    };
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+
+  for (auto _ : state) {
+    // The tree walker moves method bodies out of the AST, so parse each time
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_ClassInstantiation)->ArgName("methods")->Arg(1)->Arg(20);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
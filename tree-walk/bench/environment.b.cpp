@@ -0,0 +1,170 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+namespace {
+constexpr int k_varsPerScope = 8;
+
+// Builds a chain of scopes, each holding a few variables, with the variable
+// being looked up in the outermost scope.
+std::shared_ptr<Environment> makeChain(int depth, bool useSlots) {
+  auto env = Environment::create(nullptr, k_varsPerScope);
+  for (int d = 0; d <= depth; d++) {
+    if (d > 0) {
+      env = Environment::create(env, k_varsPerScope);
+    }
+    for (int i = 0; i < k_varsPerScope; i++) {
+      if (useSlots) {
+        env->defineAt(i, double(i));
+      } else {
+        env->define("var" + std::to_string(d) + "_" + std::to_string(i),
+                    double(i));
+      }
+    }
+  }
+  return env;
+}
+} // namespace
+
+static void BM_EnvironmentGetByName(benchmark::State &state) {
+  int depth = state.range(0);
+  auto env = makeChain(depth, false);
+  Symbol name("var0_3");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(env->get(name));
+  }
+}
+BENCHMARK(BM_EnvironmentGetByName)->Arg(0)->Arg(4)->Arg(16);
+
+static void BM_EnvironmentGetAt(benchmark::State &state) {
+  int depth = state.range(0);
+  auto env = makeChain(depth, true);
+  VarLocation loc{depth, 3};
+  Symbol name("var0_3");
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(env->getAt(loc, name));
+  }
+}
+BENCHMARK(BM_EnvironmentGetAt)->Arg(0)->Arg(4)->Arg(16);
+
+// Reads a field from an instance sized Environment, with and without a
+// property cache
+static void BM_EnvironmentGetProperty(benchmark::State &state) {
+  bool useCache = state.range(0);
+  auto env = Environment::create();
+  for (int i = 0; i < k_varsPerScope; i++) {
+    env->define("field" + std::to_string(i), double(i));
+  }
+  Symbol name("field3");
+  PropertyCache cache;
+  for (auto _ : state) {
+    if (useCache) {
+      benchmark::DoNotOptimize(env->getProperty(name, cache));
+    } else {
+      benchmark::DoNotOptimize(env->get(name));
+    }
+  }
+}
+BENCHMARK(BM_EnvironmentGetProperty)->ArgName("cached")->Arg(0)->Arg(1);
+
+// Runs a loop heavy script with and without the resolver pass
+static void BM_InterpretLoop(benchmark::State &state) {
+  bool useResolver = state.range(0);
+  std::string code = R"(
+    {
+      var sum = 0;
+      var step = 1;
+      for (var i = 0; i < 1000; i = i + step) {
+        sum = sum + i;
+      };
+    }
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+  if (useResolver) {
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+  }
+
+  for (auto _ : state) {
+    auto env = Environment::create();
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+}
+BENCHMARK(BM_InterpretLoop)->ArgName("resolved")->Arg(0)->Arg(1);
+
+// Reads a global through a chain of resolved scopes, by name and through a
+// global cache
+static void BM_EnvironmentGetGlobal(benchmark::State &state) {
+  int depth = state.range(0);
+  bool useCache = state.range(1);
+  auto globals = Environment::create();
+  for (int i = 0; i < 100; i++) {
+    globals->define("global" + std::to_string(i), double(i));
+  }
+  auto env = globals;
+  for (int d = 0; d < depth; d++) {
+    env = Environment::create(env, k_varsPerScope);
+  }
+  Symbol name("global50");
+  GlobalCache cache;
+  for (auto _ : state) {
+    if (useCache) {
+      benchmark::DoNotOptimize(env->getGlobal(name, *globals, cache));
+    } else {
+      benchmark::DoNotOptimize(env->get(name));
+    }
+  }
+}
+BENCHMARK(BM_EnvironmentGetGlobal)
+    ->ArgNames({"depth", "cached"})
+    ->ArgsProduct({{0, 4, 16}, {0, 1}});
+
+// Reads a global declared before many functions, as in a file defining a
+// module's worth of top level functions
+static void BM_InterpretAfterDeclarations(benchmark::State &state) {
+  std::string code = "var first = 1;\n";
+  for (int i = 0; i < state.range(0); i++) {
+    code += "fun f" + std::to_string(i) + "() { return first; }\n";
+  }
+  code += R"(
+    var sum = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+      sum = sum + first;
+    };
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+  std::vector<ResolveException> resolveErrs;
+  resolve(stmts, resolveErrs);
+
+  for (auto _ : state) {
+    auto env = Environment::create();
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+}
+BENCHMARK(BM_InterpretAfterDeclarations)
+    ->ArgName("functions")
+    ->Arg(0)
+    ->Arg(100)
+    ->Arg(1000);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
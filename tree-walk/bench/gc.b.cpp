@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <gc.h>
+#include <interpreter.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+// Creates instances that reference themselves, which only the collector can
+// free, while the given number of instances stay live
+static void BM_CollectCycles(benchmark::State &state) {
+  std::string code = "var live = " + std::to_string(state.range(0)) + ";" +
+                     R"(
+    var keep = nul;
+    class Node { init(next) { this.next = next; this.self = this; } }
+    for (var i = 0; i < live; i = i + 1) {
+      keep = Node(keep);
+    };
+    for (var j = 0; j < 10000; j = j + 1) {
+      var n = Node(nul);
+    };
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  gc::Stats before = gc::stats();
+
+  for (auto _ : state) {
+    // The tree walker moves method bodies out of the AST, so parse each time
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+
+  const gc::Stats &after = gc::stats();
+  int numCollections = after.numCollections - before.numCollections;
+  auto pause = after.totalPause - before.totalPause;
+  state.counters["collections"] = benchmark::Counter(
+      numCollections, benchmark::Counter::kAvgIterations);
+  state.counters["pause_us"] =
+      std::chrono::duration<double, std::micro>(pause).count() /
+      std::max(numCollections, 1);
+  state.SetItemsProcessed(state.iterations() * 10000);
+}
+BENCHMARK(BM_CollectCycles)
+    ->ArgName("live")
+    ->Arg(0)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,149 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+// Recurses to the given depth, returning at every level on the way back up
+static void BM_DeepRecursion(benchmark::State &state) {
+  std::string code = R"(
+    fun depth(n) {
+      if (n == 0) return 0;;
+      return depth(n - 1) + 1;
+    }
+    var result = depth()" + std::to_string(state.range(0)) +
+                     R"();
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+
+  for (auto _ : state) {
+    // The tree walker moves function bodies out of the AST, so parse each time
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DeepRecursion)->Arg(100)->Arg(1000);
+
+// Loops by returning a call to itself, which runs in the frame it replaces
+static void BM_TailRecursion(benchmark::State &state) {
+  std::string code = R"(
+    fun loop(n, total) {
+      if (n == 0) return total;;
+      return loop(n - 1, total + n);
+    }
+    var result = loop()" + std::to_string(state.range(0)) +
+                     R"(, 0);
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TailRecursion)->Arg(1000)->Arg(100000);
+
+// Creates callbacks that each capture one variable from a scope full of them,
+// then calls them
+static void BM_Closures(benchmark::State &state) {
+  std::string code = R"(
+    fun makeAdder(n) {
+      var a = 1; var b = 2; var c = 3; var d = 4;
+      fun add(x) { return x + n; }
+      return add;
+    }
+    var total = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+      var adder = makeAdder(i);
+      total = adder(total);
+    };
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_Closures);
+
+// Reads and writes fields on instances of two classes, so each property access
+// sees one of two shapes
+static void BM_PropertyAccess(benchmark::State &state) {
+  std::string code = R"(
+    class Point {
+      init(x, y) { this.x = x; this.y = y; }
+    }
+    class Particle {
+      init(x, y) { this.mass = 1; this.x = x; this.y = y; }
+    }
+    var a = Point(0, 0);
+    var b = Particle(1, 1);
+    for (var i = 0; i < 1000; i = i + 1) {
+      a.x = a.x + b.y;
+      b.y = b.x + a.y;
+      var tmp = a;
+      a = b;
+      b = tmp;
+    };
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+  state.SetItemsProcessed(state.iterations() * 1000 * 6);
+}
+BENCHMARK(BM_PropertyAccess);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+
+#include <operators.h>
+#include <value.h>
+
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+// Sums and compares numbers through the inline fast path, or through the
+// visitors every type goes through
+static void BM_NumberArithmetic(benchmark::State &state) {
+  bool fastPath = state.range(0);
+  std::vector<Value> values;
+  for (int i = 0; i < 1024; i++) {
+    values.push_back(i * 0.5);
+  }
+
+  for (auto _ : state) {
+    Value total = 0.0;
+    for (const Value &v : values) {
+      Value product = fastPath ? operators::multiply(v, v)
+                               : operators::generic::multiply(v, v);
+      total = fastPath ? operators::add(total, product)
+                       : operators::generic::add(total, product);
+      bool less = fastPath ? total < v : valueutils::less(total, v);
+      benchmark::DoNotOptimize(less);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_NumberArithmetic)->ArgName("fast")->Arg(0)->Arg(1);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <optimiser.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+
+#include <list>
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+// Runs a loop full of constant expressions with and without the optimiser
+static void BM_InterpretConstantLoop(benchmark::State &state) {
+  bool useOptimiser = state.range(0);
+  std::string code = R"(
+    {
+      var total = 0;
+      for (var i = 0; i < 1000; i = i + 1) {
+        total = total + 60 * 60 * 1000;
+        if (true) total = total - (2 * 3 + 4); else total = 0;;
+      };
+    }
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+  std::list<std::string> constants;
+  if (useOptimiser) {
+    optimise(stmts, constants);
+  }
+  std::vector<ResolveException> resolveErrs;
+  resolve(stmts, resolveErrs);
+
+  for (auto _ : state) {
+    auto env = Environment::create();
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+}
+BENCHMARK(BM_InterpretConstantLoop)->ArgName("optimised")->Arg(0)->Arg(1);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+
+#include <scanner.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+namespace {
+// A generated script of many small classes and functions, with the long
+// names, indentation and strings generated code tends to have
+std::string generatedScript(int numBytes) {
+  std::ostringstream ss;
+  for (int i = 0; ss.tellp() < numBytes; i++) {
+    ss << "class GeneratedRecord" << i << " {\n"
+       << "    init(firstField, secondField) {\n"
+       << "        this.firstField = firstField;\n"
+       << "        this.secondField = secondField;\n"
+       << "        this.description = \"A record generated from the schema, "
+          "number "
+       << i << "\";\n"
+       << "    }\n"
+       << "    total() { return this.firstField + this.secondField * "
+       << i << "; }\n"
+       << "}\n"
+       << "fun checkGeneratedRecord" << i << "(record) {\n"
+       << "    if (record.total() >= 1000) return \"large\";;\n"
+       << "    return \"small\";\n"
+       << "}\n\n";
+  }
+  return ss.str();
+}
+} // namespace
+
+// Scans a script of the given size, reporting the bytes scanned per second
+static void BM_ScanGenerated(benchmark::State &state) {
+  std::string code = generatedScript(state.range(0));
+  for (auto _ : state) {
+    std::vector<SyntaxException> errs;
+    auto tokens = scanTokens(code, errs);
+    benchmark::DoNotOptimize(tokens.data());
+  }
+  state.SetBytesProcessed(state.iterations() * code.size());
+}
+BENCHMARK(BM_ScanGenerated)->Arg(64 * 1024)->Arg(4 * 1024 * 1024);
+
+// Scans statements that are nearly all keywords and short identifiers, some
+// sharing a keyword's length and first or last char
+static void BM_ScanIdentifiers(benchmark::State &state) {
+  std::ostringstream ss;
+  for (int i = 0; ss.tellp() < 64 * 1024; i++) {
+    ss << "var fin = this and that or thus; if (fun) while (wile) "
+          "return print super.sup; class Clash < nul { for (tree) true "
+          "false else elsewhere; }\n";
+  }
+  std::string code = ss.str();
+  for (auto _ : state) {
+    std::vector<SyntaxException> errs;
+    auto tokens = scanTokens(code, errs);
+    benchmark::DoNotOptimize(tokens.data());
+  }
+  state.SetBytesProcessed(state.iterations() * code.size());
+}
+BENCHMARK(BM_ScanIdentifiers);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,136 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+#include <value.h>
+
+#include <string>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+// Copies a vector of string Values, as happens whenever a Value is read from or
+// stored into an Environment
+static void BM_CopyStringValues(benchmark::State &state) {
+  std::vector<Value> values(1024, Value(std::string("a string value")));
+  for (auto _ : state) {
+    std::vector<Value> copy = values;
+    benchmark::DoNotOptimize(copy.data());
+  }
+}
+BENCHMARK(BM_CopyStringValues);
+
+// Creates many instances and reads and writes their fields
+static void BM_InterpretInstances(benchmark::State &state) {
+  std::string code = R"(
+    class Point {
+      init(x, y) { this.x = x; this.y = y; }
+      sum() { return x + y; }
+    }
+    var total = 0;
+    for (var i = 0; i < 1000; i = i + 1) {
+      var p = Point(i, "y");
+      p.y = i;
+      total = total + p.sum();
+    };
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+
+  for (auto _ : state) {
+    // The tree walker moves method bodies out of the AST, so parse each time
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+}
+BENCHMARK(BM_InterpretInstances)->Unit(benchmark::kMillisecond);
+
+// Passes a string of the given size to a function and stores what it returns,
+// which takes the same time whatever the size as copies share the string
+static void BM_PassString(benchmark::State &state) {
+  std::string code = R"(
+    fun identity(s) { return s; }
+    var kept = nul;
+    for (var i = 0; i < 1000; i = i + 1) {
+      kept = identity(str);
+    };
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  Value str = std::string(state.range(0), 'a');
+
+  for (auto _ : state) {
+    // The tree walker moves function bodies out of the AST, so parse each time
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    env->define("str", str);
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+    if (!errs.empty()) {
+      state.SkipWithError(errs.front().what());
+      break;
+    }
+  }
+}
+BENCHMARK(BM_PassString)->ArgName("bytes")->Arg(16)->Arg(1 << 20);
+
+// Builds a string of the given number of megabytes a line at a time, as a
+// script writing a report does, then reads it once by comparing it
+static void BM_BuildString(benchmark::State &state) {
+  int numLines = state.range(0) * 1024 * 1024 / 64;
+  std::string code = "var numLines = " + std::to_string(numLines) + ";" +
+                     R"(
+    var line = "The quick brown fox jumps over " +
+               "the lazy dog, 0123456789 times!!!";
+    var report = "";
+    for (var i = 0; i < numLines; i = i + 1) {
+      report = report + line;
+    };
+    var isLine = report == line;
+  )";
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+  std::vector<ResolveException> resolveErrs;
+  resolve(stmts, resolveErrs);
+
+  for (auto _ : state) {
+    std::vector<InterpretException> errs;
+    auto env = Environment::create();
+    interpret(stmts, env, errs);
+    if (!errs.empty()) {
+      state.SkipWithError(errs.front().what());
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * numLines * 64);
+}
+BENCHMARK(BM_BuildString)
+    ->ArgName("MB")
+    ->Arg(1)
+    ->Arg(10)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
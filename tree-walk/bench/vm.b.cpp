@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+#include <vm.h>
+
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+namespace {
+const std::string k_fibCode = R"(
+  fun fib(n) {
+    if (n < 2) return n;;
+    return fib(n - 1) + fib(n - 2);
+  }
+  var result = fib(20);
+)";
+
+std::vector<stmt::Stmt> parseCode(const std::string &code) {
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+  std::vector<ResolveException> resolveErrs;
+  resolve(stmts, resolveErrs);
+  return stmts;
+}
+} // namespace
+
+// Compares the engines on a call heavy script
+static void BM_FibTreeWalk(benchmark::State &state) {
+  for (auto _ : state) {
+    // The tree walker moves function bodies out of the AST, so parse each time
+    state.PauseTiming();
+    auto stmts = parseCode(k_fibCode);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    interpret(stmts, env, errs);
+  }
+}
+BENCHMARK(BM_FibTreeWalk)->Unit(benchmark::kMillisecond);
+
+static void BM_FibVM(benchmark::State &state) {
+  auto stmts = parseCode(k_fibCode);
+  for (auto _ : state) {
+    vm::VM vm;
+    std::vector<InterpretException> errs;
+    vm::interpret(stmts, vm, errs);
+  }
+}
+BENCHMARK(BM_FibVM)->Unit(benchmark::kMillisecond);
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,374 @@
+#include <benchmark/benchmark.h>
+
+#include <allocations.h>
+#include <closure_compiler.h>
+#include <environment.h>
+#include <interpreter.h>
+#include <optimiser.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+#include <stack_evaluator.h>
+
+#include <list>
+#include <sstream>
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace bench {
+
+// Standard Lox workloads, each timed through scanning, parsing and
+// interpreting. The scripts are sized to run in milliseconds on the tree
+// walker. Subclasses reach their superclass's methods through 'super', as
+// methods aren't inherited in this dialect.
+
+namespace {
+const std::string k_fib = R"(
+  fun fib(n) {
+    if (n < 2) return n;;
+    return fib(n - 1) + fib(n - 2);
+  }
+  var result = fib(20);
+)";
+
+const std::string k_binaryTrees = R"(
+  class Tree {
+    init(item, depth) {
+      this.item = item;
+      this.left = nul;
+      this.right = nul;
+      if (depth > 0) {
+        var item2 = item + item;
+        this.left = Tree(item2 - 1, depth - 1);
+        this.right = Tree(item2, depth - 1);
+      };
+    }
+    check() {
+      if (this.left == nul) {
+        return this.item;
+      };
+      return this.item + this.left.check() - this.right.check();
+    }
+  }
+  var minDepth = 4;
+  var maxDepth = 6;
+  var stretch = Tree(0, maxDepth + 1).check();
+  var longLived = Tree(0, maxDepth);
+  var iterations = 64;
+  var total = 0;
+  for (var depth = minDepth; depth <= maxDepth; depth = depth + 2) {
+    for (var i = 1; i <= iterations; i = i + 1) {
+      total = total + Tree(i, depth).check() + Tree(-i, depth).check();
+    };
+    iterations = iterations / 4;
+  };
+  var result = longLived.check();
+)";
+
+const std::string k_methodCall = R"(
+  class Toggle {
+    init(startState) {
+      this.state = startState;
+    }
+    value() { return this.state; }
+    activate() {
+      this.state = !this.state;
+      return this;
+    }
+  }
+  class NthToggle < Toggle {
+    init(startState, maxCounter) {
+      super.init(startState);
+      this.countMax = maxCounter;
+      this.count = 0;
+    }
+    value() { return super.value(); }
+    activate() {
+      this.count = this.count + 1;
+      if (this.count >= this.countMax) {
+        super.activate();
+        this.count = 0;
+      };
+      return this;
+    }
+  }
+  var val = true;
+  var toggle = Toggle(val);
+  for (var i = 0; i < 2000; i = i + 1) {
+    val = toggle.activate().value();
+    val = toggle.activate().value();
+    val = toggle.activate().value();
+    val = toggle.activate().value();
+    val = toggle.activate().value();
+  };
+  val = true;
+  var ntoggle = NthToggle(val, 3);
+  for (var j = 0; j < 2000; j = j + 1) {
+    val = ntoggle.activate().value();
+    val = ntoggle.activate().value();
+    val = ntoggle.activate().value();
+    val = ntoggle.activate().value();
+    val = ntoggle.activate().value();
+  };
+)";
+
+const std::string k_instantiation = R"(
+  class Foo {
+    init() {}
+  }
+  for (var i = 0; i < 5000; i = i + 1) {
+    Foo();
+    Foo();
+    Foo();
+    Foo();
+    Foo();
+  };
+)";
+
+const std::string k_stringEquality = R"(
+  var a = "abcdefghijklmnop";
+  var b = "abcdefgh" + "ijklmnop";
+  var c = "abcdefghijklmnoq";
+  var d = "q";
+  var count = 0;
+  for (var i = 0; i < 10000; i = i + 1) {
+    if (a == b) {
+      count = count + 1;
+    };
+    if (a == c) {
+      count = count + 1;
+    };
+    if (a != d) {
+      count = count + 1;
+    };
+    if (a == i) {
+      count = count + 1;
+    };
+  };
+)";
+
+const std::string k_zoo = R"(
+  class Zoo {
+    init() {
+      this.aardvark = 1;
+      this.baboon = 1;
+      this.cat = 1;
+      this.donkey = 1;
+      this.elephant = 1;
+      this.fox = 1;
+    }
+    ant() { return this.aardvark; }
+    banana() { return this.baboon; }
+    tuna() { return this.cat; }
+    hay() { return this.donkey; }
+    grass() { return this.elephant; }
+    mouse() { return this.fox; }
+  }
+  var zoo = Zoo();
+  var sum = 0;
+  while (sum < 30000) {
+    sum = sum + zoo.ant() + zoo.banana() + zoo.tuna() + zoo.hay() +
+          zoo.grass() + zoo.mouse();
+  };
+)";
+
+const std::string k_closures = R"(
+  fun makeCounter() {
+    var count = 0;
+    fun increment() {
+      count = count + 1;
+      return count;
+    }
+    return increment;
+  }
+  var total = 0;
+  for (var i = 0; i < 2000; i = i + 1) {
+    var counter = makeCounter();
+    counter();
+    counter();
+    total = total + counter();
+  };
+)";
+
+// A numeric kernel: stepping a damped spring, then pricing a compounding
+// cash flow, with no calls or objects in the loops
+const std::string k_arithmetic = R"(
+  var x = 1;
+  var v = 0;
+  var dt = 1 / 100;
+  for (var step = 0; step < 5000; step = step + 1) {
+    var a = -4 * x - v / 10;
+    v = v + a * dt;
+    x = x + v * dt;
+    if (x > 10) x = 10;;
+  };
+  var price = 0;
+  var discount = 1;
+  var rate = 10001 / 10000;
+  for (var year = 1; year <= 5000; year = year + 1) {
+    discount = discount / rate;
+    if (year >= 2500) price = price + 5 * discount;;
+  };
+)";
+
+// A chain of subclasses, each initialising and overriding through 'super'
+std::string deepInheritance(int depth) {
+  std::ostringstream ss;
+  ss << "class A0 {\n"
+     << "  init() { this.depth = 0; }\n"
+     << "  root() { return this.depth; }\n"
+     << "}\n";
+  for (int i = 1; i < depth; i++) {
+    ss << "class A" << i << " < A" << i - 1 << " {\n"
+       << "  init() { super.init(); this.depth = " << i << "; }\n"
+       << "  root() { return super.root() + 1; }\n"
+       << "}\n";
+  }
+  ss << "var total = 0;\n"
+     << "for (var i = 0; i < 1000; i = i + 1) {\n"
+     << "  total = total + A" << depth - 1 << "().root();\n"
+     << "};\n";
+  return ss.str();
+}
+const std::string k_deepInheritance = deepInheritance(10);
+} // namespace
+
+static void BM_Scan(benchmark::State &state, const std::string &code) {
+  for (auto _ : state) {
+    std::vector<SyntaxException> syntErrs;
+    auto tokens = scanTokens(code, syntErrs);
+    benchmark::DoNotOptimize(tokens.data());
+  }
+  state.SetBytesProcessed(state.iterations() * code.size());
+}
+
+static void BM_Parse(benchmark::State &state, const std::string &code) {
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  for (auto _ : state) {
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    benchmark::DoNotOptimize(stmts.data());
+  }
+  state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+// Optimises and resolves the script as the CLI does, then times running it.
+// The heap allocations made while running are counted too.
+static void BM_Interpret(benchmark::State &state, const std::string &code) {
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::list<std::string> constants;
+  long allocs = 0;
+
+  for (auto _ : state) {
+    // The tree walker moves function bodies out of the AST, so parse each time
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    optimise(stmts, constants);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    long before = testutil::numAllocations();
+    interpret(stmts, env, errs);
+    allocs += testutil::numAllocations() - before;
+    if (!errs.empty()) {
+      state.SkipWithError(errs.front().what());
+      break;
+    }
+  }
+  state.counters["allocs"] =
+      benchmark::Counter(allocs, benchmark::Counter::kAvgIterations);
+}
+
+// As above, but running the tree from the stack engine's explicit stack
+static void BM_InterpretStack(benchmark::State &state,
+                              const std::string &code) {
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::list<std::string> constants;
+  long allocs = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<ParseException> parsErrs;
+    auto stmts = parse(tokens, parsErrs);
+    optimise(stmts, constants);
+    std::vector<ResolveException> resolveErrs;
+    resolve(stmts, resolveErrs);
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    long before = testutil::numAllocations();
+    stack::interpret(stmts, env, errs);
+    allocs += testutil::numAllocations() - before;
+    if (!errs.empty()) {
+      state.SkipWithError(errs.front().what());
+      break;
+    }
+  }
+  state.counters["allocs"] =
+      benchmark::Counter(allocs, benchmark::Counter::kAvgIterations);
+}
+
+// As above, but compiling to closures and running them. The compile is timed.
+static void BM_InterpretClosures(benchmark::State &state,
+                                 const std::string &code) {
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::list<std::string> constants;
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+  optimise(stmts, constants);
+  std::vector<ResolveException> resolveErrs;
+  resolve(stmts, resolveErrs);
+  long allocs = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto env = Environment::create();
+    state.ResumeTiming();
+
+    std::vector<InterpretException> errs;
+    long before = testutil::numAllocations();
+    closure::interpret(stmts, env, errs);
+    allocs += testutil::numAllocations() - before;
+    if (!errs.empty()) {
+      state.SkipWithError(errs.front().what());
+      break;
+    }
+  }
+  state.counters["allocs"] =
+      benchmark::Counter(allocs, benchmark::Counter::kAvgIterations);
+}
+
+#define WORKLOAD(name, code)                                                  \
+  BENCHMARK_CAPTURE(BM_Scan, name, code);                                     \
+  BENCHMARK_CAPTURE(BM_Parse, name, code);                                    \
+  BENCHMARK_CAPTURE(BM_Interpret, name, code)->Unit(benchmark::kMillisecond); \
+  BENCHMARK_CAPTURE(BM_InterpretStack, name, code)                            \
+      ->Unit(benchmark::kMillisecond);                                        \
+  BENCHMARK_CAPTURE(BM_InterpretClosures, name, code)                         \
+      ->Unit(benchmark::kMillisecond)
+
+WORKLOAD(fib, k_fib);
+WORKLOAD(arithmetic, k_arithmetic);
+WORKLOAD(binary_trees, k_binaryTrees);
+WORKLOAD(method_call, k_methodCall);
+WORKLOAD(instantiation, k_instantiation);
+WORKLOAD(string_equality, k_stringEquality);
+WORKLOAD(zoo, k_zoo);
+WORKLOAD(closures, k_closures);
+WORKLOAD(deep_inheritance, k_deepInheritance);
+
+#undef WORKLOAD
+
+} // namespace bench
+} // namespace treewalk
+} // namespace plox
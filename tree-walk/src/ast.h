@@ -3,14 +3,24 @@
 #ifndef PLOX_AUTO_GENERATED_AST
 #define PLOX_AUTO_GENERATED_AST
 
+#include <location.h>
+
 #include <memory>
 
+#include <optional>
+
 #include <string>
 
 #include <variant>
 
 #include <scanner.h>
 
+#include <shape.h>
+
+#include <symbol.h>
+
+#include <value.h>
+
 namespace plox {
 namespace treewalk {
 namespace ast {
@@ -37,8 +47,10 @@ using Expr = std::variant<Assign, Binary, Call, Get, Grouping, Literal, Set,
                           Unary, Variable>;
 
 struct Assign {
-  std::string_view name;
+  Symbol name;
   std::unique_ptr<Expr> value;
+  std::optional<VarLocation> loc;
+  GlobalCache cache;
 };
 
 struct Binary {
@@ -50,11 +62,13 @@ struct Binary {
 struct Call {
   std::unique_ptr<Expr> callee;
   std::vector<std::unique_ptr<Expr>> args;
+  int line;
 };
 
 struct Get {
   std::unique_ptr<Expr> object;
-  std::string_view property;
+  Symbol property;
+  PropertyCache cache;
 };
 
 struct Grouping {
@@ -64,12 +78,14 @@ struct Grouping {
 struct Literal {
   std::string_view value;
   TokenType type;
+  std::optional<Value> constant;
 };
 
 struct Set {
   std::unique_ptr<Expr> object;
-  std::string_view property;
+  Symbol property;
   std::unique_ptr<Expr> value;
+  PropertyCache cache;
 };
 
 struct Unary {
@@ -78,7 +94,9 @@ struct Unary {
 };
 
 struct Variable {
-  std::string_view name;
+  Symbol name;
+  std::optional<VarLocation> loc;
+  GlobalCache cache;
 };
 
 } // namespace ast
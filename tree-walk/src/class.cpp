@@ -5,7 +5,7 @@ namespace treewalk {
 
 ClassDefinition::ClassDefinition(std::string_view name,
                                  std::shared_ptr<Environment> closure,
-                                 std::shared_ptr<ClassDefinition> super)
+                                 ClsDefShrdPtr super)
     : d_name(name), d_closure(closure), d_super(super){};
 
 std::string_view ClassDefinition::getName() const { return d_name; }
@@ -14,10 +14,20 @@ std::shared_ptr<Environment> &ClassDefinition::getClosure() {
   return d_closure;
 };
 
-std::shared_ptr<ClassDefinition> ClassDefinition::getSuper() {
+ClsDefShrdPtr ClassDefinition::getSuper() {
   return d_super;
 };
 
+void ClassDefinition::trace(gc::Tracer &tracer) const {
+  tracer.visit(d_closure);
+  tracer.visit(d_super.get());
+}
+
+void ClassDefinition::clearReferences() {
+  d_closure.reset();
+  d_super = {};
+}
+
 std::ostream &operator<<(std::ostream &os, const ClassDefinition &cls) {
   os << "class " << cls.getName();
   return os;
@@ -31,6 +41,12 @@ std::string_view ClassInstance::getName() const { return d_name; };
 
 std::shared_ptr<Environment> &ClassInstance::getClosure() { return d_closure; };
 
+void ClassInstance::trace(gc::Tracer &tracer) const {
+  tracer.visit(d_closure);
+}
+
+void ClassInstance::clearReferences() { d_closure.reset(); }
+
 std::ostream &operator<<(std::ostream &os, const ClassInstance &cls) {
   os << "class instance " << cls.getName();
   return os;
@@ -2,6 +2,8 @@
 #define TREEWALK_CLASS_H
 
 #include <environment.h>
+#include <gc.h>
+#include <value.h>
 
 #include <map>
 #include <string_view>
@@ -9,28 +11,34 @@
 namespace plox {
 namespace treewalk {
 
-class ClassDefinition {
+class ClassDefinition : public gc::TracedObject {
 public:
   ClassDefinition(std::string_view name, std::shared_ptr<Environment> closure,
-                  std::shared_ptr<ClassDefinition> d_super);
+                  ClsDefShrdPtr super);
 
   std::string_view getName() const;
   std::shared_ptr<Environment> &getClosure();
-  std::shared_ptr<ClassDefinition> getSuper();
+  ClsDefShrdPtr getSuper();
+
+  void trace(gc::Tracer &tracer) const override;
+  void clearReferences() override;
 
 private:
   std::string_view d_name;
   std::shared_ptr<Environment> d_closure;
-  std::shared_ptr<ClassDefinition> d_super;
+  ClsDefShrdPtr d_super;
 };
 
-class ClassInstance {
+class ClassInstance : public gc::TracedObject {
 public:
   ClassInstance(std::string_view name, std::shared_ptr<Environment> closure);
 
   std::string_view getName() const;
   std::shared_ptr<Environment> &getClosure();
 
+  void trace(gc::Tracer &tracer) const override;
+  void clearReferences() override;
+
 private:
   std::string_view d_name;
   std::shared_ptr<Environment> d_closure;
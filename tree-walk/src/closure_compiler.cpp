@@ -0,0 +1,510 @@
+#include <closure_compiler.h>
+
+#include <class.h>
+#include <func.h>
+#include <gc.h>
+#include <operators.h>
+#include <value_printer.h>
+
+#include <iostream>
+
+namespace plox {
+namespace treewalk {
+namespace closure {
+
+void interpret(const std::vector<stmt::Stmt> &stmts,
+               std::shared_ptr<Environment> &env,
+               std::vector<InterpretException> &errs, Profiler *profiler) {
+  try {
+    std::vector<StmtFn> script = compile(stmts);
+    InterpreterVisitor interp{env, profiler};
+    for (const StmtFn &s : script) {
+      // A return in the top level script stops the script
+      if (s(interp) == Completion::RETURN) {
+        break;
+      }
+    }
+  } catch (const InterpretException &e) {
+    errs.push_back(e);
+  }
+}
+
+std::vector<StmtFn> compile(const std::vector<stmt::Stmt> &stmts) {
+  Compiler compiler;
+  std::vector<StmtFn> script;
+  script.reserve(stmts.size());
+  for (const stmt::Stmt &s : stmts) {
+    script.push_back(std::visit(compiler, s));
+  }
+  return script;
+}
+
+using Interp = InterpreterVisitor;
+
+namespace {
+static ValuePrinter s_valuePrinter;
+
+const Symbol s_init("init");
+
+// Each operator gets its own closure type, so the operation is inlined into
+// the closure that evaluates the operands
+template <typename Op> ExprFn binary(ExprFn left, ExprFn right, Op op) {
+  return [left = std::move(left), right = std::move(right),
+          op](Interp &interp) -> Value {
+    Value l = left(interp);
+    Value r = right(interp);
+    return op(l, r);
+  };
+}
+} // namespace
+
+StmtFn Compiler::operator()(const stmt::Block &blk) {
+  return [stmts = compileStmts(blk.stmts),
+          numSlots = blk.numSlots](Interp &interp) {
+    std::shared_ptr<Environment> newEnv =
+        Environment::create(interp.d_env, numSlots);
+    environmentutils::ScopedSwap swapGuard(interp.d_env, newEnv);
+    for (const StmtFn &s : stmts) {
+      if (s(interp) == Completion::RETURN) {
+        return Completion::RETURN;
+      }
+    }
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::Class &cls) {
+  ExprFn super;
+  if (cls.super) {
+    super = getVariable(*cls.super, cls.superLoc);
+  }
+  std::vector<CompiledFun> methods;
+  for (auto &m : cls.methods) {
+    methods.push_back(compileFun(std::get<stmt::Fun>(*m)));
+  }
+
+  // The class is declared as the tree walker declares it, see there for why
+  // each environment is used
+  return [name = cls.name, slot = cls.slot, super = std::move(super),
+          methods = std::move(methods)](Interp &interp) {
+    ClsDefShrdPtr superDef;
+    if (super) {
+      Value v = super(interp);
+      if (!v.is<ClsDefShrdPtr>()) {
+        throw InterpretException("Super class for " + std::string(name) +
+                                 "must be a class");
+      }
+      superDef = v.get<ClsDefShrdPtr>();
+    }
+
+    if (!slot) {
+      interp.d_env->define(name);
+    }
+    std::shared_ptr<Environment> clsEnv =
+        Environment::create(slot ? Environment::namedScope(interp.d_env)
+                                 : Environment::snapshot(interp.d_env));
+    auto clsDef = makeRef<ClassDefinition>(name, clsEnv, superDef);
+    if (slot) {
+      interp.d_env->defineAt(*slot, clsDef);
+    } else {
+      interp.d_env->assign(name, clsDef);
+    }
+
+    for (const CompiledFun &m : methods) {
+      auto f = interp.makeFunction(m.name, m.function, m.upvalues,
+                                   interp.d_env, clsEnv);
+      f->setIsInitialiser(m.name == s_init);
+      clsEnv->define(m.name, f);
+    }
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::Expression &expr) {
+  return [expr = std::visit(*this, *expr.expr)](Interp &interp) {
+    expr(interp);
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::For &forStmt) {
+  StmtFn initialiser;
+  if (forStmt.initialiser) {
+    initialiser = std::visit(*this, *forStmt.initialiser);
+  }
+  ExprFn condition;
+  if (forStmt.condition) {
+    condition = std::visit(*this, *forStmt.condition);
+  }
+  ExprFn incrementer;
+  if (forStmt.incrementer) {
+    incrementer = std::visit(*this, *forStmt.incrementer);
+  }
+
+  return [initialiser = std::move(initialiser),
+          condition = std::move(condition),
+          incrementer = std::move(incrementer),
+          body = std::visit(*this, *forStmt.body)](Interp &interp) {
+    if (initialiser) {
+      initialiser(interp);
+    }
+    // A loop without a condition runs forever
+    while (!condition || operators::isTruthy(condition(interp))) {
+      if (body(interp) == Completion::RETURN) {
+        return Completion::RETURN;
+      }
+      if (incrementer) {
+        incrementer(interp);
+      }
+      gc::maybeCollect();
+    }
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::Fun &funStmt) {
+  // Named scopes are snapshotted once the function is declared, as the tree
+  // walker does
+  return [fun = compileFun(funStmt), slot = funStmt.slot](Interp &interp) {
+    if (slot) {
+      auto f = interp.makeFunction(fun.name, fun.function, fun.upvalues,
+                                   interp.d_env,
+                                   Environment::namedScope(interp.d_env));
+      interp.d_env->defineAt(*slot, f);
+      return Completion::NORMAL;
+    }
+    interp.d_env->define(fun.name);
+    interp.d_env->assign(fun.name, interp.makeFunction(
+                                       fun.name, fun.function, fun.upvalues,
+                                       interp.d_env,
+                                       Environment::snapshot(interp.d_env)));
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::If &ifStmt) {
+  StmtFn elseBranch;
+  if (ifStmt.elseBranch) {
+    elseBranch = std::visit(*this, *ifStmt.elseBranch);
+  }
+
+  return [condition = std::visit(*this, *ifStmt.condition),
+          ifBranch = std::visit(*this, *ifStmt.ifBranch),
+          elseBranch = std::move(elseBranch)](Interp &interp) {
+    if (operators::isTruthy(condition(interp))) {
+      return ifBranch(interp);
+    } else if (elseBranch) {
+      return elseBranch(interp);
+    }
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::Print &print) {
+  return [expr = std::visit(*this, *print.expr)](Interp &interp) {
+    Value v = expr(interp);
+    std::cout << visit(s_valuePrinter, v) << std::endl;
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::Return &ret) {
+  // Returning a call leaves the call to the function returning, like the tree
+  // walk interpreter
+  if (ret.expr && std::holds_alternative<ast::Call>(*ret.expr)) {
+    const ast::Call &call = std::get<ast::Call>(*ret.expr);
+    std::vector<ExprFn> args;
+    args.reserve(call.args.size());
+    for (auto &arg : call.args) {
+      args.push_back(std::visit(*this, *arg));
+    }
+
+    return [callee = std::visit(*this, *call.callee), args = std::move(args),
+            line = call.line](Interp &interp) {
+      Value c = callee(interp);
+      if (!interp.canTailCall(c)) {
+        interp.d_returnValue = invokeValue(interp, c, args, line);
+        return Completion::RETURN;
+      }
+
+      const FnDescShrdPtr &fn = c.get<FnDescShrdPtr>();
+      std::shared_ptr<Environment> fEnv = interp.prepareCall(fn, args.size());
+      const Function &function = *fn->getFunction();
+      for (int i = 0; i < args.size(); i++) {
+        InterpreterVisitor::defineArg(*fEnv, function, i, args[i](interp));
+      }
+      interp.d_tailCall = {fn, std::move(fEnv), line};
+      return Completion::RETURN;
+    };
+  }
+
+  ExprFn expr;
+  if (ret.expr) {
+    expr = std::visit(*this, *ret.expr);
+  }
+
+  return [expr = std::move(expr)](Interp &interp) {
+    interp.d_returnValue = expr ? expr(interp) : Value{};
+    return Completion::RETURN;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::VarDecl &varDecl) {
+  ExprFn expr;
+  if (varDecl.expr) {
+    expr = std::visit(*this, *varDecl.expr);
+  }
+
+  return [name = varDecl.name, slot = varDecl.slot,
+          expr = std::move(expr)](Interp &interp) {
+    Value val = expr ? expr(interp) : Value{};
+    if (slot) {
+      interp.d_env->defineAt(*slot, std::move(val));
+    } else {
+      interp.d_env->define(name, std::move(val));
+    }
+    return Completion::NORMAL;
+  };
+}
+
+StmtFn Compiler::operator()(const stmt::While &whileStmt) {
+  return [condition = std::visit(*this, *whileStmt.condition),
+          body = std::visit(*this, *whileStmt.body)](Interp &interp) {
+    while (operators::isTruthy(condition(interp))) {
+      if (body(interp) == Completion::RETURN) {
+        return Completion::RETURN;
+      }
+      gc::maybeCollect();
+    }
+    return Completion::NORMAL;
+  };
+}
+
+ExprFn Compiler::operator()(const ast::Assign &assign) {
+  return assignVariable(assign.name, assign.loc,
+                        std::visit(*this, *assign.value));
+}
+
+ExprFn Compiler::operator()(const ast::Binary &bnry) {
+  ExprFn l = std::visit(*this, *bnry.left);
+  ExprFn r = std::visit(*this, *bnry.right);
+
+  using V = const Value &;
+  switch (bnry.op.type) {
+  case TokenType::PLUS:
+    return binary(std::move(l), std::move(r),
+                  [](V a, V b) { return operators::add(a, b); });
+  case TokenType::MINUS:
+    return binary(std::move(l), std::move(r),
+                  [](V a, V b) { return operators::subtract(a, b); });
+  case TokenType::STAR:
+    return binary(std::move(l), std::move(r),
+                  [](V a, V b) { return operators::multiply(a, b); });
+  case TokenType::SLASH:
+    return binary(std::move(l), std::move(r),
+                  [](V a, V b) { return operators::divide(a, b); });
+  case TokenType::EQUAL_EQUAL:
+    return binary(std::move(l), std::move(r), [](V a, V b) { return a == b; });
+  case TokenType::BANG_EQUAL:
+    return binary(std::move(l), std::move(r), [](V a, V b) { return a != b; });
+  case TokenType::GREATER:
+    return binary(std::move(l), std::move(r), [](V a, V b) { return a > b; });
+  case TokenType::GREATER_EQUAL:
+    return binary(std::move(l), std::move(r), [](V a, V b) { return a >= b; });
+  case TokenType::LESS:
+    return binary(std::move(l), std::move(r), [](V a, V b) { return a < b; });
+  case TokenType::LESS_EQUAL:
+    return binary(std::move(l), std::move(r), [](V a, V b) { return a <= b; });
+  default:
+    throw InterpretException("Unable to interpret binary op: " +
+                             tokenutils::tokenTypeToStr(bnry.op.type));
+  }
+}
+
+ExprFn Compiler::operator()(const ast::Call &call) {
+  std::vector<ExprFn> args;
+  args.reserve(call.args.size());
+  for (auto &arg : call.args) {
+    args.push_back(std::visit(*this, *arg));
+  }
+
+  return [callee = std::visit(*this, *call.callee), args = std::move(args),
+          line = call.line](Interp &interp) -> Value {
+    return invokeValue(interp, callee(interp), args, line);
+  };
+}
+
+ExprFn Compiler::operator()(const ast::Get &get) {
+  return [object = std::visit(*this, *get.object), property = get.property,
+          cache = PropertyCache{}](Interp &interp) mutable {
+    Value obj = object(interp);
+    if (!obj.is<ClsInstShrdPtr>()) {
+      throw InterpretException(
+          "Tried to get a property on non class instance " +
+          visit(s_valuePrinter, obj));
+    }
+    auto clsInst = obj.get<ClsInstShrdPtr>();
+    return clsInst->getClosure()->getProperty(property, cache);
+  };
+}
+
+ExprFn Compiler::operator()(const ast::Grouping &grp) {
+  return std::visit(*this, *grp.expr);
+}
+
+ExprFn Compiler::operator()(const ast::Literal &ltrl) {
+  // Decoded once, using the tree walker for literals the parser didn't decode
+  std::shared_ptr<Environment> noEnv;
+  return [v = InterpreterVisitor(noEnv)(ltrl)](Interp &) { return v; };
+}
+
+ExprFn Compiler::operator()(const ast::Set &set) {
+  return [object = std::visit(*this, *set.object), property = set.property,
+          value = std::visit(*this, *set.value),
+          cache = PropertyCache{}](Interp &interp) mutable -> Value {
+    Value obj = object(interp);
+    if (!obj.is<ClsInstShrdPtr>()) {
+      throw InterpretException(
+          "Tried to set a property on non class instance " +
+          visit(s_valuePrinter, obj));
+    }
+
+    Value val = value(interp);
+    if (val.is<FnDescShrdPtr>()) {
+      FnDescShrdPtr fnCopy =
+          makeRef<FunctionDescription>(*val.get<FnDescShrdPtr>());
+      fnCopy->setName(property);
+      fnCopy->setIsInitialiser(property == s_init);
+      val = fnCopy;
+    }
+    obj.get<ClsInstShrdPtr>()->getClosure()->setProperty(
+        property, std::move(val), cache);
+    return {};
+  };
+}
+
+ExprFn Compiler::operator()(const ast::Unary &unry) {
+  ExprFn right = std::visit(*this, *unry.right);
+  switch (unry.op.type) {
+  case TokenType::MINUS:
+    return [right = std::move(right)](Interp &interp) -> Value {
+      return operators::subtract(0.0, right(interp));
+    };
+  case TokenType::BANG:
+    return [right = std::move(right)](Interp &interp) -> Value {
+      return !operators::isTruthy(right(interp));
+    };
+  default:
+    throw InterpretException("Unable to interpret unary op: " +
+                             tokenutils::tokenTypeToStr(unry.op.type));
+  }
+}
+
+ExprFn Compiler::operator()(const ast::Variable &var) {
+  return getVariable(var.name, var.loc);
+}
+
+Compiler::CompiledFun Compiler::compileFun(const stmt::Fun &funStmt) {
+  auto fn = std::make_shared<Function>(std::vector<Symbol>(funStmt.params),
+                                       compileStmts(funStmt.stmts),
+                                       funStmt.numSlots);
+  return {funStmt.name, std::move(fn), funStmt.upvalues};
+}
+
+std::vector<StmtFn>
+Compiler::compileStmts(const std::vector<std::unique_ptr<stmt::Stmt>> &stmts) {
+  std::vector<StmtFn> compiled;
+  compiled.reserve(stmts.size());
+  for (auto &s : stmts) {
+    compiled.push_back(std::visit(*this, *s));
+  }
+  return compiled;
+}
+
+ExprFn Compiler::getVariable(const Symbol &name,
+                             const std::optional<VarLocation> &loc) {
+  if (!loc) {
+    return [name](Interp &interp) { return interp.d_env->get(name); };
+  } else if (loc->isGlobal) {
+    return [name, cache = GlobalCache{}](Interp &interp) mutable {
+      return interp.d_env->getGlobal(name, *interp.d_globals, cache);
+    };
+  } else if (!loc->isUpvalue) {
+    return [name, loc = *loc](Interp &interp) {
+      return interp.d_env->getAt(loc, name);
+    };
+  } else if (!loc->shadowingScopes) {
+    return [slot = loc->slot](Interp &interp) {
+      return interp.d_function->getUpvalue(slot)->get();
+    };
+  }
+  // Class instances the function is defined in may shadow the upvalue
+  return [name, loc](Interp &interp) { return interp.getVariable(name, loc); };
+}
+
+ExprFn Compiler::assignVariable(const Symbol &name,
+                                const std::optional<VarLocation> &loc,
+                                ExprFn value) {
+  if (!loc) {
+    return [name, value = std::move(value)](Interp &interp) {
+      Value v = value(interp);
+      interp.d_env->assign(name, v);
+      return v;
+    };
+  } else if (loc->isGlobal) {
+    return [name, cache = GlobalCache{},
+            value = std::move(value)](Interp &interp) mutable {
+      Value v = value(interp);
+      interp.d_env->assignGlobal(name, v, *interp.d_globals, cache);
+      return v;
+    };
+  } else if (!loc->isUpvalue) {
+    return [name, loc = *loc, value = std::move(value)](Interp &interp) {
+      Value v = value(interp);
+      interp.d_env->assignAt(loc, name, v);
+      return v;
+    };
+  } else if (!loc->shadowingScopes) {
+    return [slot = loc->slot, value = std::move(value)](Interp &interp) {
+      Value v = value(interp);
+      interp.d_function->getUpvalue(slot)->set(v);
+      return v;
+    };
+  }
+  return [name, loc, value = std::move(value)](Interp &interp) {
+    Value v = value(interp);
+    interp.assignVariable(name, loc, v);
+    return v;
+  };
+}
+
+Value Compiler::invokeValue(Interp &interp, const Value &callee,
+                            const std::vector<ExprFn> &args, int line) {
+  if (callee.is<FnDescShrdPtr>()) {
+    return invoke(interp, callee.get<FnDescShrdPtr>(), args, line);
+  } else if (callee.is<ClsDefShrdPtr>()) {
+    ClsDefShrdPtr clsDef = callee.get<ClsDefShrdPtr>();
+    ClsInstShrdPtr inst = interp.instantiate(clsDef);
+    if (clsDef->getClosure()->isVarInScope(s_init)) {
+      invoke(interp, inst->getClosure()->get(s_init).get<FnDescShrdPtr>(),
+             args, line);
+    }
+    return inst;
+  }
+  throw InterpretException("Tried to call non callable object " +
+                           visit(s_valuePrinter, callee));
+}
+
+Value Compiler::invoke(Interp &interp, const FnDescShrdPtr &fn,
+                       const std::vector<ExprFn> &args, int line) {
+  std::shared_ptr<Environment> fEnv = interp.prepareCall(fn, args.size());
+  const Function &function = *fn->getFunction();
+  for (int i = 0; i < args.size(); i++) {
+    InterpreterVisitor::defineArg(*fEnv, function, i, args[i](interp));
+  }
+  return interp.finishCall(fn, fEnv, line);
+}
+
+} // namespace closure
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,104 @@
+#ifndef TREEWALK_CLOSURE_COMPILER_H
+#define TREEWALK_CLOSURE_COMPILER_H
+
+#include <environment.h>
+#include <errs.h>
+#include <interpreter.h>
+#include <profiler.h>
+#include <stmt.h>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace closure {
+
+// Compiled code runs on the interpreter's state: its Environment, the function
+// being run and the value being returned.
+using ExprFn = std::function<Value(InterpreterVisitor &)>;
+using StmtFn = std::function<Completion(InterpreterVisitor &)>;
+
+// The entrypoint to the closure engine. Compiles the statements from the
+// resolver to closures and runs them.
+void interpret(const std::vector<stmt::Stmt> &stmts,
+               std::shared_ptr<Environment> &env,
+               std::vector<InterpretException> &errs,
+               Profiler *profiler = nullptr);
+
+// Compiles the statements to closures. Throws an InterpretException if the
+// code cannot be compiled.
+std::vector<StmtFn> compile(const std::vector<stmt::Stmt> &stmts);
+
+/*
+ Walks the AST once, turning each node into a closure that runs it.
+
+ The tree walk interpreter works out what to do with a node every time it
+ runs it: which type of node it is, which operator a Binary uses, and where a
+ variable lives. The compiler makes those decisions up front, so each closure
+ holds the closures for its operands and does only its own operation. Literals
+ are decoded into Values, and variables use the slots from the resolver.
+
+ The closures don't refer back to the AST, so functions outlive the statements
+ they were compiled from. Property caches are held in the closures doing the
+ access. Calls, instances and errors go through the tree walk interpreter, so
+ both engines behave the same.
+*/
+class Compiler {
+public:
+  // Statements
+  StmtFn operator()(const stmt::Block &blk);
+  StmtFn operator()(const stmt::Class &cls);
+  StmtFn operator()(const stmt::Expression &expr);
+  StmtFn operator()(const stmt::For &forStmt);
+  StmtFn operator()(const stmt::Fun &funStmt);
+  StmtFn operator()(const stmt::If &ifStmt);
+  StmtFn operator()(const stmt::Print &print);
+  StmtFn operator()(const stmt::Return &ret);
+  StmtFn operator()(const stmt::VarDecl &varDecl);
+  StmtFn operator()(const stmt::While &whileStmt);
+
+  // Expressions
+  ExprFn operator()(const ast::Assign &assign);
+  ExprFn operator()(const ast::Binary &bnry);
+  ExprFn operator()(const ast::Call &call);
+  ExprFn operator()(const ast::Get &get);
+  ExprFn operator()(const ast::Grouping &grp);
+  ExprFn operator()(const ast::Literal &ltrl);
+  ExprFn operator()(const ast::Set &set);
+  ExprFn operator()(const ast::Unary &unry);
+  ExprFn operator()(const ast::Variable &var);
+
+private:
+  // A function body, shared by every function created from the declaration
+  struct CompiledFun {
+    Symbol name;
+    std::shared_ptr<const Function> function;
+    std::vector<VarLocation> upvalues;
+  };
+
+  CompiledFun compileFun(const stmt::Fun &funStmt);
+  std::vector<StmtFn>
+  compileStmts(const std::vector<std::unique_ptr<stmt::Stmt>> &stmts);
+
+  // Variables are read and written by name, through a cache for globals, by
+  // slot or through an upvalue
+  static ExprFn getVariable(const Symbol &name,
+                            const std::optional<VarLocation> &loc);
+  static ExprFn assignVariable(const Symbol &name,
+                               const std::optional<VarLocation> &loc,
+                               ExprFn value);
+
+  static Value invokeValue(InterpreterVisitor &interp, const Value &callee,
+                           const std::vector<ExprFn> &args, int line);
+  static Value invoke(InterpreterVisitor &interp, const FnDescShrdPtr &fn,
+                      const std::vector<ExprFn> &args, int line);
+};
+
+} // namespace closure
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -1,94 +1,487 @@
 #include <environment.h>
 
 #include <errs.h>
+#include <func.h>
+
+#include <iterator>
+#include <new>
+#include <utility>
 
 namespace plox {
 namespace treewalk {
 
+namespace {
+std::uint64_t s_nextLayoutVersion = 1;
+
+// Environments are created and destroyed for every call and block, so the
+// memory for them and their shared_ptr counts is kept on a free list for the
+// next one rather than going back to the heap. Like the reference counts on
+// Values, this assumes the interpreter runs on one thread.
+template <typename T> struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template <typename U> PoolAllocator(const PoolAllocator<U> &) {}
+
+  T *allocate(std::size_t n) {
+    if (n == 1 && s_free) {
+      FreeBlock *block = std::exchange(s_free, s_free->next);
+      s_numFree--;
+      return reinterpret_cast<T *>(block);
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, std::size_t n) {
+    // Deep recursion frees many Environments at once, so only some are kept
+    if (n == 1 && s_numFree < k_maxFree) {
+      s_free = new (p) FreeBlock{s_free};
+      s_numFree++;
+      return;
+    }
+    ::operator delete(p);
+  }
+
+  template <typename U> bool operator==(const PoolAllocator<U> &) const {
+    return true;
+  }
+
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+  static_assert(sizeof(T) >= sizeof(FreeBlock));
+
+  static constexpr int k_maxFree = 1024;
+  static inline FreeBlock *s_free = nullptr;
+  static inline int s_numFree = 0;
+};
+} // namespace
+
+Slots::Slots(const Slots &other)
+    : d_inline(other.d_inline), d_heap(other.d_heap), d_size(other.d_size) {
+  if (other.d_data != other.d_inline.data()) {
+    d_data = d_heap.data();
+  }
+}
+
+void Slots::resize(int size) {
+  bool isInline = d_data == d_inline.data();
+  if (isInline && size <= k_numInline) {
+    // Slots past the size are kept nil
+    for (int i = size; i < d_size; i++) {
+      d_inline[i] = {};
+    }
+  } else {
+    if (isInline) {
+      d_heap.assign(std::make_move_iterator(d_inline.begin()),
+                    std::make_move_iterator(d_inline.begin() + d_size));
+    }
+    d_heap.resize(size);
+    d_data = d_heap.data();
+  }
+  d_size = size;
+}
+
+void Slots::clear() {
+  d_inline = {};
+  d_heap.clear();
+  d_data = d_inline.data();
+  d_size = 0;
+}
+
+Upvalue::Upvalue(Environment *env, int slot) : d_env(env), d_slot(slot) {}
+
+Value Upvalue::get() const {
+  return d_env ? d_env->d_slots[d_slot] : d_closed;
+}
+
+void Upvalue::set(Value v) {
+  if (d_env) {
+    d_env->d_slots[d_slot] = std::move(v);
+  } else {
+    d_closed = std::move(v);
+  }
+}
+
+void Upvalue::trace(gc::Tracer &tracer) const {
+  // An open upvalue reads the slot from the Environment, but doesn't own it
+  tracer.visitWeak(d_env);
+  tracer.visit(d_closed);
+}
+
+void Upvalue::clearReferences() {
+  d_env = nullptr;
+  d_closed = {};
+}
+
 std::shared_ptr<Environment>
-Environment::create(std::shared_ptr<Environment> parent) {
-  auto envPtr = std::shared_ptr<Environment>(new Environment(parent));
+Environment::create(std::shared_ptr<Environment> parent,
+                     std::optional<int> numSlots) {
+  auto envPtr = std::allocate_shared<Environment>(
+      PoolAllocator<Environment>(), PrivateTag{}, std::move(parent));
+  envPtr->d_slots.resize(numSlots.value_or(0));
+  envPtr->d_isResolved = numSlots.has_value();
   return envPtr;
 }
 
 std::shared_ptr<Environment>
-Environment::extend(std::shared_ptr<Environment> scope) {
-  scope->d_isScopeEnd = false;
+Environment::createInstance(std::shared_ptr<Environment> methods) {
+  auto envPtr = create(methods->d_parent);
+  envPtr->d_methods = std::move(methods);
+  return envPtr;
+}
 
-  auto envPtr = std::shared_ptr<Environment>(new Environment(scope));
-  envPtr->d_isScopeStart = false;
+std::shared_ptr<Environment>
+Environment::snapshot(std::shared_ptr<Environment> scope) {
+  int version = scope->d_values.size();
+  auto envPtr = std::allocate_shared<Environment>(
+      PoolAllocator<Environment>(), PrivateTag{}, std::move(scope));
+  envPtr->d_parentVersion = version;
+  envPtr->d_isSnapshot = true;
   return envPtr;
 }
 
-Environment::Environment(std::shared_ptr<Environment> parent)
-    : d_parent(parent), d_isScopeStart(true), d_isScopeEnd(true) {}
+Environment::Environment(PrivateTag, std::shared_ptr<Environment> parent)
+    : d_shape(Shape::empty()), d_layoutVersion(s_nextLayoutVersion++),
+      d_parent(std::move(parent)),
+      d_parentVersion(k_latest), d_isSnapshot(false), d_isResolved(false) {}
+
+Environment::Environment(const Environment &other)
+    : d_shape(other.d_shape), d_layoutVersion(s_nextLayoutVersion++),
+      d_values(other.d_values), d_slots(other.d_slots),
+      d_parent(other.d_parent),
+      d_methods(other.d_methods), d_parentVersion(other.d_parentVersion),
+      d_isSnapshot(other.d_isSnapshot), d_isResolved(other.d_isResolved) {
+  if (other.d_ownShape) {
+    d_ownShape = other.d_ownShape->unshare();
+    d_shape = d_ownShape.get();
+  }
+}
+
+Environment::~Environment() {
+  // Functions that captured variables from this scope keep their values
+  if (!d_openUpvalues) {
+    return;
+  }
+  for (auto &upvalue : *d_openUpvalues) {
+    upvalue->d_closed = std::move(d_slots[upvalue->d_slot]);
+    upvalue->d_env = nullptr;
+  }
+}
+
+void Environment::assign(const Symbol &name, Value v) {
+  assign(name, std::move(v), k_latest);
+}
 
-void Environment::assign(const std::string &name, const Value &v) {
+void Environment::assign(const Symbol &name, Value v, int version) {
   // Assignment dictates the var must already exist
-  if (d_map.contains(name)) {
-    d_map[name] = v;
+  if (Value *val = findNamed(name, version)) {
+    *val = std::move(v);
+  } else if (findMethod(name)) {
+    // The instance gets a field which hides the method
+    define(name, std::move(v));
   } else if (d_parent) {
-    d_parent->assign(name, v);
+    d_parent->assign(name, std::move(v), d_parentVersion);
   } else {
-    throw InterpretException("Cannot assign unknown variable: " + name);
+    throw InterpretException("Cannot assign unknown variable: " +
+                             std::string(name));
   }
 }
 
-void Environment::define(const std::string &name, const Value &v) {
-  if (!d_isScopeEnd) {
-    throw InterpretException(
-        "Internal Lox error: Tried to define a variable '" + name +
-        "' in a non-tail Environment for the scope.");
-  }
-
+void Environment::define(const Symbol &name, Value v) {
   // For defining a variable Lox allows shadowing variables in higher scopes.
   // We only need to check within this scope
   if (isVarInScope(name)) {
-    throw InterpretException("Cannot redefine variable: " + name);
+    throw InterpretException("Cannot redefine variable: " + std::string(name));
   }
 
-  d_map[name] = v;
+  if (d_ownShape) {
+    d_ownShape->add(name);
+  } else if (d_shape->size() < Shape::k_maxSharedSize) {
+    d_shape = d_shape->withName(name);
+  } else {
+    d_ownShape = d_shape->unshare();
+    d_ownShape->add(name);
+    d_shape = d_ownShape.get();
+  }
+  d_layoutVersion = s_nextLayoutVersion++;
+  d_values.push_back(std::move(v));
 }
 
-void Environment::upsertInScope(const std::string &name, const Value &v) {
+void Environment::upsertInScope(const Symbol &name, Value v) {
   if (isVarInScope(name)) {
-    return assign(name, v);
+    return assign(name, std::move(v));
   }
 
-  return define(name, v);
+  return define(name, std::move(v));
+}
+
+Value Environment::get(const Symbol &name) const {
+  return get(name, k_latest);
 }
 
-Value Environment::get(const std::string &name) const {
-  if (d_map.contains(name)) {
-    return d_map.at(name);
+Value Environment::get(const Symbol &name, int version) const {
+  if (const Value *val = findNamed(name, version)) {
+    return *val;
+  } else if (const Value *method = findMethod(name)) {
+    return bindMethod(*method);
   } else if (d_parent) {
-    return d_parent->get(name);
+    return d_parent->get(name, d_parentVersion);
   } else {
-    throw InterpretException("Unknown variable: " + name);
+    throw InterpretException("Unknown variable: " + std::string(name));
   }
 }
 
-bool Environment::isVarInScope(const std::string &name) const {
-  // Check if var is in current env
-  if (d_map.contains(name)) {
-    return true;
+bool Environment::isVarInScope(const Symbol &name) const {
+  return d_shape->find(name) >= 0;
+}
+
+void Environment::defineAt(int slot, Value v) {
+  if (slot >= d_slots.size()) {
+    d_slots.resize(slot + 1);
   }
+  d_slots[slot] = std::move(v);
+}
 
-  // Continue recursing until we hit the start of the scope
-  if (!d_isScopeStart && d_parent) {
-    return d_parent->isVarInScope(name);
+void Environment::assignAt(const VarLocation &loc, const Symbol &name,
+                           Value v) {
+  Environment *env = this;
+  int version = k_latest;
+  for (int i = 0; i < loc.depth; i++) {
+    if (Value *val = env->findNamed(name, version)) {
+      *val = std::move(v);
+      return;
+    }
+    version = env->d_parentVersion;
+    env = env->d_parent.get();
   }
 
-  // We're at the start of the scope and didn't find the var
-  return false;
+  if (loc.slot >= env->d_slots.size()) {
+    throw InterpretException("Internal Lox error: Tried to assign variable '" +
+                             std::string(name) + "' to an undefined slot.");
+  }
+  env->d_slots[loc.slot] = std::move(v);
+}
+
+Value Environment::getAt(const VarLocation &loc, const Symbol &name) const {
+  const Environment *env = this;
+  int version = k_latest;
+  for (int i = 0; i < loc.depth; i++) {
+    if (const Value *val = env->findNamed(name, version)) {
+      return *val;
+    }
+    version = env->d_parentVersion;
+    env = env->d_parent.get();
+  }
+
+  if (loc.slot >= env->d_slots.size()) {
+    throw InterpretException("Internal Lox error: Tried to get variable '" +
+                             std::string(name) + "' from an undefined slot.");
+  }
+  return env->d_slots[loc.slot];
+}
+
+Ref<Upvalue> Environment::capture(const VarLocation &loc) {
+  Environment *env = this;
+  for (int i = 0; i < loc.depth; i++) {
+    env = env->d_parent.get();
+  }
+
+  if (loc.slot >= env->d_slots.size()) {
+    throw InterpretException(
+        "Internal Lox error: Tried to capture an undefined slot.");
+  }
+  if (!env->d_openUpvalues) {
+    env->d_openUpvalues = std::make_unique<std::vector<Ref<Upvalue>>>();
+  }
+  for (auto &upvalue : *env->d_openUpvalues) {
+    if (upvalue->d_slot == loc.slot) {
+      return upvalue;
+    }
+  }
+  return env->d_openUpvalues->emplace_back(makeRef<Upvalue>(env, loc.slot));
+}
+
+Environment *Environment::findShadowing(const Symbol &name, int count) {
+  for (Environment *env = this; env && count > 0; env = env->d_parent.get()) {
+    // Snapshots hold no variables, so aren't counted by the resolver
+    if (env->d_isResolved || env->d_isSnapshot) {
+      continue;
+    }
+    if (env->findNamed(name) || env->findMethod(name)) {
+      return env;
+    }
+    count--;
+  }
+  return nullptr;
+}
+
+std::shared_ptr<Environment>
+Environment::namedScope(const std::shared_ptr<Environment> &env) {
+  std::shared_ptr<Environment> named = env;
+  while (named && named->d_isResolved) {
+    named = named->d_parent;
+  }
+  return named;
+}
+
+Value Environment::getGlobal(const Symbol &name, const Environment &globals,
+                             GlobalCache &cache) const {
+  if (cache.layoutVersion == globals.d_layoutVersion) {
+    return globals.d_values[cache.index];
+  }
+
+  // Look the name up as get does. It's only cached when found in the globals,
+  // as a function can be called with a different top level scope.
+  int version = k_latest;
+  for (const Environment *env = this; env; env = env->d_parent.get()) {
+    if (const Value *val = env->findNamed(name, version)) {
+      if (env == &globals) {
+        cache = {globals.d_layoutVersion, int(val - globals.d_values.data())};
+      }
+      return *val;
+    } else if (const Value *method = env->findMethod(name)) {
+      return env->bindMethod(*method);
+    }
+    version = env->d_parentVersion;
+  }
+  throw InterpretException("Unknown variable: " + std::string(name));
+}
+
+void Environment::assignGlobal(const Symbol &name, Value v,
+                               Environment &globals, GlobalCache &cache) {
+  if (cache.layoutVersion == globals.d_layoutVersion) {
+    globals.d_values[cache.index] = std::move(v);
+    return;
+  }
+
+  int version = k_latest;
+  for (Environment *env = this; env; env = env->d_parent.get()) {
+    if (Value *val = env->findNamed(name, version)) {
+      if (env == &globals) {
+        cache = {globals.d_layoutVersion, int(val - globals.d_values.data())};
+      }
+      *val = std::move(v);
+      return;
+    } else if (env->findMethod(name)) {
+      env->define(name, std::move(v));
+      return;
+    }
+    version = env->d_parentVersion;
+  }
+  throw InterpretException("Cannot assign unknown variable: " +
+                           std::string(name));
+}
+
+Value Environment::getProperty(const Symbol &name,
+                               PropertyCache &cache) const {
+  const PropertyCache::Entry *entry = cache.find(d_shape);
+  if (entry && !entry->added) {
+    return d_values[entry->index];
+  }
+
+  // Properties not on the instance are looked up in the enclosing scopes
+  int index = d_shape->find(name);
+  if (index < 0) {
+    return get(name);
+  }
+  if (d_shape->isShared()) {
+    cache.insert({d_shape, nullptr, index});
+  }
+  return d_values[index];
+}
+
+void Environment::setProperty(const Symbol &name, Value v,
+                              PropertyCache &cache) {
+  const PropertyCache::Entry *entry = cache.find(d_shape);
+  if (entry && entry->added) {
+    d_shape = entry->added;
+    d_layoutVersion = s_nextLayoutVersion++;
+    d_values.push_back(std::move(v));
+    return;
+  } else if (entry) {
+    d_values[entry->index] = std::move(v);
+    return;
+  }
+
+  const Shape *before = d_shape;
+  upsertInScope(name, std::move(v));
+  int index = d_shape->find(name);
+  if (before->isShared() && d_shape->isShared() && index >= 0) {
+    cache.insert({before, d_shape != before ? d_shape : nullptr, index});
+  }
+}
+
+const Shape *Environment::shape() const { return d_shape; }
+
+long Environment::useCount() const {
+  // An Environment outside of a shared_ptr is held by whatever owns it
+  long count = weak_from_this().use_count();
+  return count ? count : 1;
+}
+
+void Environment::trace(gc::Tracer &tracer) const {
+  for (const Value &v : d_values) {
+    tracer.visit(v);
+  }
+  for (const Value &v : d_slots) {
+    tracer.visit(v);
+  }
+  if (d_openUpvalues) {
+    for (const Ref<Upvalue> &upvalue : *d_openUpvalues) {
+      tracer.visit(upvalue.get());
+    }
+  }
+  tracer.visit(d_parent);
+  tracer.visit(d_methods);
+}
+
+void Environment::clearReferences() {
+  // The open upvalues are garbage too, so don't need the slots' values
+  if (d_openUpvalues) {
+    for (Ref<Upvalue> &upvalue : *d_openUpvalues) {
+      upvalue->d_env = nullptr;
+    }
+    d_openUpvalues.reset();
+  }
+  d_shape = Shape::empty();
+  d_layoutVersion = s_nextLayoutVersion++;
+  d_ownShape.reset();
+  d_values.clear();
+  d_slots.clear();
+  d_parent.reset();
+  d_methods.reset();
+}
+
+void Environment::pin(gc::Pins &pins) {
+  pins.environments.push_back(shared_from_this());
+}
+
+Value *Environment::findNamed(const Symbol &name, int version) {
+  if (d_values.empty()) {
+    return nullptr;
+  }
+  int index = d_shape->find(name);
+  return index >= 0 && index < version ? &d_values[index] : nullptr;
+}
+
+const Value *Environment::findNamed(const Symbol &name, int version) const {
+  if (d_values.empty()) {
+    return nullptr;
+  }
+  int index = d_shape->find(name);
+  return index >= 0 && index < version ? &d_values[index] : nullptr;
 }
 
-std::map<std::string, Value>::const_iterator Environment::begin() const {
-  return d_map.cbegin();
+const Value *Environment::findMethod(const Symbol &name) const {
+  return d_methods ? d_methods->findNamed(name) : nullptr;
 }
 
-std::map<std::string, Value>::const_iterator Environment::end() const {
-  return d_map.cend();
+Value Environment::bindMethod(const Value &method) const {
+  auto bound = makeRef<FunctionDescription>(*method.get<FnDescShrdPtr>());
+  bound->getClosure() =
+      std::const_pointer_cast<Environment>(shared_from_this());
+  return bound;
 }
 
 namespace environmentutils {
@@ -1,12 +1,19 @@
 #ifndef PLOX_ENVIRONMENT
 #define PLOX_ENVIRONMENT
 
+#include <gc.h>
+#include <location.h>
+#include <shape.h>
+#include <symbol.h>
 #include <value.h>
 
-#include <map>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <memory>
-#include <string>
+#include <optional>
 #include <variant>
+#include <vector>
 
 namespace plox {
 namespace treewalk {
@@ -14,42 +21,189 @@ namespace treewalk {
 /*
  Environment is a class to store variables within the program.
 
- Environments can represent a whole scope, or part of a scope. An example where
- representing just part of a scope can be useful is for a function declaration,
- where the function should only be only aware of scope variables defined before
- the function is declared.
-
- Environments are chained as Directed Acyclic Graphs.
+ Each Environment holds a whole scope, and Environments are chained as
+ Directed Acyclic Graphs. A function declaration should only be aware of the
+ scope variables defined before the function is declared, so it closes over a
+ snapshot of the scope: an empty Environment recording how many of the scope's
+ variables were declared when it was taken. Named variables are numbered in
+ the order they are declared, so lookups through the snapshot skip the later
+ ones, and looking a variable up doesn't get slower as the scope grows.
+
+ Variables can be stored by name, or in a numbered slot when the resolver has
+ worked out where the variable lives. Slots are not visible to lookups by name.
+ Names are interned Symbols, so looking a variable up by name hashes and
+ compares an integer id rather than a string.
+
+ Named variables are stored in the order they are defined, and the
+ Environment's Shape gives the index of each name. Class instances share
+ Shapes, which lets property accesses cache where a property lives.
+
+ Environments created for resolved scopes only hold slots. Functions capture
+ the slots they use from these as Upvalues rather than keeping the
+ Environment alive.
 */
 
-class Environment {
+class Environment;
+
+// The slots of an Environment. Most calls and blocks only need a few, which
+// are stored inline so creating the Environment doesn't allocate them.
+class Slots {
 public:
-  // Factories
+  Slots() = default;
+  Slots(const Slots &other);
+  Slots &operator=(const Slots &other) = delete;
+
+  int size() const { return d_size; }
+  // New slots hold nil
+  void resize(int size);
+  void clear();
+
+  Value &operator[](int idx) { return d_data[idx]; }
+  const Value &operator[](int idx) const { return d_data[idx]; }
+  const Value *begin() const { return d_data; }
+  const Value *end() const { return d_data + d_size; }
+
+  static constexpr int k_numInline = 4;
+
+private:
+  std::array<Value, k_numInline> d_inline;
+  std::vector<Value> d_heap;
+  Value *d_data = d_inline.data();
+  int d_size = 0;
+};
+
+// A variable captured by a function. The upvalue reads and writes the slot
+// while the Environment declaring it is alive, then holds the value itself.
+class Upvalue : public gc::TracedObject {
+public:
+  Upvalue(Environment *env, int slot);
+
+  Value get() const;
+  void set(Value v);
+
+  void trace(gc::Tracer &tracer) const override;
+  void clearReferences() override;
+
+private:
+  friend class Environment;
+
+  Environment *d_env;
+  int d_slot;
+  Value d_closed;
+};
+
+class Environment : public std::enable_shared_from_this<Environment>,
+                    public gc::Traceable {
+  // An Environment must be owned by a shared_ptr, so is only created by the
+  // factories. They're made in one allocation with the shared_ptr's count.
+  struct PrivateTag {};
+
+public:
+  // Factories. Scopes given a number of slots have been resolved.
   static std::shared_ptr<Environment>
-  create(std::shared_ptr<Environment> parent = nullptr);
+  create(std::shared_ptr<Environment> parent = nullptr,
+         std::optional<int> numSlots = std::nullopt);
+  // An Environment for the fields of a class instance. Names not found in the
+  // fields are looked up in the class's methods, which are bound to the
+  // instance when accessed, and then in the scope the class was defined in.
   static std::shared_ptr<Environment>
-  extend(std::shared_ptr<Environment> scope);
+  createInstance(std::shared_ptr<Environment> methods);
+  // A view of the named variables declared in the scope so far, which doesn't
+  // see the variables declared after it
+  static std::shared_ptr<Environment>
+  snapshot(std::shared_ptr<Environment> scope);
 
-  // Operations
-  void assign(const std::string &name, const Value &v);
-  void define(const std::string &name, const Value &v = {});
-  void upsertInScope(const std::string &name, const Value &v);
+  // Operations. Values are taken by value so callers can move them in.
+  void assign(const Symbol &name, Value v);
+  void define(const Symbol &name, Value v = {});
+  void upsertInScope(const Symbol &name, Value v);
 
-  Value get(const std::string &name) const;
+  Value get(const Symbol &name) const;
 
-  bool isVarInScope(const std::string &name) const;
+  bool isVarInScope(const Symbol &name) const;
 
-  // Iterators
-  std::map<std::string, Value>::const_iterator begin() const;
-  std::map<std::string, Value>::const_iterator end() const;
+  // Slot operations for resolved variables. The name is only used to check
+  // Environments with named variables (i.e. class instances) that sit between
+  // this Environment and the one holding the slot, as these can shadow it.
+  void defineAt(int slot, Value v);
+  void assignAt(const VarLocation &loc, const Symbol &name, Value v);
+  Value getAt(const VarLocation &loc, const Symbol &name) const;
 
-private:
-  Environment(std::shared_ptr<Environment> parent);
+  // Captures the slot at the location for a function defined in this scope.
+  // Functions capturing the same slot share the Upvalue.
+  Ref<Upvalue> capture(const VarLocation &loc);
+
+  // Finds the first of the next 'count' Environments holding named variables
+  // that has the name. These are the class instances that can shadow an
+  // upvalue with their fields and methods.
+  Environment *findShadowing(const Symbol &name, int count);
 
-  std::map<std::string, Value> d_map;
+  // The nearest Environment that holds variables by name. This is all a
+  // function needs to keep alive, as resolved variables are captured.
+  static std::shared_ptr<Environment>
+  namedScope(const std::shared_ptr<Environment> &env);
+
+  // Access to globals that no class instance can shadow. The cache holds where
+  // the name was found in the globals, so while they are at the same layout
+  // version the access skips looking up the name and walking the scopes.
+  Value getGlobal(const Symbol &name, const Environment &globals,
+                  GlobalCache &cache) const;
+  void assignGlobal(const Symbol &name, Value v, Environment &globals,
+                    GlobalCache &cache);
+
+  // Property access on class instances, using the cache to skip looking up
+  // the name when the instance has a Shape seen before
+  Value getProperty(const Symbol &name, PropertyCache &cache) const;
+  void setProperty(const Symbol &name, Value v, PropertyCache &cache);
+
+  const Shape *shape() const;
+
+  // Garbage collection
+  long useCount() const override;
+  void trace(gc::Tracer &tracer) const override;
+  void clearReferences() override;
+  void pin(gc::Pins &pins) override;
+
+  // Public for std::make_shared, but only the factories can name the tag
+  Environment(PrivateTag, std::shared_ptr<Environment> parent);
+  // A copy holds the same variables, but nothing has captured from it yet
+  Environment(const Environment &other);
+  ~Environment();
+
+private:
+  friend class Upvalue;
+
+  // The version of a scope that sees all of its variables
+  static constexpr int k_latest = std::numeric_limits<int>::max();
+
+  // Lookups by name that only see the first 'version' named variables, for
+  // when the lookup has come through a snapshot
+  void assign(const Symbol &name, Value v, int version);
+  Value get(const Symbol &name, int version) const;
+  Value *findNamed(const Symbol &name, int version = k_latest);
+  const Value *findNamed(const Symbol &name, int version = k_latest) const;
+  const Value *findMethod(const Symbol &name) const;
+  Value bindMethod(const Value &method) const;
+
+  const Shape *d_shape;
+  // A new version is taken whenever the Shape changes. Versions aren't shared
+  // between Environments, so a matching version is the same Environment and
+  // layout.
+  std::uint64_t d_layoutVersion;
+  // Set once the Shape is too large to share
+  std::unique_ptr<Shape> d_ownShape;
+  std::vector<Value> d_values;
+  Slots d_slots;
+  // Most Environments are never captured from, so this is only allocated when
+  // a function captures a slot
+  std::unique_ptr<std::vector<Ref<Upvalue>>> d_openUpvalues;
   std::shared_ptr<Environment> d_parent;
-  bool d_isScopeStart;
-  bool d_isScopeEnd;
+  // The class's methods when this holds the fields of an instance
+  std::shared_ptr<Environment> d_methods;
+  // How many of the parent's named variables are visible from here
+  int d_parentVersion;
+  bool d_isSnapshot;
+  bool d_isResolved;
 };
 
 namespace environmentutils {
@@ -13,6 +13,12 @@ public:
       : std::runtime_error(msg){};
 };
 
+class ResolveException : public std::runtime_error {
+public:
+  explicit ResolveException(const std::string &msg)
+      : std::runtime_error(msg){};
+};
+
 class ParseException : public std::runtime_error {
 public:
   explicit ParseException(const std::string &msg, int line);
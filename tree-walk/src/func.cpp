@@ -7,34 +7,53 @@
 namespace plox {
 namespace treewalk {
 
-Function::Function(std::vector<std::string_view> &&argNames,
-                   std::variant<std::vector<std::unique_ptr<stmt::Stmt>>,
-                                nativefunc::Fn> &&body)
-    : d_argNames(std::move(argNames)), d_body(std::move(body)) {}
+Function::Function(std::vector<Symbol> &&argNames, Body &&body,
+                   std::optional<int> numSlots)
+    : d_argNames(std::move(argNames)), d_body(std::move(body)),
+      d_numSlots(numSlots) {}
 
 int Function::getArity() const { return d_argNames.size(); }
 
-const std::vector<std::string_view> &Function::getArgNames() const {
+const std::vector<Symbol> &Function::getArgNames() const {
   return d_argNames;
 }
 
-Value Function::execute(std::shared_ptr<Environment> env,
+const std::optional<int> &Function::getNumSlots() const { return d_numSlots; }
+
+const std::vector<std::unique_ptr<stmt::Stmt>> *Function::getStmts() const {
+  return std::get_if<std::vector<std::unique_ptr<stmt::Stmt>>>(&d_body);
+}
+
+Value Function::execute(const std::shared_ptr<Environment> &env,
                         InterpreterVisitor &interp) const {
   if (std::holds_alternative<nativefunc::Fn>(d_body)) {
     return std::get<nativefunc::Fn>(d_body)(env, interp);
   }
 
+  if (std::holds_alternative<std::vector<closure::StmtFn>>(d_body)) {
+    for (auto &s : std::get<std::vector<closure::StmtFn>>(d_body)) {
+      if (s(interp) == Completion::RETURN) {
+        return interp.takeReturnValue();
+      }
+    }
+    return {};
+  }
+
   auto &stmtVec = std::get<std::vector<std::unique_ptr<stmt::Stmt>>>(d_body);
   for (auto &s : stmtVec) {
-    std::visit(interp, *s);
+    if (std::visit(interp, *s) == Completion::RETURN) {
+      return interp.takeReturnValue();
+    }
   }
   return {}; // return null if the user doesn't explicitly add a return stmt.
 }
 
-FunctionDescription::FunctionDescription(std::string_view name,
-                                         std::shared_ptr<Environment> closure,
-                                         std::shared_ptr<const Function> fn)
-    : d_name(name), d_closure(closure), d_fn(fn) {}
+FunctionDescription::FunctionDescription(
+    std::string_view name, std::shared_ptr<Environment> closure,
+    std::shared_ptr<const Function> fn,
+    std::vector<Ref<Upvalue>> upvalues)
+    : d_name(name), d_closure(std::move(closure)), d_fn(std::move(fn)),
+      d_upvalues(std::move(upvalues)), d_isInitialiser(false) {}
 
 std::string_view FunctionDescription::getName() const { return d_name; }
 
@@ -49,10 +68,27 @@ FunctionDescription::getFunction() const {
   return d_fn;
 }
 
+const Ref<Upvalue> &
+FunctionDescription::getUpvalue(int idx) const {
+  return d_upvalues[idx];
+}
+
 bool FunctionDescription::isInitialiser() const { return d_isInitialiser; }
 
 void FunctionDescription::setIsInitialiser(bool b) { d_isInitialiser = b; }
 
+void FunctionDescription::trace(gc::Tracer &tracer) const {
+  tracer.visit(d_closure);
+  for (const Ref<Upvalue> &upvalue : d_upvalues) {
+    tracer.visit(upvalue.get());
+  }
+}
+
+void FunctionDescription::clearReferences() {
+  d_closure.reset();
+  d_upvalues.clear();
+}
+
 std::ostream &operator<<(std::ostream &os, const Function &fn) {
   os << "(";
 
@@ -1,13 +1,17 @@
 #ifndef TREEWALK_FUNC_H
 #define TREEWALK_FUNC_H
 
+#include <closure_compiler.h>
 #include <environment.h>
 #include <func_native.h>
+#include <gc.h>
 #include <interpreter.h>
 #include <stmt.h>
+#include <symbol.h>
 #include <value.h>
 
 #include <functional>
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -16,37 +20,54 @@ namespace treewalk {
 
 class Function {
 public:
-  Function(std::vector<std::string_view> &&argNames,
-           std::variant<std::vector<std::unique_ptr<stmt::Stmt>>,
-                        nativefunc::Fn> &&body);
+  // The statements to walk, a native function, or the statements compiled by
+  // the closure engine
+  using Body = std::variant<std::vector<std::unique_ptr<stmt::Stmt>>,
+                            nativefunc::Fn, std::vector<closure::StmtFn>>;
+
+  Function(std::vector<Symbol> &&argNames, Body &&body,
+           std::optional<int> numSlots = std::nullopt);
 
   int getArity() const;
-  const std::vector<std::string_view> &getArgNames() const;
-  Value execute(std::shared_ptr<Environment> env,
+  const std::vector<Symbol> &getArgNames() const;
+  // Set when the resolver has placed the args and locals in slots
+  const std::optional<int> &getNumSlots() const;
+  // The statements to walk, or null for native and compiled functions
+  const std::vector<std::unique_ptr<stmt::Stmt>> *getStmts() const;
+  Value execute(const std::shared_ptr<Environment> &env,
                 InterpreterVisitor &interp) const;
 
 private:
-  std::vector<std::string_view> d_argNames;
-  std::variant<std::vector<std::unique_ptr<stmt::Stmt>>, nativefunc::Fn> d_body;
+  std::vector<Symbol> d_argNames;
+  Body d_body;
+  std::optional<int> d_numSlots;
 };
 
-class FunctionDescription {
+class FunctionDescription : public gc::TracedObject {
 public:
   FunctionDescription(std::string_view name,
                       std::shared_ptr<Environment> closure,
-                      std::shared_ptr<const Function> fn);
+                      std::shared_ptr<const Function> fn,
+                      std::vector<Ref<Upvalue>> upvalues = {});
 
   std::string_view getName() const;
   void setName(std::string_view name);
   std::shared_ptr<Environment> &getClosure();
   const std::shared_ptr<const Function> &getFunction() const;
+  // The variables captured from enclosing functions, in the order the
+  // resolver numbered them
+  const Ref<Upvalue> &getUpvalue(int idx) const;
   bool isInitialiser() const;
   void setIsInitialiser(bool b);
 
+  void trace(gc::Tracer &tracer) const override;
+  void clearReferences() override;
+
 private:
   std::string_view d_name;
   std::shared_ptr<Environment> d_closure;
   std::shared_ptr<const Function> d_fn;
+  std::vector<Ref<Upvalue>> d_upvalues;
   bool d_isInitialiser;
 };
 
@@ -20,9 +20,9 @@ void addClock(std::shared_ptr<Environment> env) {
     return std::chrono::duration<double, std::milli>(duration).count();
   };
 
-  auto clockFn = std::make_shared<FunctionDescription>(
+  auto clockFn = makeRef<FunctionDescription>(
       s_name, env,
-      std::make_shared<Function>(std::vector<std::string_view>{}, clock));
+      std::make_shared<Function>(std::vector<Symbol>{}, clock));
   env->define(s_name, clockFn);
 }
 
@@ -32,9 +32,9 @@ void addVersion(std::shared_ptr<Environment> env) {
   auto version = [](std::shared_ptr<Environment> env,
                     InterpreterVisitor &interpV) { return "tree-walk"; };
 
-  auto versionFn = std::make_shared<FunctionDescription>(
+  auto versionFn = makeRef<FunctionDescription>(
       s_name, env,
-      std::make_shared<Function>(std::vector<std::string_view>{}, version));
+      std::make_shared<Function>(std::vector<Symbol>{}, version));
   env->define(s_name, versionFn);
 }
 
@@ -0,0 +1,175 @@
+#include <gc.h>
+
+#include <class.h>
+#include <environment.h>
+#include <func.h>
+
+#include <algorithm>
+
+namespace plox {
+namespace treewalk {
+namespace gc {
+
+namespace {
+constexpr size_t k_firstCollection = 16 * 1024;
+constexpr int k_growFactor = 2;
+} // namespace
+
+// The list of registered objects. This is constant initialised so objects in
+// statics can register and unregister in any order.
+class Heap {
+public:
+  static void add(Traceable *obj);
+  static void remove(Traceable *obj);
+  static void collect();
+
+  static constinit Traceable *s_objects;
+  static constinit size_t s_numObjects;
+  static constinit size_t s_nextCollection;
+  static constinit Stats s_stats;
+};
+
+constinit Traceable *Heap::s_objects = nullptr;
+constinit size_t Heap::s_numObjects = 0;
+constinit size_t Heap::s_nextCollection = k_firstCollection;
+constinit Stats Heap::s_stats;
+
+void Heap::add(Traceable *obj) {
+  obj->d_prev = nullptr;
+  obj->d_next = s_objects;
+  if (s_objects) {
+    s_objects->d_prev = obj;
+  }
+  s_objects = obj;
+  s_numObjects++;
+}
+
+void Heap::remove(Traceable *obj) {
+  if (obj->d_prev) {
+    obj->d_prev->d_next = obj->d_next;
+  } else {
+    s_objects = obj->d_next;
+  }
+  if (obj->d_next) {
+    obj->d_next->d_prev = obj->d_prev;
+  }
+  s_numObjects--;
+}
+
+void Heap::collect() {
+  auto start = std::chrono::steady_clock::now();
+
+  // Count the references from outside the heap
+  for (Traceable *obj = s_objects; obj; obj = obj->d_next) {
+    obj->d_gcRefs = obj->useCount();
+    obj->d_isMarked = false;
+  }
+  Tracer counter(Tracer::Phase::COUNT);
+  for (Traceable *obj = s_objects; obj; obj = obj->d_next) {
+    obj->trace(counter);
+  }
+
+  // Mark everything reachable from the roots
+  Tracer marker(Tracer::Phase::MARK);
+  for (Traceable *obj = s_objects; obj; obj = obj->d_next) {
+    if (obj->d_gcRefs > 0) {
+      marker.visit(obj);
+    }
+  }
+  while (!marker.d_grayStack.empty()) {
+    Traceable *obj = marker.d_grayStack.back();
+    marker.d_grayStack.pop_back();
+    obj->trace(marker);
+  }
+
+  // Break the cycles between the unmarked objects. Clearing an object can free
+  // others, so the garbage is pinned until every object has been cleared.
+  Pins pins;
+  std::vector<Traceable *> garbage;
+  for (Traceable *obj = s_objects; obj; obj = obj->d_next) {
+    if (!obj->d_isMarked) {
+      garbage.push_back(obj);
+      obj->pin(pins);
+    }
+  }
+  for (Traceable *obj : garbage) {
+    obj->clearReferences();
+  }
+  size_t numBefore = s_numObjects;
+  pins = {};
+
+  s_nextCollection = std::max(s_numObjects * k_growFactor, k_firstCollection);
+  auto pause = std::chrono::steady_clock::now() - start;
+  s_stats.numCollections++;
+  s_stats.numFreed += numBefore - s_numObjects;
+  s_stats.totalPause += pause;
+  s_stats.maxPause =
+      std::max<std::chrono::nanoseconds>(s_stats.maxPause, pause);
+}
+
+Traceable::Traceable() { Heap::add(this); }
+
+Traceable::Traceable(const Traceable &) { Heap::add(this); }
+
+Traceable::~Traceable() { Heap::remove(this); }
+
+long TracedObject::useCount() const { return refCount(); }
+
+void TracedObject::pin(Pins &pins) {
+  pins.objects.emplace_back(this);
+}
+
+Tracer::Tracer(Phase phase) : d_phase(phase) {}
+
+void Tracer::visit(const Value &v) {
+  switch (v.type()) {
+  case Value::Type::FUNCTION:
+    return visit(v.get<FnDescShrdPtr>().get());
+  case Value::Type::CLASS:
+    return visit(v.get<ClsDefShrdPtr>().get());
+  case Value::Type::INSTANCE:
+    return visit(v.get<ClsInstShrdPtr>().get());
+  default:
+    // Strings can't hold references, so aren't traced
+    return;
+  }
+}
+
+void Tracer::visit(const std::shared_ptr<Environment> &env) {
+  visit(env.get());
+}
+
+void Tracer::visit(const Traceable *obj) {
+  if (!obj) {
+    return;
+  }
+  auto *traceable = const_cast<Traceable *>(obj);
+  if (d_phase == Phase::COUNT) {
+    traceable->d_gcRefs--;
+  } else if (!traceable->d_isMarked) {
+    traceable->d_isMarked = true;
+    d_grayStack.push_back(traceable);
+  }
+}
+
+void Tracer::visitWeak(const Traceable *obj) {
+  if (d_phase == Phase::MARK) {
+    visit(obj);
+  }
+}
+
+size_t numObjects() { return Heap::s_numObjects; }
+
+void maybeCollect() {
+  if (Heap::s_numObjects > Heap::s_nextCollection) {
+    Heap::collect();
+  }
+}
+
+void collect() { Heap::collect(); }
+
+const Stats &stats() { return Heap::s_stats; }
+
+} // namespace gc
+} // namespace treewalk
+} // namespace plox
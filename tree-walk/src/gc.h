@@ -0,0 +1,126 @@
+#ifndef TREEWALK_GC_H
+#define TREEWALK_GC_H
+
+#include <value.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+
+class Environment;
+
+/*
+ The tree-walk interpreter frees objects as soon as their reference count drops
+ to zero. That leaks objects that reference each other in a cycle, such as a
+ class instance whose fields hold 'this', or a recursive function that has
+ captured itself.
+
+ The collector finds these cycles by tracing. Every object that can hold
+ references registers itself with the collector, and a collection:
+   - subtracts the references the objects hold to each other from their
+     reference counts. Any object left with references is held from outside
+     the heap, by the globals, the interpreter's Environment stack or a
+     temporary, so is a root
+   - marks every object reachable from the roots
+   - clears the references held by the unmarked objects. Nothing outside the
+     garbage references them, so this breaks their cycles and the reference
+     counts free them
+
+ Finding the roots through the reference counts keeps the collector precise
+ without the interpreter having to report the temporaries it holds.
+*/
+
+namespace gc {
+
+class Heap;
+class TracedObject;
+class Tracer;
+
+// Holds objects found to be garbage while their references are cleared, so
+// none are freed part way through
+struct Pins {
+  std::vector<Ref<TracedObject>> objects;
+  std::vector<std::shared_ptr<const Environment>> environments;
+};
+
+class Traceable {
+public:
+  Traceable();
+  // A copied object is a new object, so is registered separately
+  Traceable(const Traceable &);
+  Traceable &operator=(const Traceable &) { return *this; }
+  virtual ~Traceable();
+
+  // The number of references held to this object, from anywhere
+  virtual long useCount() const = 0;
+  // Visits each reference this object holds
+  virtual void trace(Tracer &tracer) const = 0;
+  // Drops the references this object holds, once it's found to be garbage
+  virtual void clearReferences() = 0;
+  virtual void pin(Pins &pins) = 0;
+
+private:
+  friend class Heap;
+  friend class Tracer;
+
+  Traceable *d_prev;
+  Traceable *d_next;
+  long d_gcRefs;
+  bool d_isMarked;
+};
+
+// A reference counted object that can hold references
+class TracedObject : public HeapObject, public Traceable {
+public:
+  long useCount() const override;
+  void pin(Pins &pins) override;
+};
+
+class Tracer {
+public:
+  // References that are included in the referenced object's count
+  void visit(const Value &v);
+  void visit(const std::shared_ptr<Environment> &env);
+  void visit(const Traceable *obj);
+  // References that don't keep the object alive, but that the object is still
+  // reachable through
+  void visitWeak(const Traceable *obj);
+
+private:
+  friend class Heap;
+
+  enum class Phase { COUNT, MARK };
+
+  explicit Tracer(Phase phase);
+
+  Phase d_phase;
+  std::vector<Traceable *> d_grayStack;
+};
+
+struct Stats {
+  int numCollections = 0;
+  // The objects freed by breaking their cycles
+  size_t numFreed = 0;
+  std::chrono::nanoseconds totalPause{0};
+  std::chrono::nanoseconds maxPause{0};
+};
+
+// The number of objects that can hold references
+size_t numObjects();
+// Collects once the number of objects has grown enough since the last
+// collection. Only call this where every reference the interpreter holds is
+// counted, i.e. not while an object is being constructed.
+void maybeCollect();
+void collect();
+const Stats &stats();
+
+} // namespace gc
+
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -3,6 +3,8 @@
 #include <ast_printer.h>
 #include <class.h>
 #include <func.h>
+#include <gc.h>
+#include <operators.h>
 #include <value_printer.h>
 
 #include <charconv>
@@ -13,11 +15,14 @@ namespace treewalk {
 
 void interpret(std::vector<stmt::Stmt> &stmts,
                std::shared_ptr<Environment> &env,
-               std::vector<InterpretException> &errs) {
+               std::vector<InterpretException> &errs, Profiler *profiler) {
   try {
-    InterpreterVisitor v{env};
+    InterpreterVisitor v{env, profiler};
     for (auto &s : stmts) {
-      std::visit(v, s);
+      // A return in the top level script stops the script
+      if (std::visit(v, s) == Completion::RETURN) {
+        break;
+      }
     }
   } catch (const InterpretException &e) {
     errs.push_back(e);
@@ -30,97 +35,82 @@ using namespace stmt;
 namespace {
 static ValuePrinter s_valuePrinter;
 
-struct AdditionVisitor {
-  Value operator()(double l, double r);
-  Value operator()(std::string &l, std::string &r);
-  Value operator()(auto &&l, auto &&r);
-} s_adder;
-
-struct SubtractionVisitor {
-  double operator()(double l, double r);
-  double operator()(auto &&l, auto &&r);
-} s_subtractor;
-
-struct MultiplyVisitor {
-  double operator()(double l, double r);
-  double operator()(auto &&l, auto &&r);
-} s_multiplier;
-
-struct DivideVisitor {
-  double operator()(double l, double r);
-  double operator()(auto &&l, auto &&r);
-} s_divider;
-
-struct TruthyVisitor {
-  bool operator()(std::monostate);
-  bool operator()(bool b);
-  bool operator()(double b);
-  bool operator()(auto &&);
-} s_truther;
-
-struct ReturnEx : public std::runtime_error {
-  ReturnEx(Value v) : d_val(v), std::runtime_error("return"){};
-  Value d_val;
-};
+// Names the interpreter looks up itself, interned once up front
+const Symbol s_this("this");
+const Symbol s_super("super");
+const Symbol s_init("init");
 } // namespace
 
-InterpreterVisitor::InterpreterVisitor(std::shared_ptr<Environment> &env)
-    : d_env(env) {}
+InterpreterVisitor::InterpreterVisitor(std::shared_ptr<Environment> &env,
+                                       Profiler *profiler)
+    : d_env(env), d_globals(env.get()), d_function(nullptr),
+      d_profiler(profiler) {}
 
-void InterpreterVisitor::operator()(const Block &blk) {
+Completion InterpreterVisitor::operator()(const Block &blk) {
   // Create new scope and restore it after this func
-  std::shared_ptr<Environment> newEnv = Environment::create(d_env);
+  std::shared_ptr<Environment> newEnv =
+      Environment::create(d_env, blk.numSlots);
   environmentutils::ScopedSwap swapGuard(d_env, newEnv);
 
   // Run statements within block now new env is installed
   for (auto &stmt : blk.stmts) {
-    std::visit(*this, *stmt);
+    if (std::visit(*this, *stmt) == Completion::RETURN) {
+      return Completion::RETURN;
+    }
   }
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(const Class &cls) {
+Completion InterpreterVisitor::operator()(const Class &cls) {
   // Retrieve the super class
-  std::shared_ptr<ClassDefinition> super;
+  ClsDefShrdPtr super;
   if (cls.super) {
-    Value v = d_env->get(std::string(cls.super.value()));
-    if (!std::holds_alternative<ClsDefShrdPtr>(v)) {
+    Value v = getVariable(cls.super.value(), cls.superLoc);
+    if (!v.is<ClsDefShrdPtr>()) {
       throw InterpretException("Super class for " + std::string(cls.name) +
                                "must be a class");
     }
-    super = std::get<ClsDefShrdPtr>(v);
+    super = v.get<ClsDefShrdPtr>();
   }
 
   // Create a new environment for the class where the methods will be defined.
-  // Note, a class keeps the environment from the point of definition, so we
-  // capture the current environment here.
-  std::shared_ptr<Environment> clsEnv = Environment::create(d_env);
+  // Note, a class keeps the environment from the point of definition, so a
+  // named scope is snapshotted once the class is declared in it. Resolved
+  // variables are captured by the methods, so only the named part of the
+  // environment is needed, and the methods only know the slots before them.
+  if (!cls.slot) {
+    d_env->define(cls.name);
+  }
+  std::shared_ptr<Environment> clsEnv = Environment::create(
+      cls.slot ? Environment::namedScope(d_env) : Environment::snapshot(d_env));
 
   // Create the class factory which will be used to create instances.
-  d_env->define(std::string(cls.name),
-                std::make_shared<ClassDefinition>(cls.name, clsEnv, super));
-
-  // Set the interpreter environment to be the class environment and add the
-  // methods
-  {
-    environmentutils::ScopedSwap swapGuard(d_env, clsEnv);
-    for (auto &m : cls.methods) {
-      std::visit(*this, *m);
-    }
+  auto clsDef = makeRef<ClassDefinition>(cls.name, clsEnv, super);
+  if (cls.slot) {
+    d_env->defineAt(*cls.slot, clsDef);
+  } else {
+    d_env->assign(cls.name, clsDef);
   }
 
-  // Now extend the current environment so variables defined after this don't
-  // get defined in the Environment captured by the Class
-  d_env = Environment::extend(d_env);
+  // Add the methods. These capture upvalues from the current environment and
+  // are bound to each instance when it's created.
+  for (auto &m : cls.methods) {
+    auto &method = std::get<Fun>(*m);
+    auto f = makeFunction(method, d_env, clsEnv);
+    f->setIsInitialiser(method.name == s_init);
+    clsEnv->define(method.name, f);
+  }
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(const For &forStmt) {
+Completion InterpreterVisitor::operator()(const For &forStmt) {
   if (forStmt.initialiser) {
     std::visit(*this, *forStmt.initialiser);
   }
 
   auto condition = [&]() {
     if (forStmt.condition) {
-      return std::visit(s_truther, std::visit(*this, *forStmt.condition));
+      return operators::isTruthy(std::visit(*this, *forStmt.condition));
     }
     // It's possible to have no condition - in that case the loop should run
     // forever
@@ -128,97 +118,140 @@ void InterpreterVisitor::operator()(const For &forStmt) {
   };
 
   while (condition()) {
-    std::visit(*this, *forStmt.body);
+    if (std::visit(*this, *forStmt.body) == Completion::RETURN) {
+      return Completion::RETURN;
+    }
     if (forStmt.incrementer) {
       std::visit(*this, *forStmt.incrementer);
     }
+    gc::maybeCollect();
   }
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(Fun &funStmt) {
-  // Create a function object and store it in the current env
-  auto f = std::make_shared<FunctionDescription>(
-      funStmt.name, d_env,
-      std::make_shared<Function>(std::move(funStmt.params),
-                                 std::move(funStmt.stmts)));
-  d_env->define(std::string(funStmt.name), f);
-
-  if (!funStmt.isMethod) {
-    // Extend scope so this function can have an Environment with only the
-    // currently defined vars for the scope. Note, methods should know about
-    // everything within the class so we don't extend in this case.
-    std::shared_ptr<Environment> scopeExt = Environment::extend(d_env);
-    std::swap(d_env, scopeExt);
-  }
-  if (funStmt.isMethod && funStmt.name == "init") {
-    f->setIsInitialiser(true);
+Completion InterpreterVisitor::operator()(Fun &funStmt) {
+  // Create a function object and store it in the current env. Methods are
+  // created by their class.
+  if (funStmt.slot) {
+    auto f = makeFunction(funStmt, d_env, Environment::namedScope(d_env));
+    d_env->defineAt(*funStmt.slot, f);
+    return Completion::NORMAL;
   }
+
+  // Declare the function before snapshotting the scope, so it can call itself
+  // but doesn't see the variables declared after it. Resolved scopes don't
+  // need snapshotting, as the resolver only gives the function the slots
+  // defined before it.
+  d_env->define(funStmt.name);
+  d_env->assign(funStmt.name,
+                makeFunction(funStmt, d_env, Environment::snapshot(d_env)));
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(const Expression &expr) {
+Completion InterpreterVisitor::operator()(const Expression &expr) {
   std::visit(*this, *expr.expr);
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(const If &ifStmt) {
+Completion InterpreterVisitor::operator()(const If &ifStmt) {
   Value evaluatedCondition = std::visit(*this, *ifStmt.condition);
-  bool isTruthy = std::visit(s_truther, evaluatedCondition);
+  bool isTruthy = operators::isTruthy(evaluatedCondition);
   if (isTruthy) {
-    std::visit(*this, *ifStmt.ifBranch);
+    return std::visit(*this, *ifStmt.ifBranch);
   } else if (ifStmt.elseBranch) {
-    std::visit(*this, *ifStmt.elseBranch);
+    return std::visit(*this, *ifStmt.elseBranch);
   }
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(const Print &print) {
+Completion InterpreterVisitor::operator()(const Print &print) {
   // Calculate expression
   Value v = std::visit(*this, *print.expr);
   // Print
-  std::cout << std::visit(s_valuePrinter, v) << std::endl;
+  std::cout << visit(s_valuePrinter, v) << std::endl;
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(const Return &ret) {
+Completion InterpreterVisitor::operator()(const Return &ret) {
+  if (ret.expr && std::holds_alternative<Call>(*ret.expr)) {
+    const Call &call = std::get<Call>(*ret.expr);
+    Value callee = std::visit(*this, *call.callee);
+    if (!canTailCall(callee)) {
+      d_returnValue = invokeValue(callee, call);
+      return Completion::RETURN;
+    }
+
+    // The args are evaluated here, but the callee is run once this function
+    // has returned
+    const FnDescShrdPtr &fnDescSPtr = callee.get<FnDescShrdPtr>();
+    std::shared_ptr<Environment> fEnv =
+        prepareCall(fnDescSPtr, call.args.size());
+    const Function &fn = *fnDescSPtr->getFunction();
+    for (int i = 0; i < call.args.size(); i++) {
+      defineArg(*fEnv, fn, i, std::visit(*this, *call.args[i]));
+    }
+    d_tailCall = {fnDescSPtr, std::move(fEnv), call.line};
+    return Completion::RETURN;
+  }
+
   Value v = {};
   if (ret.expr) {
     v = std::visit(*this, *ret.expr);
   }
-  throw ReturnEx{v};
+  d_returnValue = std::move(v);
+  return Completion::RETURN;
 }
 
-void InterpreterVisitor::operator()(const VarDecl &varDecl) {
-  auto name = std::string(varDecl.name);
+Completion InterpreterVisitor::operator()(const VarDecl &varDecl) {
   Value val = {};
   if (varDecl.expr) {
     val = std::visit(*this, *varDecl.expr);
   }
-  d_env->define(name, val);
+  if (varDecl.slot) {
+    d_env->defineAt(*varDecl.slot, std::move(val));
+  } else {
+    d_env->define(varDecl.name, std::move(val));
+  }
+  return Completion::NORMAL;
 }
 
-void InterpreterVisitor::operator()(const While &whileStmt) {
-  while (std::visit(s_truther, std::visit(*this, *whileStmt.condition))) {
-    std::visit(*this, *whileStmt.body);
+Completion InterpreterVisitor::operator()(const While &whileStmt) {
+  while (operators::isTruthy(std::visit(*this, *whileStmt.condition))) {
+    if (std::visit(*this, *whileStmt.body) == Completion::RETURN) {
+      return Completion::RETURN;
+    }
+    gc::maybeCollect();
   }
+  return Completion::NORMAL;
 }
 
-Value InterpreterVisitor::operator()(const Assign &assign) {
-  auto name = std::string(assign.name);
+Value InterpreterVisitor::operator()(Assign &assign) {
   Value val = std::visit(*this, *assign.value);
-  d_env->assign(name, val);
+  if (assign.loc && assign.loc->isGlobal) {
+    d_env->assignGlobal(assign.name, val, *d_globals, assign.cache);
+  } else {
+    assignVariable(assign.name, assign.loc, val);
+  }
   return val;
 }
 
 Value InterpreterVisitor::operator()(const Binary &bnry) {
   Value lhs = std::visit(*this, *bnry.left);
   Value rhs = std::visit(*this, *bnry.right);
+  return binary(bnry.op, lhs, rhs);
+}
 
-  switch (bnry.op.type) {
+Value InterpreterVisitor::binary(const Token &op, const Value &lhs,
+                                 const Value &rhs) {
+  switch (op.type) {
   case TokenType::PLUS:
-    return std::visit(s_adder, lhs, rhs);
+    return operators::add(lhs, rhs);
   case TokenType::MINUS:
-    return std::visit(s_subtractor, lhs, rhs);
+    return operators::subtract(lhs, rhs);
   case TokenType::STAR:
-    return std::visit(s_multiplier, lhs, rhs);
+    return operators::multiply(lhs, rhs);
   case TokenType::SLASH:
-    return std::visit(s_divider, lhs, rhs);
+    return operators::divide(lhs, rhs);
   case TokenType::EQUAL_EQUAL:
     return lhs == rhs;
   case TokenType::BANG_EQUAL:
@@ -233,115 +266,189 @@ Value InterpreterVisitor::operator()(const Binary &bnry) {
     return lhs <= rhs;
   default:
     throw InterpretException("Unable to interpret binary op: " +
-                             tokenutils::tokenTypeToStr(bnry.op.type));
+                             tokenutils::tokenTypeToStr(op.type));
   }
 }
 
 Value InterpreterVisitor::invoke(const FnDescShrdPtr &fnDescSPtr,
                                  const Call &call) {
+  std::shared_ptr<Environment> fEnv = prepareCall(fnDescSPtr, call.args.size());
+  const Function &fn = *fnDescSPtr->getFunction();
+  for (int i = 0; i < call.args.size(); i++) {
+    defineArg(*fEnv, fn, i, std::visit(*this, *call.args[i]));
+  }
+  return finishCall(fnDescSPtr, fEnv, call.line);
+}
+
+std::shared_ptr<Environment>
+InterpreterVisitor::prepareCall(const FnDescShrdPtr &fnDescSPtr, int numArgs) {
   if (!fnDescSPtr) {
     throw InterpretException(
         "Internal error! Function closure pointer is null!");
   }
-  auto fnSPtr = fnDescSPtr->getFunction();
+  const auto &fnSPtr = fnDescSPtr->getFunction();
   if (!fnSPtr) {
     throw InterpretException("Internal error! Function pointer is null!");
   }
 
   // Check if the number of args matches the callee args
-  if (call.args.size() != fnSPtr->getArity()) {
+  if (numArgs != fnSPtr->getArity()) {
     std::ostringstream ss;
-    ss << "Tried to call " << fnDescSPtr->getName() << " with "
-       << call.args.size() << " args when function accepts "
-       << fnSPtr->getArity() << " args.";
+    ss << "Tried to call " << fnDescSPtr->getName() << " with " << numArgs
+       << " args when function accepts " << fnSPtr->getArity() << " args.";
     throw InterpretException(ss.str());
   }
 
+  // Calls and loop iterations are where garbage can build up, and everything
+  // the interpreter holds here is reference counted
+  gc::maybeCollect();
+
   // Create a new environment for the func to execute in
-  std::shared_ptr<Environment> fEnv =
-      Environment::create(fnDescSPtr->getClosure());
+  return Environment::create(fnDescSPtr->getClosure(), fnSPtr->getNumSlots());
+}
 
-  // Set args in new environment
-  const std::vector<std::string_view> &fArgNames = fnSPtr->getArgNames();
-  for (int i = 0; i < call.args.size(); i++) {
-    Value v = std::visit(*this, *call.args[i]);
-    fEnv->define(std::string(fArgNames[i]), v);
+void InterpreterVisitor::defineArg(Environment &fEnv, const Function &fn,
+                                   int idx, Value v) {
+  // If the function has been resolved the args are the first slots
+  if (fn.getNumSlots()) {
+    fEnv.defineAt(idx, std::move(v));
+  } else {
+    fEnv.define(fn.getArgNames()[idx], std::move(v));
   }
+}
 
+Value InterpreterVisitor::finishCall(const FnDescShrdPtr &fnDescSPtr,
+                                     std::shared_ptr<Environment> &fEnv,
+                                     int line) {
   // Update environment to be the environment of the function, and swap back on
   // destruction
   environmentutils::ScopedSwap swapGuard(d_env, fEnv);
 
-  // Special behaviour for initialisers - always return "this"
-  if (fnDescSPtr->isInitialiser()) {
-    Value _this = fnDescSPtr->getClosure()->get("this");
-    try {
-      fnSPtr->execute(d_env, *this);
-    } catch (ReturnEx &ex) {
-      if (!std::holds_alternative<std::monostate>(ex.d_val)) {
-        throw InterpretException(
-            "No explicit return allowed from a class initialiser");
+  // Pass execution to function. This gives back the value of the user's return
+  // statement, or null if there isn't one.
+  FunctionDescription *caller = d_function;
+  FunctionDescription *fnDesc = fnDescSPtr.get();
+  // Holds the function tail called last, as nothing else may
+  FnDescShrdPtr tailCalled;
+  Value result;
+  {
+    Profiler::ScopedCall profiled(d_profiler, *fnDesc, line);
+    while (true) {
+      d_function = fnDesc;
+      result = fnDesc->getFunction()->execute(d_env, *this);
+      if (!d_tailCall.fn) {
+        break;
+      }
+
+      // The function returned a call, which replaces it, dropping its
+      // Environment
+      tailCalled = std::move(d_tailCall.fn);
+      fnDesc = tailCalled.get();
+      d_env = std::move(d_tailCall.env);
+      if (d_profiler) {
+        d_profiler->tailCall(*fnDesc, d_tailCall.line);
       }
     }
-    return _this;
   }
+  d_function = caller;
+  return callResult(*fnDesc, std::move(result));
+}
 
-  try {
-    // Pass execution to function. If the user has written a return statement it
-    // will throw and be caught below
-    return fnSPtr->execute(d_env, *this);
-  } catch (ReturnEx &ex) {
-    return ex.d_val;
+Value InterpreterVisitor::callResult(FunctionDescription &fnDesc,
+                                     Value returned) {
+  // Special behaviour for initialisers - always return "this"
+  if (fnDesc.isInitialiser()) {
+    if (!returned.is<std::monostate>()) {
+      throw InterpretException(
+          "No explicit return allowed from a class initialiser");
+    }
+    return fnDesc.getClosure()->get(s_this);
+  }
+  return returned;
+}
+
+bool InterpreterVisitor::canTailCall(const Value &callee) const {
+  return d_function && !d_function->isInitialiser() &&
+         callee.is<FnDescShrdPtr>();
+}
+
+FnDescShrdPtr
+InterpreterVisitor::makeFunction(Fun &funStmt,
+                                 const std::shared_ptr<Environment> &scope,
+                                 std::shared_ptr<Environment> closure) {
+  // The body is moved out of the AST the first time the declaration runs and
+  // shared by every function created from it
+  if (!funStmt.function) {
+    funStmt.function = std::make_shared<Function>(
+        std::move(funStmt.params), std::move(funStmt.stmts), funStmt.numSlots);
   }
+  return makeFunction(funStmt.name, funStmt.function, funStmt.upvalues, scope,
+                      std::move(closure));
+}
+
+FnDescShrdPtr InterpreterVisitor::makeFunction(
+    std::string_view name, std::shared_ptr<const Function> fn,
+    const std::vector<VarLocation> &upvalueLocs,
+    const std::shared_ptr<Environment> &scope,
+    std::shared_ptr<Environment> closure) {
+  // Capture the variables the function uses from enclosing functions
+  std::vector<Ref<Upvalue>> upvalues;
+  upvalues.reserve(upvalueLocs.size());
+  for (const VarLocation &loc : upvalueLocs) {
+    if (loc.isUpvalue) {
+      upvalues.push_back(d_function->getUpvalue(loc.slot));
+    } else {
+      upvalues.push_back(scope->capture(loc));
+    }
+  }
+  return makeRef<FunctionDescription>(name, std::move(closure), std::move(fn),
+                                      std::move(upvalues));
 }
 
 Value InterpreterVisitor::invoke(const ClsDefShrdPtr &clsDefSPtr,
                                  const Call &call) {
+  ClsInstShrdPtr leafClass = instantiate(clsDefSPtr);
+  if (clsDefSPtr->getClosure()->isVarInScope(s_init)) {
+    invoke(leafClass->getClosure()->get(s_init).get<FnDescShrdPtr>(), call);
+  }
+  return leafClass;
+}
+
+ClsInstShrdPtr
+InterpreterVisitor::instantiate(const ClsDefShrdPtr &clsDefSPtr) {
   if (!clsDefSPtr) {
     throw InterpretException("Internal error! Class factory pointer is null!");
   }
+  gc::maybeCollect();
 
   // Create class instance for every class in the heirarchy. This gives each
   // level of the heirarchy its own environment so methods can be shadowed.
   auto currDef = clsDefSPtr;
-  std::shared_ptr<ClassInstance> currClass;
-  std::shared_ptr<ClassInstance> childOfCurrent;
-  std::shared_ptr<ClassInstance> leafClass;
+  ClsInstShrdPtr currClass;
+  ClsInstShrdPtr childOfCurrent;
+  ClsInstShrdPtr leafClass;
   do {
-    // Copy the functions from the Definition into a new environment.
-    auto currEnv =
-        std::shared_ptr<Environment>(new Environment(*currDef->getClosure()));
-    for (const auto &[k, v] : *currEnv) {
-      auto fnDefCopy =
-          std::make_shared<FunctionDescription>(*std::get<FnDescShrdPtr>(v));
-      // Bind the current environment to the function so the member function can
-      // be stored in a variable outside the class.
-      fnDefCopy->getClosure() = currEnv;
-      currEnv->assign(k, fnDefCopy);
-    }
+    // The instance only holds fields. Methods stay in the class, and are bound
+    // to the instance when they're accessed.
+    auto currEnv = Environment::createInstance(currDef->getClosure());
 
     // Create ClassInstance for the current class in the heirarchy.
-    currClass = std::make_shared<ClassInstance>(currDef->getName(), currEnv);
+    currClass = makeRef<ClassInstance>(currDef->getName(), currEnv);
     if (!leafClass) {
       leafClass = currClass;
     }
     // Link the heirarchy together through 'this' and 'super'. Note, 'this'
     // should always apply to the leaf class so that function calls in all
     // levels access/update the same variables.
-    currEnv->define("this", leafClass);
+    currEnv->define(s_this, leafClass);
     if (childOfCurrent) {
-      childOfCurrent->getClosure()->define("super", currClass);
+      childOfCurrent->getClosure()->define(s_super, currClass);
     }
 
     // Prepare next iteration
     childOfCurrent = currClass;
     currDef = currDef->getSuper();
   } while (currDef);
-
-  if (leafClass->getClosure()->isVarInScope("init")) {
-    invoke(std::get<FnDescShrdPtr>(leafClass->getClosure()->get("init")), call);
-  }
-
   return leafClass;
 }
 
@@ -349,29 +456,36 @@ Value InterpreterVisitor::operator()(const Call &call) {
   // Evaluate the callee. Normally this would just be a function name, but
   // in chains we may need to evaluate a preceeding function i.e. fn(1)(2);
   Value callee = std::visit(*this, *call.callee);
+  return invokeValue(callee, call);
+}
 
-  if (std::holds_alternative<FnDescShrdPtr>(callee)) {
-    return invoke(std::get<FnDescShrdPtr>(callee), call);
-  } else if (std::holds_alternative<ClsDefShrdPtr>(callee)) {
-    return invoke(std::get<ClsDefShrdPtr>(callee), call);
+Value InterpreterVisitor::invokeValue(const Value &callee, const Call &call) {
+  if (callee.is<FnDescShrdPtr>()) {
+    return invoke(callee.get<FnDescShrdPtr>(), call);
+  } else if (callee.is<ClsDefShrdPtr>()) {
+    return invoke(callee.get<ClsDefShrdPtr>(), call);
   } else {
     throw InterpretException("Tried to call non callable object " +
-                             std::visit(s_valuePrinter, callee));
+                             visit(s_valuePrinter, callee));
   }
 }
 
-Value InterpreterVisitor::operator()(const Get &get) {
+Value InterpreterVisitor::operator()(Get &get) {
   // Retrieve the object we're getting from. Normally this would just be a class
   // instance, but we may need to evaluate a function call before we can access
   // the object i.e. getCreationFactory().create()
   Value obj = std::visit(*this, *get.object);
-  if (!std::holds_alternative<ClsInstShrdPtr>(obj)) {
+  return getProperty(get, obj);
+}
+
+Value InterpreterVisitor::getProperty(Get &get, const Value &obj) {
+  if (!obj.is<ClsInstShrdPtr>()) {
     throw InterpretException("Tried to get a property on non class instance " +
-                             std::visit(s_valuePrinter, obj));
+                             visit(s_valuePrinter, obj));
   }
 
-  auto clsInst = std::get<ClsInstShrdPtr>(obj);
-  return clsInst->getClosure()->get(std::string(get.property));
+  auto clsInst = obj.get<ClsInstShrdPtr>();
+  return clsInst->getClosure()->getProperty(get.property, get.cache);
 }
 
 Value InterpreterVisitor::operator()(const Grouping &grp) {
@@ -397,6 +511,12 @@ double getNum(const Literal &ltrl) {
 } // namespace
 
 Value InterpreterVisitor::operator()(const Literal &ltrl) {
+  // The parser decodes literals up front. Only literals built by hand need
+  // decoding here.
+  if (ltrl.constant) {
+    return *ltrl.constant;
+  }
+
   switch (ltrl.type) {
   case TokenType::STRING:
     return std::string(ltrl.value);
@@ -415,88 +535,99 @@ Value InterpreterVisitor::operator()(const Literal &ltrl) {
   }
 }
 
-Value InterpreterVisitor::operator()(const Set &set) {
+Value InterpreterVisitor::operator()(Set &set) {
   Value obj = std::visit(*this, *set.object);
-  if (!std::holds_alternative<ClsInstShrdPtr>(obj)) {
+  checkCanSet(obj);
+  Value val = std::visit(*this, *set.value);
+  setProperty(set, obj, std::move(val));
+  return {};
+}
+
+void InterpreterVisitor::checkCanSet(const Value &obj) {
+  if (!obj.is<ClsInstShrdPtr>()) {
     throw InterpretException("Tried to set a property on non class instance " +
-                             std::visit(s_valuePrinter, obj));
+                             visit(s_valuePrinter, obj));
   }
+}
 
-  Value val = std::visit(*this, *set.value);
-  if (std::holds_alternative<FnDescShrdPtr>(val)) {
+void InterpreterVisitor::setProperty(Set &set, const Value &obj, Value val) {
+  if (val.is<FnDescShrdPtr>()) {
     FnDescShrdPtr fnCopy =
-        std::make_shared<FunctionDescription>(*std::get<FnDescShrdPtr>(val));
+        makeRef<FunctionDescription>(*val.get<FnDescShrdPtr>());
     fnCopy->setName(set.property);
-    fnCopy->setIsInitialiser(set.property == "init");
+    fnCopy->setIsInitialiser(set.property == s_init);
     val = fnCopy;
   }
-  std::get<ClsInstShrdPtr>(obj)->getClosure()->upsertInScope(
-      std::string(set.property), val);
-  return {};
+  obj.get<ClsInstShrdPtr>()->getClosure()->setProperty(
+      set.property, std::move(val), set.cache);
 }
 
 Value InterpreterVisitor::operator()(const Unary &unry) {
   Value right = std::visit(*this, *unry.right);
-  switch (unry.op.type) {
-  case TokenType::MINUS: {
-    Value zero = 0.0;
-    return std::visit(s_subtractor, zero, right);
-  }
+  return unary(unry.op, right);
+}
+
+Value InterpreterVisitor::unary(const Token &op, const Value &right) {
+  switch (op.type) {
+  case TokenType::MINUS:
+    return operators::subtract(0.0, right);
   case TokenType::BANG:
-    return !std::visit(s_truther, right);
+    return !operators::isTruthy(right);
   default:
     throw InterpretException("Unable to interpret unary op: " +
-                             tokenutils::tokenTypeToStr(unry.op.type));
+                             tokenutils::tokenTypeToStr(op.type));
   }
 }
 
-Value InterpreterVisitor::operator()(const Variable &var) {
-  return d_env->get(std::string(var.name));
-}
-
-Value AdditionVisitor::operator()(double l, double r) { return l + r; }
-
-Value AdditionVisitor::operator()(std::string &l, std::string &r) {
-  return l + r;
-}
-
-Value AdditionVisitor::operator()(auto &&l, auto &&r) {
-  throw InterpretException(
-      "Unable to add types: " + std::string(typeid(l).name()) + " and " +
-      std::string(typeid(r).name()));
+Value InterpreterVisitor::operator()(Variable &var) {
+  if (var.loc && var.loc->isGlobal) {
+    return d_env->getGlobal(var.name, *d_globals, var.cache);
+  }
+  return getVariable(var.name, var.loc);
 }
 
-double SubtractionVisitor::operator()(double l, double r) { return l - r; }
+Value InterpreterVisitor::getVariable(const Symbol &name,
+                                      const std::optional<VarLocation> &loc) {
+  if (!loc || loc->isGlobal) {
+    return d_env->get(name);
+  } else if (!loc->isUpvalue) {
+    return d_env->getAt(*loc, name);
+  }
 
-double SubtractionVisitor::operator()(auto &&l, auto &&r) {
-  throw InterpretException(
-      "Unable to subtract types: " + std::string(typeid(l).name()) + " and " +
-      std::string(typeid(r).name()));
+  // Class instances the function is defined in shadow upvalues
+  if (loc->shadowingScopes) {
+    Environment *instance =
+        d_function->getClosure()->findShadowing(name, loc->shadowingScopes);
+    if (instance) {
+      return instance->get(name);
+    }
+  }
+  return d_function->getUpvalue(loc->slot)->get();
 }
 
-double MultiplyVisitor::operator()(double l, double r) { return l * r; }
+void InterpreterVisitor::assignVariable(const Symbol &name,
+                                        const std::optional<VarLocation> &loc,
+                                        const Value &v) {
+  if (!loc || loc->isGlobal) {
+    d_env->assign(name, v);
+    return;
+  } else if (!loc->isUpvalue) {
+    d_env->assignAt(*loc, name, v);
+    return;
+  }
 
-double MultiplyVisitor::operator()(auto &&l, auto &&r) {
-  throw InterpretException(
-      "Unable to multiply types: " + std::string(typeid(l).name()) + " and " +
-      std::string(typeid(r).name()));
+  if (loc->shadowingScopes) {
+    Environment *instance =
+        d_function->getClosure()->findShadowing(name, loc->shadowingScopes);
+    if (instance) {
+      instance->assign(name, v);
+      return;
+    }
+  }
+  d_function->getUpvalue(loc->slot)->set(v);
 }
 
-double DivideVisitor::operator()(double l, double r) { return l / r; }
-
-double DivideVisitor::operator()(auto &&l, auto &&r) {
-  throw InterpretException(
-      "Unable to divide types: " + std::string(typeid(l).name()) + " and " +
-      std::string(typeid(r).name()));
-};
-
-bool TruthyVisitor::operator()(std::monostate) { return false; }
-
-bool TruthyVisitor::operator()(bool b) { return b; }
-
-bool TruthyVisitor::operator()(double d) { return static_cast<bool>(d); }
-
-bool TruthyVisitor::operator()(auto &&) { return true; }
+Value InterpreterVisitor::takeReturnValue() { return std::move(d_returnValue); }
 
 } // namespace treewalk
 } // namespace plox
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <environment.h>
 #include <errs.h>
+#include <profiler.h>
 #include <stmt.h>
 
 #include <vector>
@@ -10,41 +11,114 @@
 namespace plox {
 namespace treewalk {
 
-// The entrypoint to Lox
+class Function;
+namespace closure {
+class Compiler;
+}
+namespace stack {
+class Evaluator;
+}
+
+// The entrypoint to Lox. Calls are timed by the profiler when one is given.
 void interpret(std::vector<stmt::Stmt> &stmts,
                std::shared_ptr<Environment> &env,
-               std::vector<InterpretException> &errs);
+               std::vector<InterpretException> &errs,
+               Profiler *profiler = nullptr);
+
+// How a statement finished running. Once a statement returns, the statements
+// enclosing it stop running and pass RETURN up to the function call, which
+// takes the returned value from the interpreter.
+enum class Completion { NORMAL, RETURN };
 
 // Visitors are defined for each interpret operation.
 struct InterpreterVisitor {
-  InterpreterVisitor(std::shared_ptr<Environment> &env);
-
-  // Statements do not need to return anything
-  void operator()(const stmt::Block &blk);
-  void operator()(const stmt::Class &cls);
-  void operator()(const stmt::Expression &expr);
-  void operator()(const stmt::For &forStmt);
-  void operator()(stmt::Fun &funStmt);
-  void operator()(const stmt::If &ifStmt);
-  void operator()(const stmt::Print &print);
-  void operator()(const stmt::Return &ret);
-  void operator()(const stmt::VarDecl &varDecl);
-  void operator()(const stmt::While &whileStmt);
+  InterpreterVisitor(std::shared_ptr<Environment> &env,
+                     Profiler *profiler = nullptr);
+
+  // Statements report whether they ran to the end or returned
+  Completion operator()(const stmt::Block &blk);
+  Completion operator()(const stmt::Class &cls);
+  Completion operator()(const stmt::Expression &expr);
+  Completion operator()(const stmt::For &forStmt);
+  Completion operator()(stmt::Fun &funStmt);
+  Completion operator()(const stmt::If &ifStmt);
+  Completion operator()(const stmt::Print &print);
+  Completion operator()(const stmt::Return &ret);
+  Completion operator()(const stmt::VarDecl &varDecl);
+  Completion operator()(const stmt::While &whileStmt);
   // Other operations called by statements return Values
-  Value operator()(const ast::Assign &assign);
+  Value operator()(ast::Assign &assign);
   Value operator()(const ast::Binary &bin);
   Value operator()(const ast::Call &call);
-  Value operator()(const ast::Get &get);
+  Value operator()(ast::Get &get);
   Value operator()(const ast::Grouping &grp);
   Value operator()(const ast::Literal &ltrl);
-  Value operator()(const ast::Set &set);
+  Value operator()(ast::Set &set);
   Value operator()(const ast::Unary &unary);
-  Value operator()(const ast::Variable &var);
+  Value operator()(ast::Variable &var);
+
+  // The value given by the last return statement, which is cleared by taking it
+  Value takeReturnValue();
 
 private:
+  // The closure and stack engines run on the same state, calling into the
+  // steps below
+  friend class closure::Compiler;
+  friend class stack::Evaluator;
+
+  static Value binary(const Token &op, const Value &lhs, const Value &rhs);
+  static Value unary(const Token &op, const Value &right);
+  Value getProperty(ast::Get &get, const Value &obj);
+  // Properties can only be set on instances, which is checked before the
+  // value is evaluated
+  static void checkCanSet(const Value &obj);
+  void setProperty(ast::Set &set, const Value &obj, Value val);
+
   Value invoke(const FnDescShrdPtr &fnSPtr, const ast::Call &call);
   Value invoke(const ClsDefShrdPtr &factSPtr, const ast::Call &call);
+  Value invokeValue(const Value &callee, const ast::Call &call);
+  // A call is split into checking the arity and creating the Environment the
+  // args are defined in, then running the function in it
+  std::shared_ptr<Environment> prepareCall(const FnDescShrdPtr &fnSPtr,
+                                           int numArgs);
+  static void defineArg(Environment &fEnv, const Function &fn, int idx,
+                        Value v);
+  Value finishCall(const FnDescShrdPtr &fnSPtr,
+                   std::shared_ptr<Environment> &fEnv, int line);
+  // The value a call gives back, which for initialisers is always 'this'
+  static Value callResult(FunctionDescription &fnDesc, Value returned);
+  // Whether a return statement can leave calling 'callee' to the call it
+  // returns from. Initialisers return 'this', so they can't.
+  bool canTailCall(const Value &callee) const;
+  // Creates an instance for each class in the hierarchy, returning the leaf
+  ClsInstShrdPtr instantiate(const ClsDefShrdPtr &factSPtr);
+  // Creates a function that captures its upvalues from 'scope'
+  FnDescShrdPtr makeFunction(stmt::Fun &funStmt,
+                             const std::shared_ptr<Environment> &scope,
+                             std::shared_ptr<Environment> closure);
+  FnDescShrdPtr makeFunction(std::string_view name,
+                             std::shared_ptr<const Function> fn,
+                             const std::vector<VarLocation> &upvalues,
+                             const std::shared_ptr<Environment> &scope,
+                             std::shared_ptr<Environment> closure);
+  Value getVariable(const Symbol &name, const std::optional<VarLocation> &loc);
+  void assignVariable(const Symbol &name,
+                      const std::optional<VarLocation> &loc, const Value &v);
   std::shared_ptr<Environment> d_env;
+  // The top level scope, which holds the globals the resolver finds
+  Environment *d_globals;
+  // The function being run, which holds the upvalues. Null at the top level.
+  FunctionDescription *d_function;
+  Value d_returnValue;
+  // A call whose result is returned. The call being returned from runs it in
+  // place of its own function, so tail calls don't grow the C++ stack.
+  struct TailCall {
+    FnDescShrdPtr fn;
+    std::shared_ptr<Environment> env;
+    int line;
+  };
+  TailCall d_tailCall;
+  Profiler *d_profiler;
 };
 
 } // namespace treewalk
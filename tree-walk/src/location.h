@@ -0,0 +1,39 @@
+#ifndef TREEWALK_LOCATION_H
+#define TREEWALK_LOCATION_H
+
+#include <cstdint>
+
+namespace plox {
+namespace treewalk {
+
+// Where a variable lives relative to the Environment it is accessed from. This
+// is calculated by the resolver before the code is interpreted.
+struct VarLocation {
+  int depth; // Number of parent Environments to walk up
+  int slot;  // Index into the slots of that Environment
+  // Variables declared outside the running function are captured as upvalues.
+  // The slot then indexes the function's upvalues and the depth is unused.
+  bool isUpvalue = false;
+  // Number of class instances between the access and the declaration, whose
+  // fields shadow the variable
+  int shadowingScopes = 0;
+  // Variables declared in the top level scope are globals, which are looked
+  // up by name. The depth and slot are unused. Globals that class instances
+  // may shadow aren't given a location at all.
+  bool isGlobal = false;
+
+  bool operator==(const VarLocation &other) const = default;
+};
+
+// Where an access last found a global. The globals' layout version changes
+// whenever a name is declared in them and is never reused, so the index is
+// only used while the version matches.
+struct GlobalCache {
+  std::uint64_t layoutVersion = 0;
+  int index = 0;
+};
+
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -2,27 +2,70 @@
 #include <fstream>
 #include <iostream>
 #include <list>
+#include <memory>
 #include <optional>
 
 #include <ast_printer.h>
+#include <closure_compiler.h>
 #include <func_native.h>
+#include <gc.h>
 #include <interpreter.h>
+#include <optimiser.h>
 #include <parser.h>
+#include <profiler.h>
+#include <resolver.h>
 #include <scanner.h>
+#include <stack_evaluator.h>
+#include <stmt_printer.h>
+#include <vm.h>
 
 namespace plox {
 namespace treewalk {
 
+enum class Engine { TREE_WALK, CLOSURE, STACK, VM };
+
+struct RunOptions {
+  Engine engine;
+  bool optimise;
+  bool dumpAst;
+  bool gcStats;
+  // Set when the tree-walk, closure or stack engine should time each call
+  Profiler *profiler;
+  // The bytes the stack engine's and the VM's stacks may grow to
+  std::size_t stackBudget;
+};
+
 namespace {
 auto s_globals = Environment::create();
-}
+std::unique_ptr<vm::VM> s_vm;
+// Folded literals are referenced by functions that outlive a single run
+std::list<std::string> s_constants;
+} // namespace
 
 void initNativeFuncs(std::shared_ptr<Environment> env) {
   nativefunc::addClock(env);
   nativefunc::addVersion(env);
 }
 
-int run(const std::string &buff) {
+void printGcStats() {
+  if (s_vm) {
+    // The VM's collector only counts its collections
+    std::cerr << "GC collections: " << s_vm->getNumCollections() << std::endl;
+    return;
+  }
+  using std::chrono::duration;
+  const gc::Stats &stats = gc::stats();
+  std::cerr << "GC collections: " << stats.numCollections << "\n"
+            << "GC objects freed: " << stats.numFreed << "\n"
+            << "GC objects live: " << gc::numObjects() << "\n"
+            << "GC total pause ms: "
+            << duration<double, std::milli>(stats.totalPause).count() << "\n"
+            << "GC max pause ms: "
+            << duration<double, std::milli>(stats.maxPause).count()
+            << std::endl;
+}
+
+int run(const std::string &buff, const RunOptions &opts) {
   // Scan
   std::vector<SyntaxException> syntErrs;
   auto tokens = scanTokens(buff, syntErrs);
@@ -43,9 +86,38 @@ int run(const std::string &buff) {
     return -2;
   }
 
+  // Optimise
+  if (opts.optimise) {
+    optimise(stmts, s_constants);
+  }
+  if (opts.dumpAst) {
+    for (auto &s : stmts) {
+      std::cout << std::visit(stmt::PrinterVisitor{}, s) << std::endl;
+    }
+  }
+
+  // Resolve
+  std::vector<ResolveException> resolveErrs;
+  resolve(stmts, resolveErrs);
+  if (resolveErrs.size()) {
+    for (auto &err : resolveErrs) {
+      std::cerr << "Resolve error: " << err << std::endl;
+    }
+    return -4;
+  }
+
   // Interpret
   std::vector<InterpretException> interpErrs;
-  interpret(stmts, s_globals, interpErrs);
+  if (opts.engine == Engine::VM) {
+    vm::interpret(stmts, *s_vm, interpErrs);
+  } else if (opts.engine == Engine::CLOSURE) {
+    closure::interpret(stmts, s_globals, interpErrs, opts.profiler);
+  } else if (opts.engine == Engine::STACK) {
+    stack::interpret(stmts, s_globals, interpErrs, opts.profiler,
+                     opts.stackBudget);
+  } else {
+    interpret(stmts, s_globals, interpErrs, opts.profiler);
+  }
   if (interpErrs.size()) {
     for (auto &err : interpErrs) {
       std::cerr << "Interpreter error: " << err << std::endl;
@@ -56,7 +128,7 @@ int run(const std::string &buff) {
   return 0;
 }
 
-int runFile(const std::string &script) {
+int runFile(const std::string &script, const RunOptions &opts) {
   std::ifstream file(script);
   if (!file) {
     std::cerr << "Could not open file: " << script << std::endl;
@@ -67,7 +139,7 @@ int runFile(const std::string &script) {
   ss << file.rdbuf();
   int rc = 0;
   try {
-    rc = run(ss.str());
+    rc = run(ss.str(), opts);
   } catch (const std::exception &ex) {
     // TODO: error handling. Print?
     return 65;
@@ -75,10 +147,10 @@ int runFile(const std::string &script) {
   return rc;
 }
 
-int runCmds(const std::string &cmds) {
+int runCmds(const std::string &cmds, const RunOptions &opts) {
   int rc = 0;
   try {
-    rc = run(cmds);
+    rc = run(cmds, opts);
   } catch (const std::exception &ex) {
     // TODO: error handling. Print?
     return 65;
@@ -86,7 +158,7 @@ int runCmds(const std::string &cmds) {
   return rc;
 }
 
-int runRepl() {
+int runRepl(const RunOptions &opts) {
   // Design heavily relies on string_view. We must keep user inputs around and
   // at the same memory address
   std::list<std::string> userInputs;
@@ -95,7 +167,7 @@ int runRepl() {
     getline(std::cin, uInput);
     userInputs.push_back(std::move(uInput));
     try {
-      run(userInputs.back());
+      run(userInputs.back(), opts);
     } catch (const std::exception &ex) {
       // TODO: error handling. Print?
     }
@@ -120,19 +192,72 @@ int main(int argc, char **argv) {
   script_option->excludes(cmds_option);
   cmds_option->excludes(script_option);
 
+  std::string engineName = "tree-walk";
+  app.add_option("--engine", engineName,
+                 "The engine to run code with. 'closure' compiles to C++ "
+                 "closures, 'stack' walks the tree from an explicit stack, "
+                 "'vm' compiles to bytecode")
+      ->check(CLI::IsMember({"tree-walk", "closure", "stack", "vm"}));
+  std::size_t stackBudgetMb =
+      plox::treewalk::stack::k_defaultStackBudget / (1024 * 1024);
+  app.add_option("--stack-budget", stackBudgetMb,
+                 "The MB the stack engine's and the vm's stacks may use "
+                 "before a stack overflow error")
+      ->check(CLI::PositiveNumber);
+  bool noOpt = false;
+  app.add_flag("--no-opt", noOpt,
+               "Skip constant folding and dead code removal");
+  bool dumpAst = false;
+  app.add_flag("--dump-ast", dumpAst,
+               "Print the statements after optimisation, before running them");
+  bool gcStats = false;
+  app.add_flag("--gc-stats", gcStats,
+               "Print the garbage collector's stats on exit. The vm only "
+               "counts its collections");
+  std::optional<std::string> profilePath;
+  app.add_option("--profile", profilePath,
+                 "Write the time spent in each Lox call stack to a file, as "
+                 "folded stacks for flamegraph tools");
+
   CLI11_PARSE(app, argc, argv);
 
   // Route to desired behaviour
   using namespace plox::treewalk;
-  initNativeFuncs(s_globals);
+  Engine engine = engineName == "vm"        ? Engine::VM
+                  : engineName == "closure" ? Engine::CLOSURE
+                  : engineName == "stack"   ? Engine::STACK
+                                            : Engine::TREE_WALK;
+  RunOptions opts{engine,  !noOpt,  dumpAst,
+                  gcStats, nullptr, stackBudgetMb * 1024 * 1024};
+  std::unique_ptr<Profiler> profiler;
+  if (profilePath) {
+    if (opts.engine == Engine::VM) {
+      std::cerr << "--profile isn't supported by the vm engine" << std::endl;
+      return 1;
+    }
+    profiler = std::make_unique<Profiler>();
+    opts.profiler = profiler.get();
+  }
+  if (opts.engine == Engine::VM) {
+    s_vm = std::make_unique<vm::VM>(opts.stackBudget);
+  } else {
+    initNativeFuncs(s_globals);
+  }
   int rc = 0;
   if (script) {
-    rc = runFile(script.value());
+    rc = runFile(script.value(), opts);
   } else if (commands) {
-    rc = runCmds(commands.value());
+    rc = runCmds(commands.value(), opts);
   } else {
-    rc = runRepl();
+    rc = runRepl(opts);
   }
 
+  if (opts.gcStats) {
+    printGcStats();
+  }
+  if (profiler) {
+    std::ofstream profile(profilePath.value());
+    profiler->writeFolded(profile);
+  }
   return rc;
 }
\ No newline at end of file
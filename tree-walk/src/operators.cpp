@@ -0,0 +1,93 @@
+#include <operators.h>
+
+#include <errs.h>
+
+#include <string>
+#include <typeinfo>
+
+namespace plox {
+namespace treewalk {
+namespace operators {
+
+namespace {
+struct AdditionVisitor {
+  Value operator()(double l, double r);
+  Value operator()(auto &&l, auto &&r);
+} s_adder;
+
+struct SubtractionVisitor {
+  double operator()(double l, double r);
+  double operator()(auto &&l, auto &&r);
+} s_subtractor;
+
+struct MultiplyVisitor {
+  double operator()(double l, double r);
+  double operator()(auto &&l, auto &&r);
+} s_multiplier;
+
+struct DivideVisitor {
+  double operator()(double l, double r);
+  double operator()(auto &&l, auto &&r);
+} s_divider;
+} // namespace
+
+namespace generic {
+
+Value add(const Value &l, const Value &r) {
+  // Strings are joined without copying them, as scripts often build a string
+  // up by adding to it in a loop
+  if (l.is<std::string>() && r.is<std::string>()) {
+    return concat(l, r);
+  }
+  return visit(s_adder, l, r);
+}
+
+double subtract(const Value &l, const Value &r) {
+  return visit(s_subtractor, l, r);
+}
+
+double multiply(const Value &l, const Value &r) {
+  return visit(s_multiplier, l, r);
+}
+
+double divide(const Value &l, const Value &r) {
+  return visit(s_divider, l, r);
+}
+
+} // namespace generic
+
+Value AdditionVisitor::operator()(double l, double r) { return l + r; }
+
+Value AdditionVisitor::operator()(auto &&l, auto &&r) {
+  throw InterpretException(
+      "Unable to add types: " + std::string(typeid(l).name()) + " and " +
+      std::string(typeid(r).name()));
+}
+
+double SubtractionVisitor::operator()(double l, double r) { return l - r; }
+
+double SubtractionVisitor::operator()(auto &&l, auto &&r) {
+  throw InterpretException(
+      "Unable to subtract types: " + std::string(typeid(l).name()) + " and " +
+      std::string(typeid(r).name()));
+}
+
+double MultiplyVisitor::operator()(double l, double r) { return l * r; }
+
+double MultiplyVisitor::operator()(auto &&l, auto &&r) {
+  throw InterpretException(
+      "Unable to multiply types: " + std::string(typeid(l).name()) + " and " +
+      std::string(typeid(r).name()));
+}
+
+double DivideVisitor::operator()(double l, double r) { return l / r; }
+
+double DivideVisitor::operator()(auto &&l, auto &&r) {
+  throw InterpretException(
+      "Unable to divide types: " + std::string(typeid(l).name()) + " and " +
+      std::string(typeid(r).name()));
+};
+
+} // namespace operators
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,70 @@
+#ifndef TREEWALK_OPERATORS_H
+#define TREEWALK_OPERATORS_H
+
+#include <value.h>
+
+namespace plox {
+namespace treewalk {
+namespace operators {
+
+// The arithmetic and truthiness rules of Lox, shared by the tree walk and
+// closure engines so both report the same errors. Operations on types they
+// don't apply to throw an InterpretException naming the types.
+//
+// Numbers are checked for with a single test of both operands and handled
+// inline. Anything else goes through the visitors in 'generic'.
+
+namespace generic {
+Value add(const Value &l, const Value &r);
+double subtract(const Value &l, const Value &r);
+double multiply(const Value &l, const Value &r);
+double divide(const Value &l, const Value &r);
+} // namespace generic
+
+inline Value add(const Value &l, const Value &r) {
+  if (l.isNumber() && r.isNumber()) {
+    return l.asNumber() + r.asNumber();
+  }
+  return generic::add(l, r);
+}
+
+inline double subtract(const Value &l, const Value &r) {
+  if (l.isNumber() && r.isNumber()) {
+    return l.asNumber() - r.asNumber();
+  }
+  return generic::subtract(l, r);
+}
+
+inline double multiply(const Value &l, const Value &r) {
+  if (l.isNumber() && r.isNumber()) {
+    return l.asNumber() * r.asNumber();
+  }
+  return generic::multiply(l, r);
+}
+
+inline double divide(const Value &l, const Value &r) {
+  if (l.isNumber() && r.isNumber()) {
+    return l.asNumber() / r.asNumber();
+  }
+  return generic::divide(l, r);
+}
+
+// Only nil, false and zero are falsey
+inline bool isTruthy(const Value &v) {
+  switch (v.type()) {
+  case Value::Type::NIL:
+    return false;
+  case Value::Type::BOOL:
+    return v.get<bool>();
+  case Value::Type::NUMBER:
+    return v.asNumber() != 0;
+  default:
+    return true;
+  }
+}
+
+} // namespace operators
+} // namespace treewalk
+} // namespace plox
+
+#endif
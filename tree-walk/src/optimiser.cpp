@@ -0,0 +1,225 @@
+#include <optimiser.h>
+
+#include <charconv>
+
+namespace plox {
+namespace treewalk {
+
+void optimise(std::vector<stmt::Stmt> &stmts,
+              std::list<std::string> &constants) {
+  OptimiserVisitor v{constants};
+  std::erase_if(stmts, [&](stmt::Stmt &s) { return !v.optimise(s); });
+}
+
+using namespace ast;
+using namespace stmt;
+
+OptimiserVisitor::OptimiserVisitor(std::list<std::string> &constants)
+    : d_constants(constants), d_env(Environment::create()),
+      d_interpreter(d_env) {}
+
+bool OptimiserVisitor::optimise(Stmt &s) {
+  std::visit(*this, s);
+
+  // Control flow with a constant condition is replaced by the code that runs
+  if (auto *ifStmt = std::get_if<If>(&s)) {
+    auto cond = constantCondition(*ifStmt->condition);
+    if (cond) {
+      auto branch = std::move(*cond ? ifStmt->ifBranch : ifStmt->elseBranch);
+      if (!branch) {
+        return false;
+      }
+      s = std::move(*branch);
+    }
+  } else if (auto *whileStmt = std::get_if<While>(&s)) {
+    if (constantCondition(*whileStmt->condition) == false) {
+      return false;
+    }
+  } else if (auto *forStmt = std::get_if<For>(&s)) {
+    if (forStmt->condition &&
+        constantCondition(*forStmt->condition) == false) {
+      // The initialiser still runs, and may declare a variable
+      auto init = std::move(forStmt->initialiser);
+      if (!init) {
+        return false;
+      }
+      s = std::move(*init);
+    }
+  }
+  return true;
+}
+
+void OptimiserVisitor::operator()(Block &blk) { optimiseStmts(blk.stmts); }
+
+void OptimiserVisitor::operator()(Class &cls) {
+  for (auto &m : cls.methods) {
+    std::visit(*this, *m);
+  }
+}
+
+void OptimiserVisitor::operator()(Expression &expr) { fold(expr.expr); }
+
+void OptimiserVisitor::operator()(For &forStmt) {
+  if (forStmt.initialiser) {
+    std::visit(*this, *forStmt.initialiser);
+  }
+  if (forStmt.condition) {
+    fold(forStmt.condition);
+  }
+  if (forStmt.incrementer) {
+    fold(forStmt.incrementer);
+  }
+  optimiseBranch(forStmt.body);
+}
+
+void OptimiserVisitor::operator()(Fun &funStmt) {
+  optimiseStmts(funStmt.stmts);
+}
+
+void OptimiserVisitor::operator()(If &ifStmt) {
+  fold(ifStmt.condition);
+  optimiseBranch(ifStmt.ifBranch);
+  if (ifStmt.elseBranch) {
+    optimiseBranch(ifStmt.elseBranch);
+  }
+}
+
+void OptimiserVisitor::operator()(Print &print) { fold(print.expr); }
+
+void OptimiserVisitor::operator()(Return &ret) {
+  if (ret.expr) {
+    fold(ret.expr);
+  }
+}
+
+void OptimiserVisitor::operator()(VarDecl &varDecl) {
+  if (varDecl.expr) {
+    fold(varDecl.expr);
+  }
+}
+
+void OptimiserVisitor::operator()(While &whileStmt) {
+  fold(whileStmt.condition);
+  optimiseBranch(whileStmt.body);
+}
+
+void OptimiserVisitor::operator()(Assign &assign) { fold(assign.value); }
+
+void OptimiserVisitor::operator()(Binary &bin) {
+  fold(bin.left);
+  fold(bin.right);
+}
+
+void OptimiserVisitor::operator()(Call &call) {
+  fold(call.callee);
+  for (auto &arg : call.args) {
+    fold(arg);
+  }
+}
+
+void OptimiserVisitor::operator()(Get &get) { fold(get.object); }
+
+void OptimiserVisitor::operator()(Grouping &grp) { fold(grp.expr); }
+
+void OptimiserVisitor::operator()(Literal &ltrl) {}
+
+void OptimiserVisitor::operator()(Set &set) {
+  fold(set.object);
+  fold(set.value);
+}
+
+void OptimiserVisitor::operator()(Unary &unary) { fold(unary.right); }
+
+void OptimiserVisitor::operator()(Variable &var) {}
+
+void OptimiserVisitor::optimiseStmts(
+    std::vector<std::unique_ptr<Stmt>> &stmts) {
+  for (auto it = stmts.begin(); it != stmts.end();) {
+    if (!optimise(**it)) {
+      it = stmts.erase(it);
+      continue;
+    }
+    // Nothing after a return can run
+    if (std::holds_alternative<Return>(**it)) {
+      stmts.erase(it + 1, stmts.end());
+      break;
+    }
+    it++;
+  }
+}
+
+void OptimiserVisitor::optimiseBranch(std::unique_ptr<Stmt> &branch) {
+  // Branches must hold a statement, so swap unreachable code for an empty block
+  if (!optimise(*branch)) {
+    *branch = Block{};
+  }
+}
+
+void OptimiserVisitor::fold(std::unique_ptr<Expr> &expr) {
+  // Fold the operands first
+  std::visit(*this, *expr);
+
+  auto isLiteral = [](const std::unique_ptr<Expr> &e) {
+    return std::holds_alternative<Literal>(*e);
+  };
+  bool isConstant = std::visit(
+      [&](auto &&e) {
+        using T = std::decay_t<decltype(e)>;
+        if constexpr (std::is_same_v<T, Binary>) {
+          return isLiteral(e.left) && isLiteral(e.right);
+        } else if constexpr (std::is_same_v<T, Unary>) {
+          return isLiteral(e.right);
+        } else if constexpr (std::is_same_v<T, Grouping>) {
+          return isLiteral(e.expr);
+        }
+        return false;
+      },
+      *expr);
+  if (!isConstant) {
+    return;
+  }
+
+  try {
+    Value v = std::visit(d_interpreter, *expr);
+    *expr = toLiteral(v);
+  } catch (const InterpretException &) {
+    // Leave the expression so the error is reported when the code runs
+  }
+}
+
+std::optional<bool> OptimiserVisitor::constantCondition(const Expr &expr) {
+  if (!std::holds_alternative<Literal>(expr)) {
+    return std::nullopt;
+  }
+
+  // Matches the truthiness rules of the interpreter
+  Value v = d_interpreter(std::get<Literal>(expr));
+  if (v.is<std::monostate>()) {
+    return false;
+  } else if (v.is<bool>()) {
+    return v.get<bool>();
+  } else if (v.is<double>()) {
+    return static_cast<bool>(v.get<double>());
+  }
+  return true;
+}
+
+Literal OptimiserVisitor::toLiteral(const Value &v) {
+  if (v.is<double>()) {
+    // to_chars gives the shortest text that reads back as the same double
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v.get<double>());
+    d_constants.emplace_back(buf, end);
+    return Literal{d_constants.back(), TokenType::NUMBER, v};
+  } else if (v.is<std::string>()) {
+    d_constants.push_back(v.get<std::string>());
+    return Literal{d_constants.back(), TokenType::STRING, v};
+  } else if (v.is<bool>()) {
+    return v.get<bool>() ? Literal{"true", TokenType::TRUE, v}
+              : Literal{"false", TokenType::FALSE, v};
+  }
+  return Literal{"nul", TokenType::NUL, v};
+}
+
+} // namespace treewalk
+} // namespace plox
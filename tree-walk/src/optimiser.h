@@ -0,0 +1,72 @@
+#ifndef TREEWALK_OPTIMISER_H
+#define TREEWALK_OPTIMISER_H
+
+#include <interpreter.h>
+#include <stmt.h>
+
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+
+// Runs between parsing and resolving. Folds constant expressions and removes
+// code that can never run. Literals created by folding point into
+// 'constants', so it must outlive the statements.
+void optimise(std::vector<stmt::Stmt> &stmts,
+              std::list<std::string> &constants);
+
+// Rewrites the AST in place. Expressions are folded bottom up, so a
+// Binary/Unary/Grouping whose operands are all Literals is evaluated once here
+// rather than every time the interpreter reaches it. Expressions that fail to
+// evaluate are left alone so the error is still raised at runtime.
+class OptimiserVisitor {
+public:
+  explicit OptimiserVisitor(std::list<std::string> &constants);
+
+  // Returns false if the statement can never run and should be removed. If
+  // the statement's condition is constant it is replaced by the branch that
+  // runs.
+  bool optimise(stmt::Stmt &stmt);
+
+  void operator()(stmt::Block &blk);
+  void operator()(stmt::Class &cls);
+  void operator()(stmt::Expression &expr);
+  void operator()(stmt::For &forStmt);
+  void operator()(stmt::Fun &funStmt);
+  void operator()(stmt::If &ifStmt);
+  void operator()(stmt::Print &print);
+  void operator()(stmt::Return &ret);
+  void operator()(stmt::VarDecl &varDecl);
+  void operator()(stmt::While &whileStmt);
+  void operator()(ast::Assign &assign);
+  void operator()(ast::Binary &bin);
+  void operator()(ast::Call &call);
+  void operator()(ast::Get &get);
+  void operator()(ast::Grouping &grp);
+  void operator()(ast::Literal &ltrl);
+  void operator()(ast::Set &set);
+  void operator()(ast::Unary &unary);
+  void operator()(ast::Variable &var);
+
+private:
+  void optimiseStmts(std::vector<std::unique_ptr<stmt::Stmt>> &stmts);
+  void optimiseBranch(std::unique_ptr<stmt::Stmt> &branch);
+  void fold(std::unique_ptr<ast::Expr> &expr);
+  std::optional<bool> constantCondition(const ast::Expr &expr);
+  ast::Literal toLiteral(const Value &v);
+
+  std::list<std::string> &d_constants;
+  // Constant expressions are evaluated by the interpreter so folding can't
+  // change what the code does
+  std::shared_ptr<Environment> d_env;
+  InterpreterVisitor d_interpreter;
+};
+
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -1,5 +1,7 @@
 #include <parser.h>
 
+#include <charconv>
+
 // clang-format off
 
 // program        → statement* EOF ;
@@ -84,6 +86,36 @@ std::unique_ptr<stmt::Stmt> statement(TokenStream &tokStream);
 std::unique_ptr<stmt::Stmt> funStatement(TokenStream &tokStream);
 std::unique_ptr<stmt::Stmt> varStatement(TokenStream &tokStream);
 
+// Literals are decoded once here rather than every time the interpreter
+// evaluates them
+Value decodeLiteral(const Token &tok) {
+  switch (tok.type) {
+  case TokenType::NUMBER: {
+    double val;
+    auto start = tok.value.data();
+    auto end = tok.value.data() + tok.value.size();
+    auto [parseEnd, ec] = std::from_chars(start, end, val);
+    if (ec == std::errc::result_out_of_range) {
+      throw ParseException("Number too large: " + std::string(tok.value),
+                           tok.line);
+    }
+    if (ec != std::errc() || parseEnd != end) {
+      throw ParseException("Unable to read number: " + std::string(tok.value),
+                           tok.line);
+    }
+    return val;
+  }
+  case TokenType::STRING:
+    return std::string(tok.value);
+  case TokenType::TRUE:
+    return true;
+  case TokenType::FALSE:
+    return false;
+  default:
+    return {};
+  }
+}
+
 std::unique_ptr<ast::Expr> primary(TokenStream &tokStream) {
   const Token &tok = tokStream.peek();
   switch (tok.type) {
@@ -92,8 +124,10 @@ std::unique_ptr<ast::Expr> primary(TokenStream &tokStream) {
   case TokenType::TRUE:
   case TokenType::FALSE:
   case TokenType::NUL: {
+    auto ltrl = std::make_unique<ast::Expr>(
+        ast::Literal{tok.value, tok.type, decodeLiteral(tok)});
     tokStream.next();
-    return std::make_unique<ast::Expr>(ast::Literal{tok.value, tok.type});
+    return ltrl;
   }
   case TokenType::IDENTIFIER:
   case TokenType::THIS:
@@ -129,8 +163,9 @@ std::unique_ptr<ast::Expr> call(TokenStream &tokStream) {
          TokenType::DOT == tokStream.peek().type) {
 
     if (TokenType::LEFT_PAREN == tokStream.peek().type) {
+      int line = tokStream.peek().line;
       tokStream.next();
-      expr = std::make_unique<ast::Expr>(ast::Call{std::move(expr)});
+      expr = std::make_unique<ast::Expr>(ast::Call{std::move(expr), {}, line});
       // Loop to construct arguments
       while (TokenType::RIGHT_PAREN != tokStream.peek().type) {
         // Args can be expressions that later need to be evaluated i.e. fn(1+2);
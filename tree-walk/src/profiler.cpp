@@ -0,0 +1,88 @@
+#include <profiler.h>
+
+#include <func.h>
+
+namespace plox {
+namespace treewalk {
+
+Profiler::Profiler()
+    : d_nodes{{"script", nullptr, 0, -1, {}, {}}}, d_current(0),
+      d_lastRecorded(Clock::now()) {}
+
+void Profiler::enter(const FunctionDescription &fn, int line) {
+  recordTime();
+  d_callers.push_back(d_current);
+  enterChild(fn, line);
+}
+
+void Profiler::tailCall(const FunctionDescription &fn, int line) {
+  recordTime();
+  // Go back to the frame if the chain of tail calls already went through it
+  const Function *function = fn.getFunction().get();
+  int caller = d_callers.empty() ? -1 : d_callers.back();
+  for (int n = d_current; n != caller; n = d_nodes[n].parent) {
+    if (d_nodes[n].function == function && d_nodes[n].line == line) {
+      d_current = n;
+      return;
+    }
+  }
+  enterChild(fn, line);
+}
+
+void Profiler::exit() {
+  recordTime();
+  if (!d_callers.empty()) {
+    d_current = d_callers.back();
+    d_callers.pop_back();
+  }
+}
+
+void Profiler::writeFolded(std::ostream &os) {
+  recordTime();
+
+  for (const Node &node : d_nodes) {
+    auto nanos =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(node.selfTime);
+    if (nanos.count() == 0) {
+      continue;
+    }
+
+    std::vector<const std::string *> frames;
+    for (const Node *n = &node; n; n = n->parent >= 0 ? &d_nodes[n->parent]
+                                                      : nullptr) {
+      frames.push_back(&n->frame);
+    }
+    for (auto it = frames.rbegin(); it != frames.rend(); it++) {
+      os << (it == frames.rbegin() ? "" : ";") << **it;
+    }
+    os << " " << nanos.count() << "\n";
+  }
+}
+
+void Profiler::enterChild(const FunctionDescription &fn, int line) {
+  auto key = std::make_pair(fn.getFunction().get(), line);
+  auto it = d_nodes[d_current].children.find(key);
+  if (it != d_nodes[d_current].children.end()) {
+    d_current = it->second;
+    return;
+  }
+
+  int child = d_nodes.size();
+  d_nodes[d_current].children.emplace(key, child);
+  d_nodes.push_back({std::string(fn.getName()) + ":" + std::to_string(line),
+                     key.first,
+                     line,
+                     d_current,
+                     {},
+                     {}});
+  d_current = child;
+}
+
+void Profiler::recordTime() {
+  auto now = Clock::now();
+  d_nodes[d_current].selfTime += now - d_lastRecorded;
+  d_lastRecorded = now;
+}
+
+} // namespace treewalk
+} // namespace plox
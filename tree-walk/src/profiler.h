@@ -0,0 +1,96 @@
+#ifndef TREEWALK_PROFILER_H
+#define TREEWALK_PROFILER_H
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+
+class Function;
+class FunctionDescription;
+
+/*
+ Profiler attributes the time the interpreter spends to the Lox call stack it
+ was running. Each frame is a function's name and the line it was called from,
+ i.e. 'fib:3'. The interpreter tells the profiler when calls start and finish,
+ and the time between is added to the stack that was running.
+
+ A tail call replaces the running function without growing the interpreter's
+ stack, but the profile keeps the function that made it, so the tail called
+ function is shown under its caller, i.e. 'script;mid:9;leaf:2'. Returning
+ goes back to the stack before the first call of the chain. Tail calling a
+ function from a line already in the chain goes back to that frame, so a loop
+ written as tail recursion is profiled as one frame rather than one per call.
+
+ The results are written as folded stacks, one line per stack with the
+ nanoseconds spent in it, which flamegraph tools read directly.
+*/
+
+class Profiler {
+public:
+  Profiler();
+
+  void enter(const FunctionDescription &fn, int line);
+  // Called in place of exit() then enter() when the running function makes a
+  // tail call
+  void tailCall(const FunctionDescription &fn, int line);
+  void exit();
+
+  // Writes the time spent in each stack, excluding the calls it made
+  void writeFolded(std::ostream &os);
+
+  // Profiles a call for the lifetime of the object, if there is a profiler
+  class ScopedCall {
+  public:
+    ScopedCall(Profiler *profiler, const FunctionDescription &fn, int line)
+        : d_profiler(profiler) {
+      if (d_profiler) {
+        d_profiler->enter(fn, line);
+      }
+    }
+    ~ScopedCall() {
+      if (d_profiler) {
+        d_profiler->exit();
+      }
+    }
+
+  private:
+    Profiler *d_profiler;
+  };
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Node {
+    std::string frame;
+    const Function *function;
+    int line;
+    int parent;
+    // The calls made from this stack, by the function and the line
+    std::map<std::pair<const Function *, int>, int> children;
+    Clock::duration selfTime;
+  };
+
+  // Adds the time since the last call started or finished to the stack
+  void recordTime();
+  // Moves to the node for the call from the current node, adding it if it's
+  // the first such call
+  void enterChild(const FunctionDescription &fn, int line);
+
+  // The first node is the top level of the script
+  std::vector<Node> d_nodes;
+  int d_current;
+  // The node each running call returns to, which tail calls don't change
+  std::vector<int> d_callers;
+  Clock::time_point d_lastRecorded;
+};
+
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -0,0 +1,226 @@
+#include <resolver.h>
+
+namespace plox {
+namespace treewalk {
+
+void resolve(std::vector<stmt::Stmt> &stmts,
+             std::vector<ResolveException> &errs) {
+  for (auto &s : stmts) {
+    try {
+      ResolverVisitor v;
+      std::visit(v, s);
+    } catch (const ResolveException &e) {
+      // Continue resolving the next statement so the user knows all errors in
+      // their code.
+      errs.push_back(e);
+    }
+  }
+}
+
+using namespace ast;
+using namespace stmt;
+
+ResolverVisitor::ResolverVisitor()
+    : d_scopes{{false, {}, 0}}, d_frames{{-1, {}}} {}
+
+void ResolverVisitor::operator()(Block &blk) {
+  d_scopes.push_back({true, {}, d_scopes.back().frame});
+  for (auto &s : blk.stmts) {
+    std::visit(*this, *s);
+  }
+  blk.numSlots = d_scopes.back().slots.size();
+  d_scopes.pop_back();
+}
+
+void ResolverVisitor::operator()(Class &cls) {
+  if (cls.super) {
+    cls.superLoc = locate(cls.super.value());
+  }
+  cls.slot = declare(cls.name);
+
+  // Methods are stored by name in the class instance, alongside any fields set
+  // at runtime.
+  d_scopes.push_back({false, {}, d_scopes.back().frame});
+  for (auto &m : cls.methods) {
+    std::visit(*this, *m);
+  }
+  d_scopes.pop_back();
+}
+
+void ResolverVisitor::operator()(Expression &expr) {
+  std::visit(*this, *expr.expr);
+}
+
+void ResolverVisitor::operator()(For &forStmt) {
+  // The initialiser is declared in the current scope
+  if (forStmt.initialiser) {
+    std::visit(*this, *forStmt.initialiser);
+  }
+  if (forStmt.condition) {
+    std::visit(*this, *forStmt.condition);
+  }
+  if (forStmt.incrementer) {
+    std::visit(*this, *forStmt.incrementer);
+  }
+  std::visit(*this, *forStmt.body);
+}
+
+void ResolverVisitor::operator()(Fun &funStmt) {
+  // Declare before resolving the body so the function can call itself
+  if (!funStmt.isMethod) {
+    funStmt.slot = declare(funStmt.name);
+  }
+
+  // Methods capture their upvalues from outside the class, as the class scope
+  // only holds variables by name
+  int definingScope = d_scopes.size() - (funStmt.isMethod ? 2 : 1);
+  d_frames.push_back({definingScope, {}});
+
+  // Params and the function body share the Environment created on invoke
+  d_scopes.push_back({true, {}, static_cast<int>(d_frames.size()) - 1});
+  for (auto &p : funStmt.params) {
+    declare(p);
+  }
+  for (auto &s : funStmt.stmts) {
+    std::visit(*this, *s);
+  }
+  funStmt.numSlots = d_scopes.back().slots.size();
+  funStmt.upvalues = std::move(d_frames.back().upvalues);
+  d_scopes.pop_back();
+  d_frames.pop_back();
+}
+
+void ResolverVisitor::operator()(If &ifStmt) {
+  std::visit(*this, *ifStmt.condition);
+  std::visit(*this, *ifStmt.ifBranch);
+  if (ifStmt.elseBranch) {
+    std::visit(*this, *ifStmt.elseBranch);
+  }
+}
+
+void ResolverVisitor::operator()(Print &print) {
+  std::visit(*this, *print.expr);
+}
+
+void ResolverVisitor::operator()(Return &ret) {
+  if (ret.expr) {
+    std::visit(*this, *ret.expr);
+  }
+}
+
+void ResolverVisitor::operator()(VarDecl &varDecl) {
+  // Resolve the initialiser first so 'var a = a;' refers to an outer 'a'
+  if (varDecl.expr) {
+    std::visit(*this, *varDecl.expr);
+  }
+  varDecl.slot = declare(varDecl.name);
+}
+
+void ResolverVisitor::operator()(While &whileStmt) {
+  std::visit(*this, *whileStmt.condition);
+  std::visit(*this, *whileStmt.body);
+}
+
+void ResolverVisitor::operator()(Assign &assign) {
+  std::visit(*this, *assign.value);
+  assign.loc = locate(assign.name);
+}
+
+void ResolverVisitor::operator()(Binary &bin) {
+  std::visit(*this, *bin.left);
+  std::visit(*this, *bin.right);
+}
+
+void ResolverVisitor::operator()(Call &call) {
+  std::visit(*this, *call.callee);
+  for (auto &arg : call.args) {
+    std::visit(*this, *arg);
+  }
+}
+
+void ResolverVisitor::operator()(Get &get) { std::visit(*this, *get.object); }
+
+void ResolverVisitor::operator()(Grouping &grp) {
+  std::visit(*this, *grp.expr);
+}
+
+void ResolverVisitor::operator()(Literal &ltrl) {}
+
+void ResolverVisitor::operator()(Set &set) {
+  std::visit(*this, *set.object);
+  std::visit(*this, *set.value);
+}
+
+void ResolverVisitor::operator()(Unary &unary) {
+  std::visit(*this, *unary.right);
+}
+
+void ResolverVisitor::operator()(Variable &var) { var.loc = locate(var.name); }
+
+std::optional<int> ResolverVisitor::declare(const Symbol &name) {
+  Scope &scope = d_scopes.back();
+  if (!scope.isResolved) {
+    return std::nullopt;
+  }
+
+  // Lox allows shadowing variables in higher scopes, but not within a scope
+  if (scope.slots.contains(name)) {
+    throw ResolveException("Cannot redefine variable: " + std::string(name));
+  }
+
+  int slot = scope.slots.size();
+  scope.slots[name] = slot;
+  return slot;
+}
+
+std::optional<VarLocation> ResolverVisitor::locate(const Symbol &name) {
+  // Only variables declared before this point are visible. Walk outwards until
+  // we find the variable or hit the globals, which are looked up by name.
+  int depth = 0;
+  int shadowingScopes = 0;
+  for (int i = d_scopes.size() - 1; i > 0; i--) {
+    const Scope &scope = d_scopes[i];
+    if (!scope.isResolved) {
+      shadowingScopes++;
+    } else if (auto it = scope.slots.find(name); it != scope.slots.end()) {
+      int frame = d_scopes.back().frame;
+      if (scope.frame == frame) {
+        return VarLocation{depth, it->second, false, shadowingScopes};
+      }
+      return VarLocation{0, resolveUpvalue(frame, i, it->second), true,
+                         shadowingScopes};
+    }
+    depth++;
+  }
+
+  // Globals can be cached unless a class instance's fields may shadow them
+  if (!shadowingScopes) {
+    return VarLocation{0, 0, false, 0, true};
+  }
+  return std::nullopt;
+}
+
+int ResolverVisitor::resolveUpvalue(int frame, int scope, int slot) {
+  // Capture from the scope the function is defined in if the variable is
+  // declared in the same function, otherwise from the defining function's
+  // upvalues
+  int definingScope = d_frames[frame].definingScope;
+  int definingFrame = d_scopes[definingScope].frame;
+  VarLocation capture =
+      d_scopes[scope].frame == definingFrame
+          ? VarLocation{definingScope - scope, slot}
+          : VarLocation{0, resolveUpvalue(definingFrame, scope, slot), true};
+
+  // Functions share an upvalue each time they use the same variable
+  std::vector<VarLocation> &upvalues = d_frames[frame].upvalues;
+  for (int i = 0; i < upvalues.size(); i++) {
+    if (upvalues[i] == capture) {
+      return i;
+    }
+  }
+  upvalues.push_back(capture);
+  return upvalues.size() - 1;
+}
+
+} // namespace treewalk
+} // namespace plox
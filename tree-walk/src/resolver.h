@@ -0,0 +1,75 @@
+#ifndef TREEWALK_RESOLVER_H
+#define TREEWALK_RESOLVER_H
+
+#include <errs.h>
+#include <stmt.h>
+#include <symbol.h>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+
+// Runs between parsing and interpreting. Works out which Environment slot each
+// local variable lives in so the interpreter doesn't have to search for it by
+// name.
+void resolve(std::vector<stmt::Stmt> &stmts,
+             std::vector<ResolveException> &errs);
+
+// Each scope pushed by the resolver matches an Environment created by the
+// interpreter, so the depth of a variable is the number of Environments to
+// walk up at runtime. Variables from enclosing functions are captured as
+// upvalues when the function is defined, so a function only keeps alive the
+// variables it uses.
+struct ResolverVisitor {
+  ResolverVisitor();
+
+  void operator()(stmt::Block &blk);
+  void operator()(stmt::Class &cls);
+  void operator()(stmt::Expression &expr);
+  void operator()(stmt::For &forStmt);
+  void operator()(stmt::Fun &funStmt);
+  void operator()(stmt::If &ifStmt);
+  void operator()(stmt::Print &print);
+  void operator()(stmt::Return &ret);
+  void operator()(stmt::VarDecl &varDecl);
+  void operator()(stmt::While &whileStmt);
+  void operator()(ast::Assign &assign);
+  void operator()(ast::Binary &bin);
+  void operator()(ast::Call &call);
+  void operator()(ast::Get &get);
+  void operator()(ast::Grouping &grp);
+  void operator()(ast::Literal &ltrl);
+  void operator()(ast::Set &set);
+  void operator()(ast::Unary &unary);
+  void operator()(ast::Variable &var);
+
+private:
+  // Globals and class instances have variables added to them at runtime, so
+  // these scopes are not resolved and their variables are looked up by name.
+  struct Scope {
+    bool isResolved;
+    std::unordered_map<Symbol, int> slots;
+    int frame; // The function the scope belongs to
+  };
+
+  // A function being resolved, with the top level script as the outermost
+  struct Frame {
+    int definingScope; // The scope the function's upvalues are captured from
+    std::vector<VarLocation> upvalues;
+  };
+
+  std::optional<int> declare(const Symbol &name);
+  std::optional<VarLocation> locate(const Symbol &name);
+  int resolveUpvalue(int frame, int scope, int slot);
+
+  std::vector<Scope> d_scopes;
+  std::vector<Frame> d_frames;
+};
+
+} // namespace treewalk
+} // namespace plox
+
+#endif
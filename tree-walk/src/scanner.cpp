@@ -1,91 +1,219 @@
 #include <scanner.h>
 
-#include <map>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <sstream>
-#include <strings.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace plox {
 namespace treewalk {
 
 namespace {
-// All scanXXX() methods are to leave pos at the last char of the token
-std::optional<SyntaxException> scanNumber(std::string_view code, int &pos,
-                                          std::string_view &out, int line) {
-  int numDots = 0;
-  int start = pos;
-  for (; pos < code.size(); pos++) {
-    // Dot handling
-    if (code.at(pos) == '.') {
-      if (numDots > 0) {
-        return SyntaxException("More than 1 dot found in number", line);
-      }
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool isIdentifierStart(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
 
-      numDots++;
+bool isIdentifierChar(char c) { return isIdentifierStart(c) || isDigit(c); }
 
-      // There must be a number after the dot.
-      if (pos + 1 == code.size() || !isdigit(code.at(pos + 1))) {
-        return SyntaxException("Trailing dot found in number", line);
-      }
+bool isWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/*
+ The runs of characters that make up most of a script - whitespace,
+ identifiers, numbers and strings - are scanned a block of bytes at a time.
+ Each block is compared against the characters wanted, giving a mask with a
+ bit per byte, and the first byte that ends the run is the lowest bit set in
+ the mask. Blocks are 32 bytes with AVX2, 16 with SSE2, and without either, or
+ for the bytes left at the end of the code, runs are scanned a byte at a time.
+*/
+#if defined(__AVX2__)
+#define PLOX_SCANNER_BLOCKS
+class Block {
+public:
+  static constexpr int k_size = 32;
+  static constexpr std::uint32_t k_all = 0xFFFFFFFF;
+
+  explicit Block(const char *p)
+      : d_bytes(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))) {}
+
+  std::uint32_t equals(char c) const {
+    return mask(_mm256_cmpeq_epi8(d_bytes, _mm256_set1_epi8(c)));
+  }
+  std::uint32_t between(char lo, char hi) const {
+    return mask(_mm256_and_si256(
+        _mm256_cmpgt_epi8(d_bytes, _mm256_set1_epi8(lo - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), d_bytes)));
+  }
+
+private:
+  static std::uint32_t mask(__m256i v) { return _mm256_movemask_epi8(v); }
+
+  __m256i d_bytes;
+};
+#elif defined(__SSE2__)
+#define PLOX_SCANNER_BLOCKS
+class Block {
+public:
+  static constexpr int k_size = 16;
+  static constexpr std::uint32_t k_all = 0xFFFF;
+
+  explicit Block(const char *p)
+      : d_bytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+
+  std::uint32_t equals(char c) const {
+    return mask(_mm_cmpeq_epi8(d_bytes, _mm_set1_epi8(c)));
+  }
+  std::uint32_t between(char lo, char hi) const {
+    return mask(_mm_and_si128(_mm_cmpgt_epi8(d_bytes, _mm_set1_epi8(lo - 1)),
+                              _mm_cmplt_epi8(d_bytes, _mm_set1_epi8(hi + 1))));
+  }
+
+private:
+  static std::uint32_t mask(__m128i v) { return _mm_movemask_epi8(v); }
+
+  __m128i d_bytes;
+};
+#endif
+
+// Each of these gives back the position of the first char after the run
+// starting at pos
+int skipWhitespace(std::string_view code, int pos, int &line) {
+#ifdef PLOX_SCANNER_BLOCKS
+  for (; pos + Block::k_size <= code.size(); pos += Block::k_size) {
+    Block block(code.data() + pos);
+    std::uint32_t newlines = block.equals('\n');
+    std::uint32_t ends = ~(newlines | block.equals(' ') | block.equals('\t') |
+                           block.equals('\r')) &
+                         Block::k_all;
+    if (ends) {
+      int len = std::countr_zero(ends);
+      line += std::popcount(newlines & ((1u << len) - 1));
+      return pos + len;
+    }
+    line += std::popcount(newlines);
+  }
+#endif
+  for (; pos < code.size() && isWhitespace(code[pos]); pos++) {
+    if (code[pos] == '\n') {
+      line++;
     }
+  }
+  return pos;
+}
 
-    // Continue only if a digit
-    if (!isdigit(code.at(pos))) {
-      break;
+int skipIdentifierChars(std::string_view code, int pos) {
+#ifdef PLOX_SCANNER_BLOCKS
+  for (; pos + Block::k_size <= code.size(); pos += Block::k_size) {
+    Block block(code.data() + pos);
+    std::uint32_t ends = ~(block.between('a', 'z') | block.between('A', 'Z') |
+                           block.between('0', '9') | block.equals('_')) &
+                         Block::k_all;
+    if (ends) {
+      return pos + std::countr_zero(ends);
     }
   }
+#endif
+  for (; pos < code.size() && isIdentifierChar(code[pos]); pos++) {
+  }
+  return pos;
+}
+
+int skipDigits(std::string_view code, int pos) {
+#ifdef PLOX_SCANNER_BLOCKS
+  for (; pos + Block::k_size <= code.size(); pos += Block::k_size) {
+    std::uint32_t ends =
+        ~Block(code.data() + pos).between('0', '9') & Block::k_all;
+    if (ends) {
+      return pos + std::countr_zero(ends);
+    }
+  }
+#endif
+  for (; pos < code.size() && isDigit(code[pos]); pos++) {
+  }
+  return pos;
+}
+
+// Stops at the closing quote, or the end of the code if there isn't one
+int skipStringChars(std::string_view code, int pos, int &line) {
+#ifdef PLOX_SCANNER_BLOCKS
+  for (; pos + Block::k_size <= code.size(); pos += Block::k_size) {
+    Block block(code.data() + pos);
+    std::uint32_t newlines = block.equals('\n');
+    std::uint32_t quotes = block.equals('"');
+    if (quotes) {
+      int len = std::countr_zero(quotes);
+      line += std::popcount(newlines & ((1u << len) - 1));
+      return pos + len;
+    }
+    line += std::popcount(newlines);
+  }
+#endif
+  for (; pos < code.size() && code[pos] != '"'; pos++) {
+    if (code[pos] == '\n') {
+      line++;
+    }
+  }
+  return pos;
+}
+
+// All scanXXX() methods are to leave pos at the last char of the token
+std::optional<SyntaxException> scanNumber(std::string_view code, int &pos,
+                                          std::string_view &out, int line) {
+  int start = pos;
+  pos = skipDigits(code, pos);
+
+  // A dot ends the number, but there must be a number after the dot
+  if (pos < code.size() && code[pos] == '.' &&
+      (pos + 1 == code.size() || !isDigit(code[pos + 1]))) {
+    return SyntaxException("Trailing dot found in number", line);
+  }
 
-  int size = pos - start;
-  out = std::string_view(&code.at(start), size);
+  out = code.substr(start, pos - start);
   pos--; // Reset pos to the last char of the number
   return std::nullopt;
 }
 
 std::optional<SyntaxException> scanString(std::string_view code, int &pos,
                                           std::string_view &out, int &line) {
-  int start = pos;
-  pos++; // Skip initial open quotes
-  for (; pos < code.size(); pos++) {
-    const char &c = code.at(pos);
-    if (c == '\n') {
-      line++;
-    } else if (c == '"') {
-      int size = pos - 1 - start; // skip start and end quotes
-      out = std::string_view(&code.at(start + 1), size);
-      return std::nullopt;
-    }
+  int start = pos + 1; // Skip initial open quotes
+  pos = skipStringChars(code, start, line);
+  if (pos == code.size()) {
+    return SyntaxException("Unterminated string!", line);
   }
-
-  return SyntaxException("Unterminated string!", line);
+  out = code.substr(start, pos - start);
+  return std::nullopt;
 }
 
 void scanLiteral(std::string_view code, int &pos, std::string_view &out) {
   int start = pos;
-  for (; pos < code.size(); pos++) {
-    const char &c = code.at(pos);
-    if (!isalnum(c) && c != '_') {
-      break;
-    }
-  }
-
-  int size = pos - start;
-  out = std::string_view(&code.at(start), size);
+  pos = skipIdentifierChars(code, pos + 1);
+  out = code.substr(start, pos - start);
   pos--; // Reset pos to the last char of the literal
 }
 
-struct CaseInsensCompare {
-  bool operator()(const std::string_view &a, const std::string_view &b) const {
-    // Compare functions in cpp assume true means a<b. Elements are considered
-    // equal if !(a<b) && !(b<a)
-    int len = std::min(a.size(), b.size());
-    int cmp = strncasecmp(a.data(), b.data(), len);
-    if (cmp != 0) {
-      return cmp < 0;
-    }
-    // Match! Make sure the sizes are the same
-    return a.size() < b.size();
-  }
+/*
+ Keywords are matched ignoring case, so 'While' and 'WHILE' are both WHILE.
+
+ Rather than searching a map, each identifier is hashed from its length and
+ its first and last chars to the one slot of a table its keyword could be
+ in. The hash's multiplier is searched for at compile time so no two
+ keywords share a slot. A slot holds its keyword's chars packed into an
+ integer, so checking the identifier is that keyword is one comparison of
+ the identifier's lowercased chars.
+*/
+struct Keyword {
+  std::string_view name;
+  TokenType type;
 };
-const std::map<std::string_view, TokenType, CaseInsensCompare> g_keywords{
+constexpr std::array<Keyword, 16> k_keywords{{
     {"and", TokenType::AND},       {"class", TokenType::CLASS},
     {"else", TokenType::ELSE},     {"false", TokenType::FALSE},
     {"fun", TokenType::FUN},       {"for", TokenType::FOR},
@@ -93,10 +221,105 @@ const std::map<std::string_view, TokenType, CaseInsensCompare> g_keywords{
     {"or", TokenType::OR},         {"print", TokenType::PRINT},
     {"return", TokenType::RETURN}, {"super", TokenType::SUPER},
     {"this", TokenType::THIS},     {"true", TokenType::TRUE},
-    {"var", TokenType::VAR},       {"while", TokenType::WHILE}};
+    {"var", TokenType::VAR},       {"while", TokenType::WHILE}}};
+
+constexpr std::size_t k_maxKeywordLen = 6;
+constexpr std::size_t k_keywordSlots = 32;
+
+// Sets the bit that makes an ASCII letter lowercase. Digits already have it,
+// and '_' becomes a char that isn't in any keyword.
+constexpr char toLower(char c) { return c | 0x20; }
+
+// The lowercased chars of a word of up to 8 chars, one per byte
+constexpr std::uint64_t packLower(std::string_view word) {
+  std::uint64_t packed = 0;
+  for (std::size_t i = 0; i < word.size(); i++) {
+    packed |= std::uint64_t(std::uint8_t(toLower(word[i]))) << (8 * i);
+  }
+  return packed;
+}
+
+constexpr std::size_t keywordSlot(std::string_view word, unsigned mult) {
+  unsigned first = std::uint8_t(toLower(word.front()));
+  unsigned last = std::uint8_t(toLower(word.back()));
+  return (first * mult + last + word.size()) % k_keywordSlots;
+}
+
+constexpr bool slotsAreUnique(unsigned mult) {
+  std::array<bool, k_keywordSlots> taken{};
+  for (const Keyword &kw : k_keywords) {
+    std::size_t slot = keywordSlot(kw.name, mult);
+    if (taken[slot]) {
+      return false;
+    }
+    taken[slot] = true;
+  }
+  return true;
+}
+
+constexpr unsigned findKeywordMultiplier() {
+  for (unsigned mult = 1; mult < 1024; mult++) {
+    if (slotsAreUnique(mult)) {
+      return mult;
+    }
+  }
+  return 0;
+}
+
+constexpr unsigned k_keywordMultiplier = findKeywordMultiplier();
+static_assert(k_keywordMultiplier != 0,
+              "No multiplier hashes every keyword to its own slot");
+
+struct KeywordSlot {
+  // Zero in an empty slot, which no identifier packs to
+  std::uint64_t packed = 0;
+  std::size_t len = 0;
+  TokenType type = TokenType::IDENTIFIER;
+};
+
+constexpr std::array<KeywordSlot, k_keywordSlots> makeKeywordTable() {
+  std::array<KeywordSlot, k_keywordSlots> table{};
+  for (const Keyword &kw : k_keywords) {
+    table[keywordSlot(kw.name, k_keywordMultiplier)] = {
+        packLower(kw.name), kw.name.size(), kw.type};
+  }
+  return table;
+}
+
+constexpr std::array<KeywordSlot, k_keywordSlots> k_keywordTable =
+    makeKeywordTable();
+
+// The keyword the identifier is, ignoring case, or IDENTIFIER if it's none
+constexpr TokenType classifyIdentifier(std::string_view word) {
+  if (word.size() > k_maxKeywordLen) {
+    return TokenType::IDENTIFIER;
+  }
+  const KeywordSlot &slot =
+      k_keywordTable[keywordSlot(word, k_keywordMultiplier)];
+  if (slot.len == word.size() && slot.packed == packLower(word)) {
+    return slot.type;
+  }
+  return TokenType::IDENTIFIER;
+}
+
+static_assert(classifyIdentifier("while") == TokenType::WHILE);
+static_assert(classifyIdentifier("WhIlE") == TokenType::WHILE);
+static_assert(classifyIdentifier("whiles") == TokenType::IDENTIFIER);
+static_assert(classifyIdentifier("nul_") == TokenType::IDENTIFIER);
 
 bool nextCharEquals(std::string_view code, int pos, char c) {
-  return pos + 1 < code.size() && code.at(pos + 1) == c;
+  return pos + 1 < code.size() && code[pos + 1] == c;
+}
+
+// Adds the one char token, or the two char token if the next char is '='
+void scanOneOrTwo(std::vector<Token> &tokens, std::string_view code, int &pos,
+                  int line, TokenType one, TokenType two) {
+  if (nextCharEquals(code, pos, '=')) {
+    tokens.emplace_back(two, code.substr(pos, 2), line);
+    pos++; // 2 char token
+  } else {
+    tokens.emplace_back(one, code.substr(pos, 1), line);
+  }
 }
 } // namespace
 
@@ -106,78 +329,72 @@ std::vector<Token> scanTokens(const std::string_view code,
 
   int line = 1;
   for (int pos = 0; pos < code.size(); pos++) {
-    const char &c = code.at(pos);
+    const char c = code[pos];
+    auto single = [&](TokenType type) {
+      tokens.emplace_back(type, code.substr(pos, 1), line);
+    };
 
+    switch (c) {
+    // Whitespace
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+      pos = skipWhitespace(code, pos, line) - 1;
+      break;
     // Single char tokens
-    if (c == '(') {
-      tokens.emplace_back(TokenType::LEFT_PAREN, std::string_view(&c, 1), line);
-    } else if (c == ')') {
-      tokens.emplace_back(TokenType::RIGHT_PAREN, std::string_view(&c, 1),
-                          line);
-    } else if (c == '{') {
-      tokens.emplace_back(TokenType::LEFT_BRACE, std::string_view(&c, 1), line);
-    } else if (c == '}') {
-      tokens.emplace_back(TokenType::RIGHT_BRACE, std::string_view(&c, 1),
-                          line);
-    } else if (c == ',') {
-      tokens.emplace_back(TokenType::COMMA, std::string_view(&c, 1), line);
-    } else if (c == '.') {
-      tokens.emplace_back(TokenType::DOT, std::string_view(&c, 1), line);
-    } else if (c == '-') {
-      tokens.emplace_back(TokenType::MINUS, std::string_view(&c, 1), line);
-    } else if (c == '+') {
-      tokens.emplace_back(TokenType::PLUS, std::string_view(&c, 1), line);
-    } else if (c == ';') {
-      tokens.emplace_back(TokenType::SEMICOLON, std::string_view(&c, 1), line);
-    } else if (c == '/') {
-      tokens.emplace_back(TokenType::SLASH, std::string_view(&c, 1), line);
-    } else if (c == '*') {
-      tokens.emplace_back(TokenType::STAR, std::string_view(&c, 1), line);
-    }
+    case '(':
+      single(TokenType::LEFT_PAREN);
+      break;
+    case ')':
+      single(TokenType::RIGHT_PAREN);
+      break;
+    case '{':
+      single(TokenType::LEFT_BRACE);
+      break;
+    case '}':
+      single(TokenType::RIGHT_BRACE);
+      break;
+    case ',':
+      single(TokenType::COMMA);
+      break;
+    case '.':
+      single(TokenType::DOT);
+      break;
+    case '-':
+      single(TokenType::MINUS);
+      break;
+    case '+':
+      single(TokenType::PLUS);
+      break;
+    case ';':
+      single(TokenType::SEMICOLON);
+      break;
+    case '/':
+      single(TokenType::SLASH);
+      break;
+    case '*':
+      single(TokenType::STAR);
+      break;
     // 1 or 2 char tokens
-    else if (c == '!') {
-      if (nextCharEquals(code, pos, '=')) {
-        tokens.emplace_back(TokenType::BANG_EQUAL, std::string_view(&c, 2),
-                            line);
-        pos++; // 2 char token
-      } else {
-        tokens.emplace_back(TokenType::BANG, std::string_view(&c, 1), line);
-      }
-    } else if (c == '=') {
-      if (nextCharEquals(code, pos, '=')) {
-        tokens.emplace_back(TokenType::EQUAL_EQUAL, std::string_view(&c, 2),
-                            line);
-        pos++; // 2 char token
-      } else {
-        tokens.emplace_back(TokenType::EQUAL, std::string_view(&c, 1), line);
-      }
-    } else if (c == '<') {
-      if (nextCharEquals(code, pos, '=')) {
-        tokens.emplace_back(TokenType::LESS_EQUAL, std::string_view(&c, 2),
-                            line);
-        pos++; // 2 char token
-      } else {
-        tokens.emplace_back(TokenType::LESS, std::string_view(&c, 1), line);
-      }
-    } else if (c == '>') {
-      if (nextCharEquals(code, pos, '=')) {
-        tokens.emplace_back(TokenType::GREATER_EQUAL, std::string_view(&c, 2),
-                            line);
-        pos++; // 2 char token
-      } else {
-        tokens.emplace_back(TokenType::GREATER, std::string_view(&c, 1), line);
-      }
-    }
+    case '!':
+      scanOneOrTwo(tokens, code, pos, line, TokenType::BANG,
+                   TokenType::BANG_EQUAL);
+      break;
+    case '=':
+      scanOneOrTwo(tokens, code, pos, line, TokenType::EQUAL,
+                   TokenType::EQUAL_EQUAL);
+      break;
+    case '<':
+      scanOneOrTwo(tokens, code, pos, line, TokenType::LESS,
+                   TokenType::LESS_EQUAL);
+      break;
+    case '>':
+      scanOneOrTwo(tokens, code, pos, line, TokenType::GREATER,
+                   TokenType::GREATER_EQUAL);
+      break;
     // literals
-    else if (isdigit(c)) {
-      std::string_view num;
-      auto SyntaxException = scanNumber(code, pos, num, line);
-      if (SyntaxException) {
-        errs.push_back(SyntaxException.value());
-      } else {
-        tokens.emplace_back(TokenType::NUMBER, num, line);
-      }
-    } else if (c == '"') {
+    case '"': {
       std::string_view str;
       auto SyntaxException = scanString(code, pos, str, line);
       if (SyntaxException) {
@@ -185,19 +402,21 @@ std::vector<Token> scanTokens(const std::string_view code,
       } else {
         tokens.emplace_back(TokenType::STRING, str, line);
       }
-    } else if (isalpha(c) || c == '_') {
-      std::string_view literal;
-      scanLiteral(code, pos, literal);
-      if (g_keywords.contains(literal)) {
-        tokens.emplace_back(g_keywords.at(literal), literal, line);
-      } else {
-        tokens.emplace_back(TokenType::IDENTIFIER, literal, line);
-      }
-    } else {
-      if (c == '\r' || c == ' ' || c == '\t') {
-        // ignore whitespace
-      } else if (c == '\n') {
-        line++;
+      break;
+    }
+    default:
+      if (isDigit(c)) {
+        std::string_view num;
+        auto SyntaxException = scanNumber(code, pos, num, line);
+        if (SyntaxException) {
+          errs.push_back(SyntaxException.value());
+        } else {
+          tokens.emplace_back(TokenType::NUMBER, num, line);
+        }
+      } else if (isIdentifierStart(c)) {
+        std::string_view literal;
+        scanLiteral(code, pos, literal);
+        tokens.emplace_back(classifyIdentifier(literal), literal, line);
       } else {
         std::ostringstream ss;
         ss << "Unknown symbol: " << c;
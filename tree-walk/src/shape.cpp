@@ -0,0 +1,57 @@
+#include <shape.h>
+
+namespace plox {
+namespace treewalk {
+
+Shape::Shape(bool isShared) : d_isShared(isShared) {}
+
+const Shape *Shape::empty() {
+  static const Shape s_empty(true);
+  return &s_empty;
+}
+
+int Shape::find(const Symbol &name) const {
+  auto it = d_indices.find(name);
+  return it != d_indices.end() ? it->second : -1;
+}
+
+int Shape::size() const { return d_indices.size(); }
+
+bool Shape::isShared() const { return d_isShared; }
+
+const Shape *Shape::withName(const Symbol &name) const {
+  std::unique_ptr<Shape> &next = d_transitions[name];
+  if (!next) {
+    next.reset(new Shape(true));
+    next->d_indices = d_indices;
+    next->d_indices.emplace(name, d_indices.size());
+  }
+  return next.get();
+}
+
+std::unique_ptr<Shape> Shape::unshare() const {
+  std::unique_ptr<Shape> copy(new Shape(false));
+  copy->d_indices = d_indices;
+  return copy;
+}
+
+void Shape::add(const Symbol &name) {
+  d_indices.emplace(name, d_indices.size());
+}
+
+const PropertyCache::Entry *PropertyCache::find(const Shape *shape) const {
+  for (const Entry &entry : entries) {
+    if (entry.shape == shape) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+void PropertyCache::insert(const Entry &entry) {
+  entries[next] = entry;
+  next = (next + 1) % k_numEntries;
+}
+
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,78 @@
+#ifndef TREEWALK_SHAPE_H
+#define TREEWALK_SHAPE_H
+
+#include <symbol.h>
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+
+/*
+ Shape describes the named variables an Environment holds, and the index of
+ each in the Environment's values.
+
+ Environments that define the same names in the same order share a Shape, so
+ every instance of a class with the same fields has the same Shape. Shared
+ Shapes form a tree of transitions from the empty Shape and live until the
+ program exits.
+
+ Once a Shape has many names, adding another gives the Environment its own
+ unshared Shape that grows in place. This stops large scopes such as the
+ globals copying their names for every variable they define.
+*/
+
+class Shape {
+public:
+  // The Shape of an Environment without named variables
+  static const Shape *empty();
+
+  // The index of the name, or -1 if the Shape doesn't have it
+  int find(const Symbol &name) const;
+  int size() const;
+  bool isShared() const;
+
+  // The shared Shape with the name added after the names of this Shape
+  const Shape *withName(const Symbol &name) const;
+  // An unshared copy of this Shape, which names can be added to in place
+  std::unique_ptr<Shape> unshare() const;
+  void add(const Symbol &name);
+
+  // Shared Shapes stop transitioning at this size
+  static constexpr int k_maxSharedSize = 32;
+
+private:
+  explicit Shape(bool isShared);
+
+  std::unordered_map<Symbol, int> d_indices;
+  mutable std::unordered_map<Symbol, std::unique_ptr<Shape>> d_transitions;
+  bool d_isShared;
+};
+
+// Remembers the index of a property for the last few Shapes seen by a Get or
+// Set, so that accessing the property on an instance with one of those Shapes
+// is a compare and a load. A Set that added the property also remembers the
+// Shape it moved the instance to.
+struct PropertyCache {
+  struct Entry {
+    const Shape *shape = nullptr;
+    const Shape *added = nullptr;
+    int index = 0;
+  };
+
+  const Entry *find(const Shape *shape) const;
+  // Replaces the oldest entry once the cache is full
+  void insert(const Entry &entry);
+
+  static constexpr int k_numEntries = 4;
+  std::array<Entry, k_numEntries> entries;
+  int next = 0;
+};
+
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -0,0 +1,453 @@
+#include <stack_evaluator.h>
+
+#include <class.h>
+#include <func.h>
+#include <gc.h>
+#include <operators.h>
+#include <value_printer.h>
+
+#include <iostream>
+#include <utility>
+
+namespace plox {
+namespace treewalk {
+namespace stack {
+
+void interpret(std::vector<stmt::Stmt> &stmts,
+               std::shared_ptr<Environment> &env,
+               std::vector<InterpretException> &errs, Profiler *profiler,
+               std::size_t stackBudget) {
+  try {
+    Evaluator evaluator{env, profiler, stackBudget};
+    for (auto &s : stmts) {
+      // A return in the top level script stops the script
+      if (evaluator.run(s) == Completion::RETURN) {
+        break;
+      }
+    }
+  } catch (const InterpretException &e) {
+    errs.push_back(e);
+  }
+}
+
+namespace {
+static ValuePrinter s_valuePrinter;
+
+const Symbol s_init("init");
+} // namespace
+
+Evaluator::Evaluator(std::shared_ptr<Environment> &env, Profiler *profiler,
+                     std::size_t stackBudget)
+    : d_interp(env, profiler), d_stackBudget(stackBudget),
+      d_returnedFromScript(false) {}
+
+Completion Evaluator::run(stmt::Stmt &s) {
+  d_tasks.clear();
+  d_values.clear();
+  d_returnedFromScript = false;
+
+  push(s);
+  while (!d_tasks.empty()) {
+    std::visit([this](auto *node) { (*this)(*node); }, d_tasks.back().node);
+  }
+  return d_returnedFromScript ? Completion::RETURN : Completion::NORMAL;
+}
+
+Evaluator::Task &Evaluator::top() { return d_tasks.back(); }
+
+void Evaluator::push(stmt::Stmt &s) {
+  pushTask(std::visit([](auto &n) -> Node { return &n; }, s), false);
+}
+
+void Evaluator::push(ast::Expr &expr, bool isTail) {
+  // Literals and variables don't run any Lox code, so are evaluated straight
+  // away rather than given a task
+  if (auto *ltrl = std::get_if<ast::Literal>(&expr)) {
+    pushValue(d_interp(*ltrl));
+    return;
+  } else if (auto *var = std::get_if<ast::Variable>(&expr)) {
+    pushValue(d_interp(*var));
+    return;
+  }
+  pushTask(std::visit([](auto &n) -> Node { return &n; }, expr), isTail);
+}
+
+void Evaluator::pushTask(Node node, bool isTail) {
+  std::size_t used = (d_tasks.size() + 1) * sizeof(Task) +
+                     d_values.size() * sizeof(Value);
+  if (used > d_stackBudget) {
+    throw InterpretException("Stack overflow: the stack grew past its " +
+                             std::to_string(d_stackBudget) + " byte budget");
+  }
+  Task &task = d_tasks.emplace_back();
+  task.node = node;
+  task.isTail = isTail;
+}
+
+void Evaluator::pop() {
+  Task &task = top();
+  if (task.savedEnv) {
+    d_interp.d_env = std::move(task.savedEnv);
+  }
+  d_tasks.pop_back();
+}
+
+void Evaluator::pushValue(Value v) { d_values.push_back(std::move(v)); }
+
+Value Evaluator::popValue() {
+  Value v = std::move(d_values.back());
+  d_values.pop_back();
+  return v;
+}
+
+void Evaluator::operator()(stmt::Block &blk) {
+  Task &task = top();
+  if (task.step == 0) {
+    // Create new scope, which is swapped back once the block is done
+    task.savedEnv = std::exchange(
+        d_interp.d_env, Environment::create(d_interp.d_env, blk.numSlots));
+  }
+  if (task.step == blk.stmts.size()) {
+    pop();
+    return;
+  }
+  push(*blk.stmts[task.step++]);
+}
+
+void Evaluator::operator()(stmt::Class &cls) {
+  d_interp(cls);
+  pop();
+}
+
+void Evaluator::operator()(stmt::Expression &expr) {
+  if (top().step++ == 0) {
+    push(*expr.expr);
+    return;
+  }
+  popValue();
+  pop();
+}
+
+void Evaluator::operator()(stmt::For &forStmt) {
+  Task &task = top();
+  switch (task.step) {
+  case 0:
+    task.step = 1;
+    if (forStmt.initialiser) {
+      push(*forStmt.initialiser);
+      return;
+    }
+    [[fallthrough]];
+  case 1:
+    task.step = 2;
+    if (forStmt.condition) {
+      push(*forStmt.condition);
+      return;
+    }
+    // It's possible to have no condition - in that case the loop should run
+    // forever
+    pushValue(true);
+    [[fallthrough]];
+  case 2:
+    if (!operators::isTruthy(popValue())) {
+      pop();
+      return;
+    }
+    task.step = 3;
+    push(*forStmt.body);
+    return;
+  case 3:
+    task.step = 4;
+    if (forStmt.incrementer) {
+      push(*forStmt.incrementer);
+      return;
+    }
+    [[fallthrough]];
+  default:
+    if (forStmt.incrementer) {
+      popValue();
+    }
+    gc::maybeCollect();
+    task.step = 1;
+  }
+}
+
+void Evaluator::operator()(stmt::Fun &funStmt) {
+  d_interp(funStmt);
+  pop();
+}
+
+void Evaluator::operator()(stmt::If &ifStmt) {
+  if (top().step++ == 0) {
+    push(*ifStmt.condition);
+    return;
+  }
+
+  // The branch taken replaces the if, which has nothing left to do
+  stmt::Stmt *branch = operators::isTruthy(popValue())
+                           ? ifStmt.ifBranch.get()
+                           : ifStmt.elseBranch.get();
+  if (!branch) {
+    pop();
+    return;
+  }
+  pop();
+  push(*branch);
+}
+
+void Evaluator::operator()(stmt::Print &print) {
+  if (top().step++ == 0) {
+    push(*print.expr);
+    return;
+  }
+  std::cout << visit(s_valuePrinter, popValue()) << std::endl;
+  pop();
+}
+
+void Evaluator::operator()(stmt::Return &ret) {
+  if (top().step++ == 0 && ret.expr) {
+    // A call here can run in place of the function returning
+    push(*ret.expr, true);
+    return;
+  }
+  d_interp.d_returnValue = ret.expr ? popValue() : Value{};
+  returnFromCall();
+}
+
+void Evaluator::operator()(stmt::VarDecl &varDecl) {
+  if (top().step++ == 0 && varDecl.expr) {
+    push(*varDecl.expr);
+    return;
+  }
+  Value val = varDecl.expr ? popValue() : Value{};
+  if (varDecl.slot) {
+    d_interp.d_env->defineAt(*varDecl.slot, std::move(val));
+  } else {
+    d_interp.d_env->define(varDecl.name, std::move(val));
+  }
+  pop();
+}
+
+void Evaluator::operator()(stmt::While &whileStmt) {
+  Task &task = top();
+  switch (task.step) {
+  case 0:
+    task.step = 1;
+    push(*whileStmt.condition);
+    return;
+  case 1:
+    if (!operators::isTruthy(popValue())) {
+      pop();
+      return;
+    }
+    task.step = 2;
+    push(*whileStmt.body);
+    return;
+  default:
+    gc::maybeCollect();
+    task.step = 0;
+  }
+}
+
+void Evaluator::operator()(ast::Assign &assign) {
+  if (top().step++ == 0) {
+    push(*assign.value);
+    return;
+  }
+  // The value assigned is left on the stack as the result
+  const Value &val = d_values.back();
+  if (assign.loc && assign.loc->isGlobal) {
+    d_interp.d_env->assignGlobal(assign.name, val, *d_interp.d_globals,
+                                 assign.cache);
+  } else {
+    d_interp.assignVariable(assign.name, assign.loc, val);
+  }
+  pop();
+}
+
+void Evaluator::operator()(ast::Binary &bnry) {
+  Task &task = top();
+  if (task.step < 2) {
+    push(task.step++ == 0 ? *bnry.left : *bnry.right);
+    return;
+  }
+  Value rhs = popValue();
+  Value lhs = popValue();
+  pushValue(InterpreterVisitor::binary(bnry.op, lhs, rhs));
+  pop();
+}
+
+void Evaluator::operator()(ast::Call &call) {
+  Task &task = top();
+  if (task.fn) {
+    runBody(task);
+    return;
+  }
+
+  // Evaluate the callee, then the args
+  int numArgs = call.args.size();
+  if (task.step <= numArgs) {
+    int i = task.step++;
+    push(i == 0 ? *call.callee : *call.args[i - 1]);
+    return;
+  }
+
+  std::size_t base = d_values.size() - numArgs - 1;
+  Value callee = std::move(d_values[base]);
+  FnDescShrdPtr fn;
+  ClsInstShrdPtr instance;
+  if (callee.is<FnDescShrdPtr>()) {
+    fn = callee.get<FnDescShrdPtr>();
+  } else if (callee.is<ClsDefShrdPtr>()) {
+    ClsDefShrdPtr clsDef = callee.get<ClsDefShrdPtr>();
+    instance = d_interp.instantiate(clsDef);
+    if (clsDef->getClosure()->isVarInScope(s_init)) {
+      fn = instance->getClosure()->get(s_init).get<FnDescShrdPtr>();
+    }
+  } else {
+    throw InterpretException("Tried to call non callable object " +
+                             visit(s_valuePrinter, callee));
+  }
+  if (!fn) {
+    d_values.resize(base);
+    pushValue(instance);
+    pop();
+    return;
+  }
+
+  std::shared_ptr<Environment> fEnv = d_interp.prepareCall(fn, numArgs);
+  const Function &function = *fn->getFunction();
+  for (int i = 0; i < numArgs; i++) {
+    InterpreterVisitor::defineArg(*fEnv, function, i,
+                                  std::move(d_values[base + 1 + i]));
+  }
+  d_values.resize(base);
+
+  // Native functions don't run Lox code, so run them straight away
+  if (!function.getStmts()) {
+    pushValue(d_interp.finishCall(fn, fEnv, call.line));
+    pop();
+    return;
+  }
+  if (task.isTail && d_interp.canTailCall(callee)) {
+    tailCall(std::move(fn), std::move(fEnv), call.line);
+    return;
+  }
+
+  // Run the function's statements in its Environment, then swap back
+  if (d_interp.d_profiler) {
+    d_interp.d_profiler->enter(*fn, call.line);
+  }
+  task.savedEnv = std::exchange(d_interp.d_env, std::move(fEnv));
+  task.caller = std::exchange(d_interp.d_function, fn.get());
+  task.fn = std::move(fn);
+  task.step = 0;
+}
+
+void Evaluator::runBody(Task &call) {
+  const auto &stmts = *call.fn->getFunction()->getStmts();
+  if (call.step < stmts.size()) {
+    push(*stmts[call.step++]);
+    return;
+  }
+  // Return null if the user doesn't explicitly add a return stmt
+  finishCall({});
+}
+
+void Evaluator::returnFromCall() {
+  while (!d_tasks.empty() && !top().fn) {
+    pop();
+  }
+  if (d_tasks.empty()) {
+    d_returnedFromScript = true;
+    return;
+  }
+  finishCall(d_interp.takeReturnValue());
+}
+
+void Evaluator::finishCall(Value returned) {
+  Task &call = top();
+  Value result = InterpreterVisitor::callResult(*call.fn, std::move(returned));
+  d_interp.d_function = call.caller;
+  if (d_interp.d_profiler) {
+    d_interp.d_profiler->exit();
+  }
+  pop();
+  pushValue(std::move(result));
+}
+
+void Evaluator::tailCall(FnDescShrdPtr fn, std::shared_ptr<Environment> fEnv,
+                         int line) {
+  // A function only makes tail calls while it's running, so there's a call
+  // to return from
+  while (!top().fn) {
+    pop();
+  }
+
+  Task &call = top();
+  if (d_interp.d_profiler) {
+    d_interp.d_profiler->tailCall(*fn, line);
+  }
+  d_interp.d_env = std::move(fEnv);
+  d_interp.d_function = fn.get();
+  call.fn = std::move(fn);
+  call.step = 0;
+}
+
+void Evaluator::operator()(ast::Get &get) {
+  if (top().step++ == 0) {
+    push(*get.object);
+    return;
+  }
+  pushValue(d_interp.getProperty(get, popValue()));
+  pop();
+}
+
+void Evaluator::operator()(ast::Grouping &grp) {
+  // The grouped expression gives the value, so it replaces the grouping
+  pop();
+  push(*grp.expr);
+}
+
+void Evaluator::operator()(ast::Literal &ltrl) {
+  pushValue(d_interp(ltrl));
+  pop();
+}
+
+void Evaluator::operator()(ast::Set &set) {
+  Task &task = top();
+  switch (task.step) {
+  case 0:
+    task.step = 1;
+    push(*set.object);
+    return;
+  case 1:
+    InterpreterVisitor::checkCanSet(d_values.back());
+    task.step = 2;
+    push(*set.value);
+    return;
+  }
+  Value val = popValue();
+  Value obj = popValue();
+  d_interp.setProperty(set, obj, std::move(val));
+  pushValue({});
+  pop();
+}
+
+void Evaluator::operator()(ast::Unary &unry) {
+  if (top().step++ == 0) {
+    push(*unry.right);
+    return;
+  }
+  pushValue(InterpreterVisitor::unary(unry.op, popValue()));
+  pop();
+}
+
+void Evaluator::operator()(ast::Variable &var) {
+  pushValue(d_interp(var));
+  pop();
+}
+
+} // namespace stack
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,138 @@
+#ifndef TREEWALK_STACK_EVALUATOR_H
+#define TREEWALK_STACK_EVALUATOR_H
+
+#include <environment.h>
+#include <errs.h>
+#include <interpreter.h>
+#include <profiler.h>
+#include <stmt.h>
+
+#include <cstddef>
+#include <memory>
+#include <variant>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace stack {
+
+// The memory the evaluator's stacks may use before a Lox stack overflow
+constexpr std::size_t k_defaultStackBudget = 64 * 1024 * 1024;
+
+// The entrypoint to the stack engine. Runs the statements from the resolver
+// without recursing on the C++ stack.
+void interpret(std::vector<stmt::Stmt> &stmts,
+               std::shared_ptr<Environment> &env,
+               std::vector<InterpretException> &errs,
+               Profiler *profiler = nullptr,
+               std::size_t stackBudget = k_defaultStackBudget);
+
+/*
+ Runs the resolved AST from an explicit stack rather than by recursion.
+
+ The tree walk interpreter evaluates a node by visiting its children, so
+ nested expressions and Lox calls nest on the C++ stack until it overflows.
+ The evaluator instead keeps a stack of tasks, each a node and how far
+ through running it is. Each step looks at the task on top and either pushes
+ a child to run next or finishes the node, popping it. Expressions leave their
+ results on a value stack for the task below to take.
+
+ A Lox call is a task that runs the function's statements once its args are
+ evaluated, and keeps the Environment of the caller to swap back when it's
+ done. A return pops the tasks above the call it returns from, and a call in
+ a return replaces the call being returned from, so tail calls don't grow the
+ stack. Native functions and initialisers' 'this' go through the tree walk
+ interpreter, so both behave the same.
+
+ The stacks are limited to a budget of bytes, and going over it throws an
+ InterpretException, so deep recursion is a Lox error rather than a crash.
+ The budget covers the tasks and values, while each call's Environment is on
+ the heap as with the other engines.
+*/
+class Evaluator {
+public:
+  Evaluator(std::shared_ptr<Environment> &env, Profiler *profiler = nullptr,
+            std::size_t stackBudget = k_defaultStackBudget);
+
+  // Runs the statement to the end. Gives back RETURN if it returned from the
+  // top level script.
+  Completion run(stmt::Stmt &s);
+
+  // Each step runs part of the statement or expression on top of the stack
+  void operator()(stmt::Block &blk);
+  void operator()(stmt::Class &cls);
+  void operator()(stmt::Expression &expr);
+  void operator()(stmt::For &forStmt);
+  void operator()(stmt::Fun &funStmt);
+  void operator()(stmt::If &ifStmt);
+  void operator()(stmt::Print &print);
+  void operator()(stmt::Return &ret);
+  void operator()(stmt::VarDecl &varDecl);
+  void operator()(stmt::While &whileStmt);
+  void operator()(ast::Assign &assign);
+  void operator()(ast::Binary &bnry);
+  void operator()(ast::Call &call);
+  void operator()(ast::Get &get);
+  void operator()(ast::Grouping &grp);
+  void operator()(ast::Literal &ltrl);
+  void operator()(ast::Set &set);
+  void operator()(ast::Unary &unry);
+  void operator()(ast::Variable &var);
+
+private:
+  // The node a task runs, held by its type so each step dispatches once
+  using Node =
+      std::variant<stmt::Block *, stmt::Class *, stmt::Expression *,
+                   stmt::For *, stmt::Fun *, stmt::If *, stmt::Print *,
+                   stmt::Return *, stmt::VarDecl *, stmt::While *,
+                   ast::Assign *, ast::Binary *, ast::Call *, ast::Get *,
+                   ast::Grouping *, ast::Literal *, ast::Set *, ast::Unary *,
+                   ast::Variable *>;
+
+  struct Task {
+    Node node;
+    // Set on a call whose value is returned
+    bool isTail = false;
+    // How far through the node is. Calls count through their function's
+    // statements once it's running.
+    int step = 0;
+    // The Environment to swap back in once the task is done
+    std::shared_ptr<Environment> savedEnv;
+    // Set on a call once its function is running
+    FnDescShrdPtr fn;
+    FunctionDescription *caller = nullptr;
+  };
+
+  Task &top();
+  void push(stmt::Stmt &s);
+  void push(ast::Expr &expr, bool isTail = false);
+  // Throws once the stacks would go over their budget
+  void pushTask(Node node, bool isTail);
+  // Drops the task on top, swapping back the Environment it replaced
+  void pop();
+  void pushValue(Value v);
+  Value popValue();
+
+  // Runs the next statement of the function being called
+  void runBody(Task &call);
+  // Pops the tasks left in the function being returned from, then finishes
+  // the call with the returned value
+  void returnFromCall();
+  void finishCall(Value returned);
+  // Replaces the call being returned from with a call to 'fn'
+  void tailCall(FnDescShrdPtr fn, std::shared_ptr<Environment> fEnv,
+                int line);
+
+  InterpreterVisitor d_interp;
+  std::vector<Task> d_tasks;
+  std::vector<Value> d_values;
+  std::size_t d_stackBudget;
+  // Set when a return outside of any function stops the script
+  bool d_returnedFromScript;
+};
+
+} // namespace stack
+} // namespace treewalk
+} // namespace plox
+
+#endif
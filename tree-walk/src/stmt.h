@@ -40,12 +40,15 @@ using Stmt = std::variant<Block, Class, Expression, For, Fun, If, Print, Return,
 
 struct Block {
   std::vector<std::unique_ptr<stmt::Stmt>> stmts;
+  std::optional<int> numSlots;
 };
 
 struct Class {
-  std::string_view name;
-  std::optional<std::string_view> super;
+  Symbol name;
+  std::optional<Symbol> super;
   std::vector<std::unique_ptr<stmt::Stmt>> methods;
+  std::optional<int> slot;
+  std::optional<VarLocation> superLoc;
 };
 
 struct Expression {
@@ -60,10 +63,14 @@ struct For {
 };
 
 struct Fun {
-  std::string_view name;
-  std::vector<std::string_view> params;
+  Symbol name;
+  std::vector<Symbol> params;
   std::vector<std::unique_ptr<stmt::Stmt>> stmts;
   bool isMethod;
+  std::optional<int> slot;
+  std::optional<int> numSlots;
+  std::vector<VarLocation> upvalues;
+  std::shared_ptr<const Function> function;
 };
 
 struct If {
@@ -81,8 +88,9 @@ struct Return {
 };
 
 struct VarDecl {
-  std::string_view name;
+  Symbol name;
   std::unique_ptr<ast::Expr> expr;
+  std::optional<int> slot;
 };
 
 struct While {
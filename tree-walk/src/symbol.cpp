@@ -0,0 +1,62 @@
+#include <symbol.h>
+
+#include <deque>
+#include <unordered_map>
+
+namespace plox {
+namespace treewalk {
+
+namespace {
+struct SymbolTable {
+  SymbolTable() { intern(""); }
+
+  const std::string &intern(std::string_view name, SymbolId &id) {
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+      id = it->second;
+      return names[id];
+    }
+
+    // A deque never moves its elements, so the views used as keys stay valid
+    id = names.size();
+    const std::string &stored = names.emplace_back(name);
+    ids.emplace(stored, id);
+    return stored;
+  }
+
+  void intern(std::string_view name) {
+    SymbolId id;
+    intern(name, id);
+  }
+
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, SymbolId> ids;
+};
+
+// Constructed on first use so Symbols can be created during static
+// initialisation of other translation units
+SymbolTable &table() {
+  static SymbolTable s_table;
+  return s_table;
+}
+} // namespace
+
+Symbol::Symbol() : d_id(0), d_name(table().names.front()) {}
+
+Symbol::Symbol(std::string_view name) : d_name(table().intern(name, d_id)) {}
+
+Symbol::Symbol(const char *name) : Symbol(std::string_view(name)) {}
+
+Symbol::Symbol(const std::string &name) : Symbol(std::string_view(name)) {}
+
+std::ostream &operator<<(std::ostream &os, const Symbol &sym) {
+  os << sym.str();
+  return os;
+}
+
+namespace symbols {
+int count() { return table().names.size(); }
+} // namespace symbols
+
+} // namespace treewalk
+} // namespace plox
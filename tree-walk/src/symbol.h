@@ -0,0 +1,57 @@
+#ifndef TREEWALK_SYMBOL_H
+#define TREEWALK_SYMBOL_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace plox {
+namespace treewalk {
+
+using SymbolId = int;
+
+// An interned identifier. The first time a name is seen it is added to a
+// global symbol table and given the next id, so every Symbol for the same name
+// shares an id. Comparing and hashing Symbols only looks at the id.
+//
+// The name is kept alongside the id for printing and error messages. It points
+// into the symbol table, which lives until the program exits, so it remains
+// valid after the source code it was read from has gone.
+class Symbol {
+public:
+  Symbol(); // The empty name
+  Symbol(std::string_view name);
+  Symbol(const char *name);
+  Symbol(const std::string &name);
+
+  SymbolId id() const { return d_id; }
+  std::string_view str() const { return d_name; }
+  operator std::string_view() const { return d_name; }
+
+  bool operator==(const Symbol &other) const { return d_id == other.d_id; }
+  auto operator<=>(const Symbol &other) const { return d_id <=> other.d_id; }
+
+private:
+  SymbolId d_id;
+  std::string_view d_name;
+};
+
+std::ostream &operator<<(std::ostream &os, const Symbol &sym);
+
+namespace symbols {
+// Number of distinct names interned so far. Ids are in [0, count()).
+int count();
+} // namespace symbols
+
+} // namespace treewalk
+} // namespace plox
+
+template <> struct std::hash<plox::treewalk::Symbol> {
+  std::size_t operator()(const plox::treewalk::Symbol &sym) const noexcept {
+    return sym.id();
+  }
+};
+
+#endif
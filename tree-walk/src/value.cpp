@@ -0,0 +1,157 @@
+#include <value.h>
+
+#include <functional>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+
+namespace {
+// Shorter strings are copied when they're joined, as copying a few characters
+// costs less than a join
+constexpr std::size_t k_minJoinSize = 64;
+} // namespace
+
+StringObject::StringObject(std::string str)
+    : d_str(std::move(str)), d_size(d_str.size()) {}
+
+StringObject::StringObject(Ref<StringObject> left, Ref<StringObject> right)
+    : d_left(std::move(left)), d_right(std::move(right)),
+      d_size(d_left->size() + d_right->size()) {}
+
+StringObject::~StringObject() {
+  if (d_left) {
+    releasePieces();
+  }
+}
+
+const std::string &StringObject::str() const {
+  if (d_left) {
+    // Copy the pieces in order, walking the joins without recursing
+    d_str.reserve(d_size);
+    std::vector<const StringObject *> pending{d_right.get(), d_left.get()};
+    while (!pending.empty()) {
+      const StringObject *piece = pending.back();
+      pending.pop_back();
+      if (piece->d_left) {
+        pending.push_back(piece->d_right.get());
+        pending.push_back(piece->d_left.get());
+      } else {
+        d_str += piece->d_str;
+      }
+    }
+    releasePieces();
+  }
+  return d_str;
+}
+
+std::size_t StringObject::size() const { return d_size; }
+
+std::size_t StringObject::hash() const {
+  if (d_hash == 0) {
+    d_hash = std::hash<std::string>{}(str());
+  }
+  return d_hash;
+}
+
+void StringObject::releasePieces() const {
+  std::vector<Ref<StringObject>> pending;
+  pending.push_back(std::move(d_left));
+  pending.push_back(std::move(d_right));
+  while (!pending.empty()) {
+    Ref<StringObject> piece = std::move(pending.back());
+    pending.pop_back();
+    // Take the pieces of a join that's freed as 'piece' goes out of scope
+    if (piece->refCount() == 1 && piece->d_left) {
+      pending.push_back(std::move(piece->d_left));
+      pending.push_back(std::move(piece->d_right));
+    }
+  }
+}
+
+void HeapObject::destroy() { delete this; }
+
+Value::Value(std::string str)
+    : Value(new StringObject(std::move(str)), Type::STRING) {}
+
+Value::Value(const char *str) : Value(std::string(str)) {}
+
+Value::Value(HeapObject *obj, Type t) : d_bits(k_nil) {
+  if (obj) {
+    d_bits = k_sign | k_qnan | reinterpret_cast<uint64_t>(obj) |
+             static_cast<uint64_t>(t);
+    obj->retain();
+  }
+}
+
+Value concat(const Value &l, const Value &r) {
+  auto *left = static_cast<StringObject *>(l.object());
+  auto *right = static_cast<StringObject *>(r.object());
+  if (right->size() == 0) {
+    return l;
+  } else if (left->size() == 0) {
+    return r;
+  } else if (left->size() + right->size() < k_minJoinSize) {
+    return left->str() + right->str();
+  }
+  auto *joined =
+      new StringObject(Ref<StringObject>(left), Ref<StringObject>(right));
+  return Value(joined, Value::Type::STRING);
+}
+
+namespace {
+template <typename Op> bool compare(const Value &l, const Value &r, Op op) {
+  if (l.type() != r.type()) {
+    return op(l.type(), r.type());
+  }
+
+  switch (l.type()) {
+  case Value::Type::NIL:
+    return op(std::monostate{}, std::monostate{});
+  case Value::Type::STRING:
+    return op(l.get<std::string>(), r.get<std::string>());
+  case Value::Type::BOOL:
+    return op(l.get<bool>(), r.get<bool>());
+  case Value::Type::NUMBER:
+    return op(l.get<double>(), r.get<double>());
+  case Value::Type::FUNCTION:
+    return op(l.get<FnDescShrdPtr>().object(),
+              r.get<FnDescShrdPtr>().object());
+  case Value::Type::CLASS:
+    return op(l.get<ClsDefShrdPtr>().object(),
+              r.get<ClsDefShrdPtr>().object());
+  default:
+    return op(l.get<ClsInstShrdPtr>().object(),
+              r.get<ClsInstShrdPtr>().object());
+  }
+}
+} // namespace
+
+namespace valueutils {
+
+bool equal(const Value &l, const Value &r) {
+  if (!l.is<std::string>() || !r.is<std::string>()) {
+    return compare(l, r, std::equal_to<>{});
+  }
+
+  // Strings that are the same object, or differ in size or hash, are
+  // compared without reading their characters. The hashes are kept, so
+  // strings compared again in a loop only compare characters when equal.
+  const StringObject &ls = l.asString();
+  const StringObject &rs = r.asString();
+  if (&ls == &rs) {
+    return true;
+  } else if (ls.size() != rs.size() || ls.hash() != rs.hash()) {
+    return false;
+  }
+  return ls.str() == rs.str();
+}
+
+bool less(const Value &l, const Value &r) {
+  return compare(l, r, std::less<>{});
+}
+
+} // namespace valueutils
+
+} // namespace treewalk
+} // namespace plox
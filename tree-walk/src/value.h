@@ -1,25 +1,407 @@
 #ifndef PLOX_VALUE_H
 #define PLOX_VALUE_H
 
-#include <memory>
+#include <bit>
+#include <cstdint>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 namespace plox {
 namespace treewalk {
 
+/*
+ Value is the type of every Lox value in the tree-walk interpreter.
+
+ It is NaN-boxed into 8 bytes. Doubles are stored as themselves. Every other
+ type is stored in the bits of a quiet NaN that arithmetic never produces:
+   - nil, false and true are fixed bit patterns
+   - heap objects (strings, functions, classes and instances) set the sign bit,
+     with the object pointer in the low 48 bits and the object type in the low
+     3 bits, which are free as objects are 8 byte aligned
+
+ Heap objects are reference counted through an intrusive count, so copying a
+ Value is a plain integer increment rather than an atomic one.
+
+ The API mirrors the std::variant Value used to be. 'visit' calls a visitor
+ with std::monostate, const std::string&, bool, double or a Ref to the object,
+ and Values of different types are ordered by type in the same order as the
+ variant's alternatives.
+*/
+
+// Under AddressSanitizer, live objects are kept on a list. LeakSanitizer
+// can't see a pointer in the bits of a NaN-boxed Value, so without the list it
+// reports objects only Values point to as leaked.
+#if defined(__SANITIZE_ADDRESS__)
+#define PLOX_LIST_HEAP_OBJECTS
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define PLOX_LIST_HEAP_OBJECTS
+#endif
+#endif
+
+class HeapObject {
+public:
+#ifdef PLOX_LIST_HEAP_OBJECTS
+  HeapObject() { link(); }
+  // A copied object is a new object, so starts without references
+  HeapObject(const HeapObject &) { link(); }
+  virtual ~HeapObject() { unlink(); }
+#else
+  HeapObject() = default;
+  // A copied object is a new object, so starts without references
+  HeapObject(const HeapObject &) {}
+  virtual ~HeapObject() = default;
+#endif
+  HeapObject &operator=(const HeapObject &) { return *this; }
+
+  int refCount() const { return d_refCount; }
+  void retain() { d_refCount++; }
+  void release() {
+    if (--d_refCount == 0) {
+      destroy();
+    }
+  }
+
+private:
+  // Out of line, so callers that release an object don't see it deleted
+  void destroy();
+
+  int d_refCount = 0;
+
+#ifdef PLOX_LIST_HEAP_OBJECTS
+  void link() {
+    d_next = s_live;
+    if (s_live) {
+      s_live->d_prev = this;
+    }
+    s_live = this;
+  }
+  void unlink() {
+    if (d_prev) {
+      d_prev->d_next = d_next;
+    } else {
+      s_live = d_next;
+    }
+    if (d_next) {
+      d_next->d_prev = d_prev;
+    }
+  }
+
+  static inline constinit HeapObject *s_live = nullptr;
+  HeapObject *d_prev = nullptr;
+  HeapObject *d_next = nullptr;
+#endif
+};
+
+// An owning pointer to a HeapObject of type T. The object is held as a
+// HeapObject so a Ref can be copied and destroyed where T is incomplete.
+template <typename T> class Ref {
+public:
+  using element_type = T;
+
+  Ref() : d_obj(nullptr) {}
+  explicit Ref(T *ptr) : Ref(static_cast<HeapObject *>(ptr)) {}
+  Ref(const Ref &other) : Ref(other.d_obj) {}
+  Ref(Ref &&other) : d_obj(std::exchange(other.d_obj, nullptr)) {}
+  ~Ref() {
+    if (d_obj) {
+      d_obj->release();
+    }
+  }
+
+  // Only valid when the object is known to be a T
+  static Ref fromObject(HeapObject *obj) { return Ref(obj); }
+
+  Ref &operator=(Ref other) {
+    std::swap(d_obj, other.d_obj);
+    return *this;
+  }
+
+  T *get() const { return static_cast<T *>(d_obj); }
+  T &operator*() const { return *get(); }
+  T *operator->() const { return get(); }
+  HeapObject *object() const { return d_obj; }
+  explicit operator bool() const { return d_obj; }
+
+  bool operator==(const Ref &other) const = default;
+
+private:
+  explicit Ref(HeapObject *obj) : d_obj(obj) {
+    if (d_obj) {
+      d_obj->retain();
+    }
+  }
+
+  HeapObject *d_obj;
+};
+
+template <typename T, typename... Args> Ref<T> makeRef(Args &&...args) {
+  return Ref<T>(new T(std::forward<Args>(args)...));
+}
+
+/*
+ A Lox string. Strings joined with '+' start out as a join of the two strings
+ rather than a copy of their characters, so building a string up a piece at a
+ time takes time in proportion to the pieces added. The characters are copied
+ into one string the first time it's read, i.e. when it's printed or compared,
+ and the pieces are released.
+*/
+class StringObject : public HeapObject {
+public:
+  explicit StringObject(std::string str);
+  StringObject(Ref<StringObject> left, Ref<StringObject> right);
+  ~StringObject();
+
+  const std::string &str() const;
+  std::size_t size() const;
+  // Worked out the first time it's needed, as strings never change
+  std::size_t hash() const;
+
+private:
+  // Freeing a join frees the joins it holds, so chains of joins are released
+  // here a join at a time rather than recursively
+  void releasePieces() const;
+
+  mutable std::string d_str;
+  // The strings this is a join of, until it's read
+  mutable Ref<StringObject> d_left;
+  mutable Ref<StringObject> d_right;
+  std::size_t d_size;
+  mutable std::size_t d_hash = 0; // Zero until worked out
+};
+
 // Forward declarations for ptrs to prevent circular deps
-struct ClassInstance;
-using ClsInstShrdPtr = std::shared_ptr<ClassInstance>;
-struct ClassDefinition;
-using ClsDefShrdPtr = std::shared_ptr<ClassDefinition>;
-struct FunctionDescription;
-using FnDescShrdPtr = std::shared_ptr<FunctionDescription>;
+class ClassInstance;
+using ClsInstShrdPtr = Ref<ClassInstance>;
+class ClassDefinition;
+using ClsDefShrdPtr = Ref<ClassDefinition>;
+class FunctionDescription;
+using FnDescShrdPtr = Ref<FunctionDescription>;
+class Function;
+
+class Value {
+public:
+  // In the same order as the std::variant alternatives Value replaced
+  enum class Type { NIL, STRING, BOOL, NUMBER, FUNCTION, CLASS, INSTANCE };
+
+  Value() : d_bits(k_nil) {}
+  Value(std::monostate) : d_bits(k_nil) {}
+  Value(bool b) : d_bits(b ? k_true : k_false) {}
+  Value(double d) : d_bits(boxDouble(d)) {}
+  Value(std::string str);
+  Value(const char *str);
+  Value(const FnDescShrdPtr &fn) : Value(fn.object(), Type::FUNCTION) {}
+  Value(const ClsDefShrdPtr &cls) : Value(cls.object(), Type::CLASS) {}
+  Value(const ClsInstShrdPtr &inst) : Value(inst.object(), Type::INSTANCE) {}
+  // Stops other pointers silently converting to bool
+  Value(const void *) = delete;
+
+  Value(const Value &other) : d_bits(other.d_bits) { retain(); }
+  Value(Value &&other) : d_bits(std::exchange(other.d_bits, k_nil)) {}
+  ~Value() { release(); }
+
+  Value &operator=(Value other) {
+    std::swap(d_bits, other.d_bits);
+    return *this;
+  }
+
+  Type type() const {
+    if ((d_bits & k_qnan) != k_qnan) {
+      return Type::NUMBER;
+    } else if (d_bits & k_sign) {
+      return static_cast<Type>(d_bits & k_tagMask);
+    }
+    return d_bits == k_nil ? Type::NIL : Type::BOOL;
+  }
+
+  // Type queries and accessors in the style of std::holds_alternative and
+  // std::get. get throws std::bad_variant_access for the wrong type.
+  template <typename T> bool is() const { return type() == typeOf<T>(); }
+  template <typename T> decltype(auto) get() const;
+
+  // A single test of the tag bits, for the arithmetic and comparisons that
+  // check both operands are numbers before anything else
+  bool isNumber() const { return (d_bits & k_qnan) != k_qnan; }
+  // The number held, without checking the type
+  double asNumber() const { return std::bit_cast<double>(d_bits); }
+  // The string object held, without checking the type. Copies of a string
+  // Value share the object.
+  const StringObject &asString() const {
+    return *static_cast<StringObject *>(object());
+  }
+
+private:
+  static constexpr uint64_t k_sign = 0x8000000000000000;
+  static constexpr uint64_t k_qnan = 0x7ffc000000000000;
+  static constexpr uint64_t k_nan = 0x7ff8000000000000;
+  static constexpr uint64_t k_nil = k_qnan | 1;
+  static constexpr uint64_t k_false = k_qnan | 2;
+  static constexpr uint64_t k_true = k_qnan | 3;
+  static constexpr uint64_t k_tagMask = 0x7;
+  static constexpr uint64_t k_ptrMask = 0x0000fffffffffff8;
+
+  Value(HeapObject *obj, Type t);
+
+  friend Value concat(const Value &l, const Value &r);
+
+  static uint64_t boxDouble(double d) {
+    uint64_t bits = std::bit_cast<uint64_t>(d);
+    // A NaN whose bits look like a boxed value is swapped for the standard NaN
+    if ((bits & k_qnan) == k_qnan) {
+      return k_nan | (bits & k_sign);
+    }
+    return bits;
+  }
+
+  template <typename T> static constexpr Type typeOf();
+
+  bool isObject() const {
+    return (d_bits & (k_sign | k_qnan)) == (k_sign | k_qnan);
+  }
+  HeapObject *object() const {
+    return reinterpret_cast<HeapObject *>(d_bits & k_ptrMask);
+  }
+  void retain() const {
+    if (isObject()) {
+      object()->retain();
+    }
+  }
+  void release() const {
+    if (isObject()) {
+      object()->release();
+    }
+  }
+
+  uint64_t d_bits;
+};
+
+// Joins two strings without copying their characters. Both must be strings.
+Value concat(const Value &l, const Value &r);
+
+static_assert(sizeof(Value) == 8);
+static_assert(sizeof(void *) == 8, "NaN-boxing needs 64 bit pointers");
+
+namespace valueutils {
+// Compares Values that aren't both numbers the way std::variant does. Values
+// of different types are ordered by type, otherwise the held values are
+// compared. Objects other than strings compare by identity.
+bool equal(const Value &l, const Value &r);
+bool less(const Value &l, const Value &r);
+} // namespace valueutils
+
+// Numbers are compared inline. Other types are ordered totally, so the
+// remaining operators are built from 'equal' and 'less'.
+inline bool operator==(const Value &l, const Value &r) {
+  if (l.isNumber() && r.isNumber()) {
+    return l.asNumber() == r.asNumber();
+  }
+  return valueutils::equal(l, r);
+}
+
+inline bool operator!=(const Value &l, const Value &r) { return !(l == r); }
+
+inline bool operator<(const Value &l, const Value &r) {
+  if (l.isNumber() && r.isNumber()) {
+    return l.asNumber() < r.asNumber();
+  }
+  return valueutils::less(l, r);
+}
+
+inline bool operator>(const Value &l, const Value &r) { return r < l; }
+
+inline bool operator<=(const Value &l, const Value &r) {
+  if (l.isNumber() && r.isNumber()) {
+    return l.asNumber() <= r.asNumber();
+  }
+  return !valueutils::less(r, l);
+}
+
+inline bool operator>=(const Value &l, const Value &r) { return r <= l; }
+
+template <typename T> constexpr Value::Type Value::typeOf() {
+  if constexpr (std::is_same_v<T, std::monostate>) {
+    return Type::NIL;
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return Type::STRING;
+  } else if constexpr (std::is_same_v<T, bool>) {
+    return Type::BOOL;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return Type::NUMBER;
+  } else if constexpr (std::is_same_v<T, FnDescShrdPtr>) {
+    return Type::FUNCTION;
+  } else if constexpr (std::is_same_v<T, ClsDefShrdPtr>) {
+    return Type::CLASS;
+  } else {
+    static_assert(std::is_same_v<T, ClsInstShrdPtr>, "Not a Value type");
+    return Type::INSTANCE;
+  }
+}
+
+template <typename T> decltype(auto) Value::get() const {
+  if (!is<T>()) {
+    throw std::bad_variant_access();
+  }
+
+  if constexpr (std::is_same_v<T, std::monostate>) {
+    return std::monostate{};
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return static_cast<const std::string &>(
+        static_cast<StringObject *>(object())->str());
+  } else if constexpr (std::is_same_v<T, bool>) {
+    return d_bits == k_true;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return std::bit_cast<double>(d_bits);
+  } else {
+    return T::fromObject(object());
+  }
+}
+
+// Calls the visitor with the value held, like std::visit
+template <typename Visitor>
+decltype(auto) visit(Visitor &&vis, const Value &v) {
+  switch (v.type()) {
+  case Value::Type::NIL: {
+    std::monostate nil;
+    return vis(nil);
+  }
+  case Value::Type::STRING:
+    return vis(v.get<std::string>());
+  case Value::Type::BOOL: {
+    bool b = v.get<bool>();
+    return vis(b);
+  }
+  case Value::Type::NUMBER: {
+    double d = v.get<double>();
+    return vis(d);
+  }
+  case Value::Type::FUNCTION: {
+    FnDescShrdPtr fn = v.get<FnDescShrdPtr>();
+    return vis(fn);
+  }
+  case Value::Type::CLASS: {
+    ClsDefShrdPtr cls = v.get<ClsDefShrdPtr>();
+    return vis(cls);
+  }
+  default: {
+    ClsInstShrdPtr inst = v.get<ClsInstShrdPtr>();
+    return vis(inst);
+  }
+  }
+}
 
-using Value = std::variant<std::monostate, std::string, bool, double,
-                           FnDescShrdPtr, ClsDefShrdPtr, ClsInstShrdPtr>;
+template <typename Visitor>
+decltype(auto) visit(Visitor &&vis, const Value &l, const Value &r) {
+  return visit(
+      [&](auto &&lv) -> decltype(auto) {
+        return visit([&](auto &&rv) -> decltype(auto) { return vis(lv, rv); },
+                     r);
+      },
+      l);
+}
 
 } // namespace treewalk
 } // namespace plox
 
-#endif
\ No newline at end of file
+#endif
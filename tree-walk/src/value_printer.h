@@ -6,7 +6,6 @@
 #include <class.h>
 #include <func.h>
 
-#include <memory>
 #include <sstream>
 #include <string>
 #include <variant>
@@ -14,31 +13,23 @@
 namespace plox {
 namespace treewalk {
 
-using ClsInstShrdPtr = std::shared_ptr<ClassInstance>;
-using ClsDefShrdPtr = std::shared_ptr<ClassDefinition>;
-using FnDescShrdPtr = std::shared_ptr<FunctionDescription>;
-
-using Value = std::variant<std::monostate, std::string, bool, double,
-                           FnDescShrdPtr, ClsDefShrdPtr, ClsInstShrdPtr>;
-
 // Concepts to control which template method should be chosen
 template <typename T>
-concept SharedPtr =
-    std::same_as<std::decay_t<T>,
-                 std::shared_ptr<typename std::decay_t<T>::element_type>>;
+concept ObjectRef =
+    std::same_as<std::decay_t<T>, Ref<typename std::decay_t<T>::element_type>>;
 template <typename T>
-concept NotSharedPtr = !SharedPtr<T>;
+concept NotObjectRef = !ObjectRef<T>;
 
 struct ValuePrinter {
   std::string operator()(std::monostate);
 
-  template <NotSharedPtr T> std::string operator()(T &&streamableType) {
+  template <NotObjectRef T> std::string operator()(T &&streamableType) {
     std::ostringstream ss;
     ss << streamableType;
     return ss.str();
   }
 
-  template <SharedPtr T> std::string operator()(T &&streamableTypePtr) {
+  template <ObjectRef T> std::string operator()(T &&streamableTypePtr) {
     if (streamableTypePtr) {
       return operator()(*streamableTypePtr);
     }
@@ -49,4 +40,4 @@ struct ValuePrinter {
 } // namespace treewalk
 } // namespace plox
 
-#endif
\ No newline at end of file
+#endif
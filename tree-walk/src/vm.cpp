@@ -0,0 +1,802 @@
+#include <vm.h>
+
+#include <vm_compiler.h>
+#include <vm_opcode.h>
+
+#include <chrono>
+#include <climits>
+#include <compare>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace plox {
+namespace treewalk {
+namespace vm {
+
+void interpret(std::vector<stmt::Stmt> &stmts, VM &vm,
+               std::vector<InterpretException> &errs) {
+  try {
+    vm.interpret(stmts);
+  } catch (const InterpretException &e) {
+    errs.push_back(e);
+  }
+}
+
+namespace {
+// The budget is split so that every frame could hold this many values
+constexpr std::size_t k_valuesPerFrame = 16;
+constexpr size_t k_firstGC = 1024 * 1024;
+constexpr int k_gcGrowFactor = 2;
+
+// Values of different types are ordered by the type, matching the order of the
+// types in the tree walk interpreter's std::variant.
+int typeRank(Value v) {
+  switch (v.type()) {
+  case Value::Type::NIL:
+    return 0;
+  case Value::Type::BOOL:
+    return 2;
+  case Value::Type::NUMBER:
+    return 3;
+  case Value::Type::OBJ:
+    break;
+  }
+  switch (v.asObj()->type) {
+  case ObjType::STRING:
+    return 1;
+  case ObjType::CLASS:
+    return 5;
+  case ObjType::INSTANCE:
+    return 6;
+  default:
+    return 4;
+  }
+}
+
+std::partial_ordering compare(Value a, Value b) {
+  int rankA = typeRank(a);
+  int rankB = typeRank(b);
+  if (rankA != rankB) {
+    return rankA <=> rankB;
+  }
+  switch (a.type()) {
+  case Value::Type::NIL:
+    return std::partial_ordering::equivalent;
+  case Value::Type::BOOL:
+    return a.asBool() <=> b.asBool();
+  case Value::Type::NUMBER:
+    return a.asNumber() <=> b.asNumber();
+  case Value::Type::OBJ:
+    break;
+  }
+  if (a.isObjType(ObjType::STRING)) {
+    return a.as<ObjString>()->chars <=> b.as<ObjString>()->chars;
+  }
+  return std::compare_three_way{}(a.asObj(), b.asObj());
+}
+
+Value clockNative(VM &vm) {
+  // Use steady_clock bc it's monotonic so won't go backwards when the clocks
+  // change unlike system_clock
+  auto duration = std::chrono::steady_clock::now().time_since_epoch();
+  return Value::number(
+      std::chrono::duration<double, std::milli>(duration).count());
+}
+
+Value versionNative(VM &vm) { return Value::obj(vm.intern("tree-walk")); }
+} // namespace
+
+VM::VM(std::size_t stackBudget)
+    : d_frameCount(0),
+      d_framesMax(stackBudget /
+                  (sizeof(CallFrame) + k_valuesPerFrame * sizeof(Value))),
+      d_openUpvalues(nullptr), d_globalsDefined(0), d_initString(nullptr),
+      d_objects(nullptr), d_bytesAllocated(0), d_nextGC(k_firstGC),
+      d_numCollections(0) {
+  std::size_t stackMax =
+      (stackBudget - d_framesMax * sizeof(CallFrame)) / sizeof(Value);
+  d_stack = std::make_unique_for_overwrite<Value[]>(stackMax);
+  d_stackTop = d_stack.get();
+  d_stackEnd = d_stack.get() + stackMax;
+  d_frames = std::make_unique_for_overwrite<CallFrame[]>(d_framesMax);
+  d_initString = intern("init");
+  defineNative("clock", clockNative);
+  defineNative("version", versionNative);
+}
+
+VM::~VM() {
+  Obj *obj = d_objects;
+  while (obj) {
+    Obj *next = obj->next;
+    delete obj;
+    obj = next;
+  }
+}
+
+void VM::interpret(const std::vector<stmt::Stmt> &stmts) {
+  try {
+    ObjFunction *script = compile(stmts, *this);
+    ObjClosure *closure = allocate<ObjClosure>(script, INT_MAX);
+    push(Value::obj(closure));
+    call(closure, 0);
+    run();
+  } catch (const InterpretException &) {
+    std::cout.flush();
+    resetStack();
+    throw;
+  }
+  std::cout.flush();
+}
+
+ObjString *VM::intern(std::string_view chars) {
+  auto it = d_strings.find(chars);
+  if (it != d_strings.end()) {
+    return it->second;
+  }
+  ObjString *str = allocate<ObjString>(std::string(chars));
+  str->size += str->chars.size();
+  d_bytesAllocated += str->chars.size();
+  d_strings.emplace(str->chars, str);
+  return str;
+}
+
+int VM::globalIndex(ObjString *name) {
+  auto it = d_globalIndices.find(name);
+  if (it != d_globalIndices.end()) {
+    return it->second;
+  }
+  if (d_globals.size() > std::numeric_limits<uint16_t>::max()) {
+    throw InterpretException("Too many global variables");
+  }
+  d_globals.push_back({name, Value::nil(), 0});
+  d_globalIndices[name] = d_globals.size() - 1;
+  return d_globals.size() - 1;
+}
+
+int VM::getNumCollections() const { return d_numCollections; }
+
+void VM::run() {
+  CallFrame *frame = &d_frames[d_frameCount - 1];
+  uint8_t *ip = frame->ip;
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+#define READ_CONSTANT()                                                        \
+  (frame->closure->function->chunk.constants[READ_SHORT()])
+#define READ_STRING() (READ_CONSTANT().as<ObjString>())
+// Calls change the current frame. Save our position before, and pick up the
+// new frame after.
+#define SAVE_FRAME() (frame->ip = ip)
+#define LOAD_FRAME()                                                           \
+  do {                                                                         \
+    frame = &d_frames[d_frameCount - 1];                                       \
+    ip = frame->ip;                                                            \
+  } while (false)
+#define NUMBER_OP(op, verb)                                                    \
+  do {                                                                         \
+    Value b = peek(0);                                                         \
+    Value a = peek(1);                                                         \
+    if (!a.isNumber() || !b.isNumber()) {                                      \
+      throw InterpretException("Unable to " verb " types: " + typeName(a) +    \
+                               " and " + typeName(b));                         \
+    }                                                                          \
+    pop();                                                                     \
+    d_stackTop[-1] = Value::number(a.asNumber() op b.asNumber());              \
+  } while (false)
+#define COMPARE_OP(op)                                                         \
+  do {                                                                         \
+    Value b = pop();                                                           \
+    Value a = peek(0);                                                         \
+    if (a.isNumber() && b.isNumber()) {                                        \
+      d_stackTop[-1] = Value::boolean(a.asNumber() op b.asNumber());           \
+    } else {                                                                   \
+      d_stackTop[-1] = Value::boolean(compare(a, b) op 0);                     \
+    }                                                                          \
+  } while (false)
+
+  while (true) {
+    switch (static_cast<OpCode>(READ_BYTE())) {
+    case OpCode::CONSTANT:
+      push(READ_CONSTANT());
+      break;
+    case OpCode::NIL:
+      push(Value::nil());
+      break;
+    case OpCode::TRUE:
+      push(Value::boolean(true));
+      break;
+    case OpCode::FALSE:
+      push(Value::boolean(false));
+      break;
+    case OpCode::POP:
+      pop();
+      break;
+    case OpCode::GET_LOCAL:
+      push(frame->slots[READ_BYTE()]);
+      break;
+    case OpCode::SET_LOCAL:
+      frame->slots[READ_BYTE()] = peek(0);
+      break;
+    case OpCode::GET_UPVALUE:
+      push(*frame->closure->upvalues[READ_BYTE()]->location);
+      break;
+    case OpCode::SET_UPVALUE:
+      *frame->closure->upvalues[READ_BYTE()]->location = peek(0);
+      break;
+    case OpCode::GET_GLOBAL: {
+      Global &g = d_globals[READ_SHORT()];
+      if (!isVisible(g, *frame)) {
+        throw InterpretException("Unknown variable: " + g.name->chars);
+      }
+      push(g.value);
+      break;
+    }
+    case OpCode::DEFINE_GLOBAL: {
+      Global &g = d_globals[READ_SHORT()];
+      if (g.definedAt) {
+        throw InterpretException("Cannot redefine variable: " + g.name->chars);
+      }
+      g.value = pop();
+      g.definedAt = ++d_globalsDefined;
+      break;
+    }
+    case OpCode::SET_GLOBAL: {
+      Global &g = d_globals[READ_SHORT()];
+      if (!isVisible(g, *frame)) {
+        throw InterpretException("Cannot assign unknown variable: " +
+                                 g.name->chars);
+      }
+      g.value = peek(0);
+      break;
+    }
+    case OpCode::GET_PROPERTY: {
+      ObjString *name = READ_STRING();
+      Value obj = peek(0);
+      if (!obj.isObjType(ObjType::INSTANCE)) {
+        throw InterpretException(
+            "Tried to get a property on non class instance " + toString(obj));
+      }
+      ObjInstance *instance = obj.as<ObjInstance>();
+      auto field = instance->fields.find(name);
+      if (field != instance->fields.end()) {
+        d_stackTop[-1] = field->second;
+        break;
+      }
+      bindMethod(instance->klass, name);
+      maybeCollect();
+      break;
+    }
+    case OpCode::SET_PROPERTY: {
+      ObjString *name = READ_STRING();
+      Value obj = peek(1);
+      if (!obj.isObjType(ObjType::INSTANCE)) {
+        throw InterpretException(
+            "Tried to set a property on non class instance " + toString(obj));
+      }
+      obj.as<ObjInstance>()->fields[name] = renamed(peek(0), name);
+      pop();
+      d_stackTop[-1] = Value::nil();
+      maybeCollect();
+      break;
+    }
+    case OpCode::GET_SUPER: {
+      ObjString *name = READ_STRING();
+      ObjClass *superclass = pop().as<ObjClass>();
+      bindMethod(superclass, name);
+      maybeCollect();
+      break;
+    }
+    case OpCode::GET_IMPLICIT: {
+      ObjString *name = READ_STRING();
+      uint16_t offset = READ_SHORT();
+      ObjInstance *instance = peek(0).as<ObjInstance>();
+      auto field = instance->fields.find(name);
+      if (field != instance->fields.end()) {
+        d_stackTop[-1] = field->second;
+        ip += offset;
+      } else if (instance->klass->methods.contains(name)) {
+        bindMethod(instance->klass, name);
+        ip += offset;
+        maybeCollect();
+      } else {
+        pop();
+      }
+      break;
+    }
+    case OpCode::SET_IMPLICIT: {
+      ObjString *name = READ_STRING();
+      uint16_t offset = READ_SHORT();
+      ObjInstance *instance = pop().as<ObjInstance>();
+      auto field = instance->fields.find(name);
+      if (field != instance->fields.end()) {
+        field->second = peek(0);
+        ip += offset;
+      } else if (instance->klass->methods.contains(name)) {
+        instance->fields[name] = peek(0);
+        ip += offset;
+      }
+      break;
+    }
+    case OpCode::EQUAL: {
+      Value b = pop();
+      d_stackTop[-1] = Value::boolean(valuesEqual(peek(0), b));
+      break;
+    }
+    case OpCode::NOT_EQUAL: {
+      Value b = pop();
+      d_stackTop[-1] = Value::boolean(!valuesEqual(peek(0), b));
+      break;
+    }
+    case OpCode::GREATER:
+      COMPARE_OP(>);
+      break;
+    case OpCode::GREATER_EQUAL:
+      COMPARE_OP(>=);
+      break;
+    case OpCode::LESS:
+      COMPARE_OP(<);
+      break;
+    case OpCode::LESS_EQUAL:
+      COMPARE_OP(<=);
+      break;
+    case OpCode::ADD: {
+      Value b = peek(0);
+      Value a = peek(1);
+      if (a.isNumber() && b.isNumber()) {
+        pop();
+        d_stackTop[-1] = Value::number(a.asNumber() + b.asNumber());
+      } else if (a.isObjType(ObjType::STRING) &&
+                 b.isObjType(ObjType::STRING)) {
+        ObjString *str =
+            intern(a.as<ObjString>()->chars + b.as<ObjString>()->chars);
+        pop();
+        d_stackTop[-1] = Value::obj(str);
+        maybeCollect();
+      } else {
+        throw InterpretException("Unable to add types: " + typeName(a) +
+                                 " and " + typeName(b));
+      }
+      break;
+    }
+    case OpCode::SUBTRACT:
+      NUMBER_OP(-, "subtract");
+      break;
+    case OpCode::MULTIPLY:
+      NUMBER_OP(*, "multiply");
+      break;
+    case OpCode::DIVIDE:
+      NUMBER_OP(/, "divide");
+      break;
+    case OpCode::NOT:
+      d_stackTop[-1] = Value::boolean(!isTruthy(peek(0)));
+      break;
+    case OpCode::NEGATE: {
+      // Matches the tree walker, which evaluates -x as 0 - x
+      Value v = peek(0);
+      if (!v.isNumber()) {
+        throw InterpretException("Unable to subtract types: number and " +
+                                 typeName(v));
+      }
+      d_stackTop[-1] = Value::number(0.0 - v.asNumber());
+      break;
+    }
+    case OpCode::PRINT:
+      std::cout << toString(pop()) << '\n';
+      break;
+    case OpCode::JUMP: {
+      uint16_t offset = READ_SHORT();
+      ip += offset;
+      break;
+    }
+    case OpCode::JUMP_IF_FALSE: {
+      uint16_t offset = READ_SHORT();
+      if (!isTruthy(peek(0))) {
+        ip += offset;
+      }
+      break;
+    }
+    case OpCode::LOOP: {
+      uint16_t offset = READ_SHORT();
+      ip -= offset;
+      break;
+    }
+    case OpCode::CALL: {
+      int argCount = READ_BYTE();
+      SAVE_FRAME();
+      callValue(peek(argCount), argCount);
+      LOAD_FRAME();
+      maybeCollect();
+      break;
+    }
+    case OpCode::INVOKE: {
+      ObjString *name = READ_STRING();
+      int argCount = READ_BYTE();
+      SAVE_FRAME();
+      invoke(name, argCount);
+      LOAD_FRAME();
+      maybeCollect();
+      break;
+    }
+    case OpCode::SUPER_INVOKE: {
+      ObjString *name = READ_STRING();
+      int argCount = READ_BYTE();
+      ObjClass *superclass = pop().as<ObjClass>();
+      SAVE_FRAME();
+      invokeFromClass(superclass, name, argCount);
+      LOAD_FRAME();
+      break;
+    }
+    case OpCode::CLOSURE: {
+      ObjFunction *fn = READ_CONSTANT().as<ObjFunction>();
+      int visible = std::min(frame->closure->globalsVisible, d_globalsDefined);
+      ObjClosure *closure = allocate<ObjClosure>(fn, visible);
+      push(Value::obj(closure));
+      for (int i = 0; i < closure->upvalues.size(); i++) {
+        uint8_t isLocal = READ_BYTE();
+        uint8_t index = READ_BYTE();
+        closure->upvalues[i] = isLocal ? captureUpvalue(frame->slots + index)
+                                       : frame->closure->upvalues[index];
+      }
+      maybeCollect();
+      break;
+    }
+    case OpCode::CLOSE_UPVALUE:
+      closeUpvalues(d_stackTop - 1);
+      pop();
+      break;
+    case OpCode::RETURN_INIT:
+    case OpCode::RETURN: {
+      Value result = pop();
+      if (static_cast<OpCode>(ip[-1]) == OpCode::RETURN_INIT) {
+        // Initialisers always return 'this'
+        if (!result.isNil()) {
+          throw InterpretException(
+              "No explicit return allowed from a class initialiser");
+        }
+        result = frame->slots[0];
+      }
+      closeUpvalues(frame->slots);
+      d_frameCount--;
+      d_stackTop = frame->slots;
+      if (d_frameCount == 0) {
+        return;
+      }
+      push(result);
+      LOAD_FRAME();
+      break;
+    }
+    case OpCode::CLASS:
+      push(Value::obj(allocate<ObjClass>(READ_STRING())));
+      maybeCollect();
+      break;
+    case OpCode::INHERIT: {
+      // Methods are not inherited. Subclasses can only reach them through
+      // 'super'.
+      if (!peek(1).isObjType(ObjType::CLASS)) {
+        throw InterpretException("Super class for " +
+                                 peek(0).as<ObjClass>()->name->chars +
+                                 " must be a class");
+      }
+      pop();
+      break;
+    }
+    case OpCode::METHOD: {
+      ObjString *name = READ_STRING();
+      peek(1).as<ObjClass>()->methods[name] = peek(0);
+      pop();
+      break;
+    }
+    }
+  }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef READ_CONSTANT
+#undef READ_STRING
+#undef SAVE_FRAME
+#undef LOAD_FRAME
+#undef NUMBER_OP
+#undef COMPARE_OP
+}
+
+void VM::push(Value v) { *d_stackTop++ = v; }
+
+Value VM::pop() { return *--d_stackTop; }
+
+Value VM::peek(int distance) const { return d_stackTop[-1 - distance]; }
+
+void VM::resetStack() {
+  d_stackTop = d_stack.get();
+  d_frameCount = 0;
+  d_openUpvalues = nullptr;
+}
+
+void VM::callValue(Value callee, int argCount) {
+  if (!callee.isObj()) {
+    throw InterpretException("Tried to call non callable object " +
+                             toString(callee));
+  }
+
+  switch (callee.asObj()->type) {
+  case ObjType::BOUND_METHOD: {
+    ObjBoundMethod *bound = callee.as<ObjBoundMethod>();
+    d_stackTop[-argCount - 1] = bound->receiver;
+    return call(bound->method, argCount);
+  }
+  case ObjType::CLASS: {
+    ObjClass *klass = callee.as<ObjClass>();
+    d_stackTop[-argCount - 1] = Value::obj(allocate<ObjInstance>(klass));
+    auto init = klass->methods.find(d_initString);
+    if (init != klass->methods.end()) {
+      return call(init->second.as<ObjClosure>(), argCount);
+    }
+    // Without an initialiser any args are ignored
+    d_stackTop -= argCount;
+    return;
+  }
+  case ObjType::CLOSURE:
+    return call(callee.as<ObjClosure>(), argCount);
+  case ObjType::NATIVE: {
+    ObjNative *native = callee.as<ObjNative>();
+    if (argCount != 0) {
+      std::ostringstream ss;
+      ss << "Tried to call " << native->name->chars << " with " << argCount
+         << " args when function accepts 0 args.";
+      throw InterpretException(ss.str());
+    }
+    Value result = native->fn(*this);
+    d_stackTop -= argCount + 1;
+    return push(result);
+  }
+  default:
+    throw InterpretException("Tried to call non callable object " +
+                             toString(callee));
+  }
+}
+
+void VM::call(ObjClosure *closure, int argCount) {
+  ObjFunction *fn = closure->function;
+  if (argCount != fn->arity) {
+    ObjString *name = closure->name ? closure->name : fn->name;
+    std::ostringstream ss;
+    ss << "Tried to call " << (name ? name->chars : "script") << " with "
+       << argCount << " args when function accepts " << fn->arity << " args.";
+    throw InterpretException(ss.str());
+  }
+  // Checking the frame has room for all the values it can push means pushes
+  // don't need checking
+  Value *slots = d_stackTop - argCount - 1;
+  if (d_frameCount == d_framesMax || d_stackEnd - slots < fn->maxStack) {
+    throw InterpretException("Stack overflow");
+  }
+
+  CallFrame &frame = d_frames[d_frameCount++];
+  frame.closure = closure;
+  frame.ip = fn->chunk.code.data();
+  frame.slots = slots;
+}
+
+void VM::invoke(ObjString *name, int argCount) {
+  Value receiver = peek(argCount);
+  if (!receiver.isObjType(ObjType::INSTANCE)) {
+    throw InterpretException("Tried to get a property on non class instance " +
+                             toString(receiver));
+  }
+
+  // Fields shadow methods
+  ObjInstance *instance = receiver.as<ObjInstance>();
+  auto field = instance->fields.find(name);
+  if (field != instance->fields.end()) {
+    d_stackTop[-argCount - 1] = field->second;
+    return callValue(field->second, argCount);
+  }
+  invokeFromClass(instance->klass, name, argCount);
+}
+
+void VM::invokeFromClass(ObjClass *klass, ObjString *name, int argCount) {
+  auto method = klass->methods.find(name);
+  if (method == klass->methods.end()) {
+    throw InterpretException("Unknown variable: " + name->chars);
+  }
+  call(method->second.as<ObjClosure>(), argCount);
+}
+
+void VM::bindMethod(ObjClass *klass, ObjString *name) {
+  auto method = klass->methods.find(name);
+  if (method == klass->methods.end()) {
+    throw InterpretException("Unknown variable: " + name->chars);
+  }
+  auto *bound =
+      allocate<ObjBoundMethod>(peek(0), method->second.as<ObjClosure>());
+  d_stackTop[-1] = Value::obj(bound);
+}
+
+ObjUpvalue *VM::captureUpvalue(Value *local) {
+  // Open upvalues are sorted by stack slot, with the highest slot first
+  ObjUpvalue *prev = nullptr;
+  ObjUpvalue *upvalue = d_openUpvalues;
+  while (upvalue && upvalue->location > local) {
+    prev = upvalue;
+    upvalue = upvalue->nextOpen;
+  }
+  if (upvalue && upvalue->location == local) {
+    return upvalue;
+  }
+
+  ObjUpvalue *created = allocate<ObjUpvalue>(local);
+  created->nextOpen = upvalue;
+  if (prev) {
+    prev->nextOpen = created;
+  } else {
+    d_openUpvalues = created;
+  }
+  return created;
+}
+
+void VM::closeUpvalues(Value *last) {
+  while (d_openUpvalues && d_openUpvalues->location >= last) {
+    ObjUpvalue *upvalue = d_openUpvalues;
+    upvalue->closed = *upvalue->location;
+    upvalue->location = &upvalue->closed;
+    d_openUpvalues = upvalue->nextOpen;
+  }
+}
+
+Value VM::renamed(Value fn, ObjString *name) {
+  // Functions stored on an instance take the name of the property, like the
+  // tree walker
+  if (fn.isObjType(ObjType::CLOSURE)) {
+    ObjClosure *orig = fn.as<ObjClosure>();
+    ObjClosure *copy = allocate<ObjClosure>(*orig);
+    copy->name = name;
+    return Value::obj(copy);
+  }
+  if (fn.isObjType(ObjType::BOUND_METHOD)) {
+    ObjBoundMethod *orig = fn.as<ObjBoundMethod>();
+    Value method = renamed(Value::obj(orig->method), name);
+    return Value::obj(
+        allocate<ObjBoundMethod>(orig->receiver, method.as<ObjClosure>()));
+  }
+  return fn;
+}
+
+void VM::defineNative(std::string_view name, NativeFn fn) {
+  ObjString *str = intern(name);
+  Global &g = d_globals[globalIndex(str)];
+  g.value = Value::obj(allocate<ObjNative>(str, fn));
+  g.definedAt = ++d_globalsDefined;
+}
+
+bool VM::isVisible(const Global &g, const CallFrame &frame) const {
+  return g.definedAt && g.definedAt <= frame.closure->globalsVisible;
+}
+
+void VM::maybeCollect() {
+  if (d_bytesAllocated > d_nextGC) {
+    collectGarbage();
+  }
+}
+
+void VM::collectGarbage() {
+  // Mark everything reachable from the roots
+  for (Value *slot = d_stack.get(); slot < d_stackTop; slot++) {
+    markValue(*slot);
+  }
+  for (int i = 0; i < d_frameCount; i++) {
+    markObject(d_frames[i].closure);
+  }
+  for (ObjUpvalue *up = d_openUpvalues; up; up = up->nextOpen) {
+    markObject(up);
+  }
+  for (auto &g : d_globals) {
+    markObject(g.name);
+    markValue(g.value);
+  }
+  markObject(d_initString);
+
+  while (!d_grayStack.empty()) {
+    Obj *obj = d_grayStack.back();
+    d_grayStack.pop_back();
+    blackenObject(obj);
+  }
+
+  // Interned strings are weak references
+  std::erase_if(d_strings, [](auto &kv) { return !kv.second->isMarked; });
+
+  // Sweep
+  Obj *prev = nullptr;
+  Obj *obj = d_objects;
+  while (obj) {
+    if (obj->isMarked) {
+      obj->isMarked = false;
+      prev = obj;
+      obj = obj->next;
+      continue;
+    }
+    Obj *unreached = obj;
+    obj = obj->next;
+    if (prev) {
+      prev->next = obj;
+    } else {
+      d_objects = obj;
+    }
+    d_bytesAllocated -= unreached->size;
+    delete unreached;
+  }
+
+  d_nextGC = std::max(d_bytesAllocated * k_gcGrowFactor, k_firstGC);
+  d_numCollections++;
+}
+
+void VM::markValue(Value v) {
+  if (v.isObj()) {
+    markObject(v.asObj());
+  }
+}
+
+void VM::markObject(Obj *obj) {
+  if (!obj || obj->isMarked) {
+    return;
+  }
+  obj->isMarked = true;
+  d_grayStack.push_back(obj);
+}
+
+void VM::blackenObject(Obj *obj) {
+  switch (obj->type) {
+  case ObjType::BOUND_METHOD: {
+    auto *bound = static_cast<ObjBoundMethod *>(obj);
+    markValue(bound->receiver);
+    markObject(bound->method);
+    break;
+  }
+  case ObjType::CLASS: {
+    auto *klass = static_cast<ObjClass *>(obj);
+    markObject(klass->name);
+    for (auto &[name, method] : klass->methods) {
+      markObject(name);
+      markValue(method);
+    }
+    break;
+  }
+  case ObjType::CLOSURE: {
+    auto *closure = static_cast<ObjClosure *>(obj);
+    markObject(closure->function);
+    markObject(closure->name);
+    for (ObjUpvalue *up : closure->upvalues) {
+      markObject(up);
+    }
+    break;
+  }
+  case ObjType::FUNCTION: {
+    auto *fn = static_cast<ObjFunction *>(obj);
+    markObject(fn->name);
+    for (Value v : fn->chunk.constants) {
+      markValue(v);
+    }
+    break;
+  }
+  case ObjType::INSTANCE: {
+    auto *instance = static_cast<ObjInstance *>(obj);
+    markObject(instance->klass);
+    for (auto &[name, value] : instance->fields) {
+      markObject(name);
+      markValue(value);
+    }
+    break;
+  }
+  case ObjType::NATIVE:
+    markObject(static_cast<ObjNative *>(obj)->name);
+    break;
+  case ObjType::UPVALUE:
+    markValue(static_cast<ObjUpvalue *>(obj)->closed);
+    break;
+  case ObjType::STRING:
+    break;
+  }
+}
+
+} // namespace vm
+} // namespace treewalk
+} // namespace plox
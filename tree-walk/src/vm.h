@@ -0,0 +1,140 @@
+#ifndef TREEWALK_VM_H
+#define TREEWALK_VM_H
+
+#include <errs.h>
+#include <stmt.h>
+#include <vm_object.h>
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace vm {
+
+class VM;
+
+// The memory the VM's value stack and call frames may use before a Lox stack
+// overflow
+constexpr std::size_t k_defaultStackBudget = 64 * 1024 * 1024;
+
+// The entrypoint to the bytecode engine. Compiles the statements from the
+// parser to bytecode and runs them on the VM.
+void interpret(std::vector<stmt::Stmt> &stmts, VM &vm,
+               std::vector<InterpretException> &errs);
+
+/*
+ A stack based virtual machine that runs the bytecode created by the compiler.
+
+ Values live in a contiguous stack, with each call getting a window onto the
+ stack for its args and locals. Lox function calls do not recurse on the C++
+ stack, they push a CallFrame and carry on in the same loop.
+
+ The value stack and the frames are allocated up front from a budget of bytes,
+ and going over either throws an InterpretException. Their pages are only
+ touched as the stack grows, so a large budget costs little until it's used.
+
+ Globals are kept between calls to interpret() so the REPL can build on
+ earlier input.
+*/
+class VM {
+public:
+  explicit VM(std::size_t stackBudget = k_defaultStackBudget);
+  ~VM();
+  VM(const VM &) = delete;
+  VM &operator=(const VM &) = delete;
+
+  // Throws an InterpretException if the code fails to compile or run
+  void interpret(const std::vector<stmt::Stmt> &stmts);
+
+  // Heap operations used by the compiler and natives. Objects are owned by the
+  // VM and freed by the garbage collector once they are unreachable. The
+  // collector only runs between instructions, so objects allocated while
+  // compiling are safe until the script starts running.
+  template <typename T, typename... Args> T *allocate(Args &&...args) {
+    T *obj = new T(std::forward<Args>(args)...);
+    obj->next = d_objects;
+    d_objects = obj;
+    obj->size = sizeof(T);
+    d_bytesAllocated += obj->size;
+    return obj;
+  }
+  ObjString *intern(std::string_view chars);
+  int globalIndex(ObjString *name);
+
+  // Garbage collection stats
+  int getNumCollections() const;
+
+private:
+  struct CallFrame {
+    ObjClosure *closure;
+    uint8_t *ip;
+    Value *slots;
+  };
+
+  struct Global {
+    ObjString *name;
+    Value value;
+    // Order the global was defined in, starting at 1. 0 if not yet defined.
+    int definedAt;
+  };
+
+  void run();
+
+  // Stack
+  void push(Value v);
+  Value pop();
+  Value peek(int distance) const;
+  void resetStack();
+
+  // Calls
+  void callValue(Value callee, int argCount);
+  void call(ObjClosure *closure, int argCount);
+  void invoke(ObjString *name, int argCount);
+  void invokeFromClass(ObjClass *klass, ObjString *name, int argCount);
+  void bindMethod(ObjClass *klass, ObjString *name);
+  ObjUpvalue *captureUpvalue(Value *local);
+  void closeUpvalues(Value *last);
+  Value renamed(Value fn, ObjString *name);
+
+  // Globals
+  void defineNative(std::string_view name, NativeFn fn);
+  bool isVisible(const Global &g, const CallFrame &frame) const;
+
+  // Garbage collection
+  void maybeCollect();
+  void collectGarbage();
+  void markValue(Value v);
+  void markObject(Obj *obj);
+  void blackenObject(Obj *obj);
+
+  std::unique_ptr<Value[]> d_stack;
+  Value *d_stackTop;
+  Value *d_stackEnd;
+  std::unique_ptr<CallFrame[]> d_frames;
+  int d_frameCount;
+  int d_framesMax;
+  ObjUpvalue *d_openUpvalues;
+
+  std::vector<Global> d_globals;
+  std::unordered_map<ObjString *, int> d_globalIndices;
+  int d_globalsDefined;
+
+  std::unordered_map<std::string_view, ObjString *> d_strings;
+  ObjString *d_initString;
+
+  Obj *d_objects;
+  std::vector<Obj *> d_grayStack;
+  size_t d_bytesAllocated;
+  size_t d_nextGC;
+  int d_numCollections;
+};
+
+} // namespace vm
+} // namespace treewalk
+} // namespace plox
+
+#endif
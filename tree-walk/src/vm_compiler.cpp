@@ -0,0 +1,670 @@
+#include <vm_compiler.h>
+
+#include <charconv>
+#include <limits>
+
+namespace plox {
+namespace treewalk {
+namespace vm {
+
+ObjFunction *compile(const std::vector<stmt::Stmt> &stmts, VM &vm) {
+  CompilerVisitor c{vm};
+  return c.compileScript(stmts);
+}
+
+using namespace ast;
+using namespace stmt;
+
+namespace {
+constexpr int k_maxLocals = std::numeric_limits<uint8_t>::max() + 1;
+constexpr int k_maxArgs = std::numeric_limits<uint8_t>::max();
+constexpr int k_maxShort = std::numeric_limits<uint16_t>::max();
+
+double getNum(const Literal &ltrl) {
+  double val;
+  auto start = ltrl.value.data();
+  auto end = ltrl.value.data() + ltrl.value.size();
+  auto [parseEnd, ec] = std::from_chars(start, end, val);
+  if (ec == std::errc::result_out_of_range) {
+    throw InterpretException("Number too large: " + std::string(ltrl.value));
+  }
+  if (parseEnd != end) {
+    throw InterpretException("Unable to read number: " +
+                             std::string(ltrl.value));
+  }
+  return val;
+}
+} // namespace
+
+CompilerVisitor::CompilerVisitor(VM &vm)
+    : d_vm(vm), d_fn(nullptr), d_cls(nullptr) {}
+
+ObjFunction *
+CompilerVisitor::compileScript(const std::vector<stmt::Stmt> &stmts) {
+  FunctionState script{nullptr, d_vm.allocate<ObjFunction>(),
+                       FunctionType::SCRIPT};
+  // Slot 0 holds the script closure while it runs
+  script.locals.push_back({"", 0, false});
+  d_fn = &script;
+
+  for (auto &s : stmts) {
+    std::visit(*this, s);
+  }
+  emit(OpCode::NIL);
+  emit(OpCode::RETURN);
+
+  d_fn = nullptr;
+  return script.function;
+}
+
+void CompilerVisitor::operator()(const Block &blk) {
+  beginScope();
+  for (auto &s : blk.stmts) {
+    std::visit(*this, *s);
+  }
+  endScope();
+}
+
+void CompilerVisitor::operator()(const Class &cls) {
+  // Look up the super class before the class is defined so a class can't
+  // inherit from itself
+  if (cls.super) {
+    namedVariable(*cls.super, false);
+    emit(OpCode::POP);
+  }
+
+  emit(OpCode::CLASS);
+  emitShort(identifierConstant(cls.name));
+  defineVariable(&cls, cls.name);
+
+  ClassState clsState{d_cls, false};
+  d_cls = &clsState;
+
+  // Keep the super class in a local so methods can capture it as 'super'
+  if (cls.super) {
+    beginScope();
+    namedVariable(*cls.super, false);
+    addLocal("super");
+    namedVariable(cls.name, false);
+    emit(OpCode::INHERIT);
+    clsState.hasSuperclass = true;
+  }
+
+  namedVariable(cls.name, false);
+  for (auto &m : cls.methods) {
+    auto &method = std::get<Fun>(*m);
+    function(method, method.name == "init" ? FunctionType::INITIALISER
+                                           : FunctionType::METHOD);
+    emit(OpCode::METHOD);
+    emitShort(identifierConstant(method.name));
+  }
+  emit(OpCode::POP);
+
+  if (clsState.hasSuperclass) {
+    endScope();
+  }
+  d_cls = clsState.enclosing;
+}
+
+void CompilerVisitor::operator()(const Expression &expr) {
+  std::visit(*this, *expr.expr);
+  emit(OpCode::POP);
+}
+
+void CompilerVisitor::operator()(const For &forStmt) {
+  // The initialiser is declared in the current scope, like the tree walker
+  if (forStmt.initialiser) {
+    std::visit(*this, *forStmt.initialiser);
+  }
+  hoistDeclarations(*forStmt.body);
+
+  int loopStart = chunk().code.size();
+  int exitJump = -1;
+  if (forStmt.condition) {
+    std::visit(*this, *forStmt.condition);
+    exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+    emit(OpCode::POP);
+  }
+
+  std::visit(*this, *forStmt.body);
+  if (forStmt.incrementer) {
+    std::visit(*this, *forStmt.incrementer);
+    emit(OpCode::POP);
+  }
+  emitLoop(loopStart);
+
+  if (exitJump != -1) {
+    patchJump(exitJump);
+    emit(OpCode::POP);
+  }
+}
+
+void CompilerVisitor::operator()(const Fun &funStmt) {
+  auto hoisted = d_hoisted.find(&funStmt);
+  if (hoisted != d_hoisted.end()) {
+    d_fn->locals[hoisted->second].name = funStmt.name;
+    function(funStmt, FunctionType::FUNCTION);
+    emit(OpCode::SET_LOCAL);
+    emitByte(hoisted->second);
+    emit(OpCode::POP);
+  } else if (d_fn->scopeDepth > 0) {
+    // Add the local first so the function can refer to itself
+    addLocal(funStmt.name);
+    function(funStmt, FunctionType::FUNCTION);
+  } else {
+    // Define the global before creating the closure so the function can
+    // call itself
+    uint16_t global = d_vm.globalIndex(d_vm.intern(funStmt.name));
+    emit(OpCode::NIL);
+    emit(OpCode::DEFINE_GLOBAL);
+    emitShort(global);
+    function(funStmt, FunctionType::FUNCTION);
+    emit(OpCode::SET_GLOBAL);
+    emitShort(global);
+    emit(OpCode::POP);
+  }
+}
+
+void CompilerVisitor::operator()(const If &ifStmt) {
+  hoistDeclarations(*ifStmt.ifBranch);
+  if (ifStmt.elseBranch) {
+    hoistDeclarations(*ifStmt.elseBranch);
+  }
+
+  std::visit(*this, *ifStmt.condition);
+  int thenJump = emitJump(OpCode::JUMP_IF_FALSE);
+  emit(OpCode::POP);
+  std::visit(*this, *ifStmt.ifBranch);
+
+  int elseJump = emitJump(OpCode::JUMP);
+  patchJump(thenJump);
+  emit(OpCode::POP);
+  if (ifStmt.elseBranch) {
+    std::visit(*this, *ifStmt.elseBranch);
+  }
+  patchJump(elseJump);
+}
+
+void CompilerVisitor::operator()(const Print &print) {
+  std::visit(*this, *print.expr);
+  emit(OpCode::PRINT);
+}
+
+void CompilerVisitor::operator()(const Return &ret) {
+  if (d_fn->type == FunctionType::INITIALISER) {
+    // The VM checks nothing but nil was returned, then returns 'this'
+    if (ret.expr) {
+      std::visit(*this, *ret.expr);
+    } else {
+      emit(OpCode::NIL);
+    }
+    emit(OpCode::RETURN_INIT);
+    return;
+  }
+
+  // A return in the top level script stops the script
+  if (ret.expr) {
+    std::visit(*this, *ret.expr);
+  } else {
+    emit(OpCode::NIL);
+  }
+  emit(OpCode::RETURN);
+}
+
+void CompilerVisitor::operator()(const VarDecl &varDecl) {
+  if (varDecl.expr) {
+    std::visit(*this, *varDecl.expr);
+  } else {
+    emit(OpCode::NIL);
+  }
+  defineVariable(&varDecl, varDecl.name);
+}
+
+void CompilerVisitor::operator()(const While &whileStmt) {
+  hoistDeclarations(*whileStmt.body);
+
+  int loopStart = chunk().code.size();
+  std::visit(*this, *whileStmt.condition);
+  int exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+  emit(OpCode::POP);
+  std::visit(*this, *whileStmt.body);
+  emitLoop(loopStart);
+
+  patchJump(exitJump);
+  emit(OpCode::POP);
+}
+
+void CompilerVisitor::operator()(const Assign &assign) {
+  std::visit(*this, *assign.value);
+  namedVariable(assign.name, true);
+}
+
+void CompilerVisitor::operator()(const Binary &bnry) {
+  std::visit(*this, *bnry.left);
+  std::visit(*this, *bnry.right);
+
+  switch (bnry.op.type) {
+  case TokenType::PLUS:
+    return emit(OpCode::ADD);
+  case TokenType::MINUS:
+    return emit(OpCode::SUBTRACT);
+  case TokenType::STAR:
+    return emit(OpCode::MULTIPLY);
+  case TokenType::SLASH:
+    return emit(OpCode::DIVIDE);
+  case TokenType::EQUAL_EQUAL:
+    return emit(OpCode::EQUAL);
+  case TokenType::BANG_EQUAL:
+    return emit(OpCode::NOT_EQUAL);
+  case TokenType::GREATER:
+    return emit(OpCode::GREATER);
+  case TokenType::GREATER_EQUAL:
+    return emit(OpCode::GREATER_EQUAL);
+  case TokenType::LESS:
+    return emit(OpCode::LESS);
+  case TokenType::LESS_EQUAL:
+    return emit(OpCode::LESS_EQUAL);
+  default:
+    throw InterpretException("Unable to compile binary op: " +
+                             tokenutils::tokenTypeToStr(bnry.op.type));
+  }
+}
+
+void CompilerVisitor::operator()(const Call &call) {
+  if (call.args.size() > k_maxArgs) {
+    throw InterpretException("Too many args in function call");
+  }
+
+  // Method calls skip creating a bound method
+  const Get *get = std::get_if<Get>(call.callee.get());
+  if (get && isSuper(*get->object)) {
+    lexicalVariable("this", false);
+    for (auto &arg : call.args) {
+      std::visit(*this, *arg);
+    }
+    lexicalVariable("super", false);
+    emit(OpCode::SUPER_INVOKE);
+    emitShort(identifierConstant(get->property));
+    emitByte(call.args.size());
+    return;
+  }
+  if (get) {
+    std::visit(*this, *get->object);
+    for (auto &arg : call.args) {
+      std::visit(*this, *arg);
+    }
+    emit(OpCode::INVOKE);
+    emitShort(identifierConstant(get->property));
+    emitByte(call.args.size());
+    return;
+  }
+
+  std::visit(*this, *call.callee);
+  for (auto &arg : call.args) {
+    std::visit(*this, *arg);
+  }
+  emit(OpCode::CALL);
+  emitByte(call.args.size());
+}
+
+void CompilerVisitor::operator()(const Get &get) {
+  if (isSuper(*get.object)) {
+    lexicalVariable("this", false);
+    lexicalVariable("super", false);
+    emit(OpCode::GET_SUPER);
+  } else {
+    std::visit(*this, *get.object);
+    emit(OpCode::GET_PROPERTY);
+  }
+  emitShort(identifierConstant(get.property));
+}
+
+void CompilerVisitor::operator()(const Grouping &grp) {
+  std::visit(*this, *grp.expr);
+}
+
+void CompilerVisitor::operator()(const Literal &ltrl) {
+  switch (ltrl.type) {
+  case TokenType::STRING:
+    emit(OpCode::CONSTANT);
+    return emitShort(makeConstant(Value::obj(d_vm.intern(ltrl.value))));
+  case TokenType::NUMBER: {
+    double num = ltrl.constant ? ltrl.constant->get<double>() : getNum(ltrl);
+    emit(OpCode::CONSTANT);
+    return emitShort(makeConstant(Value::number(num)));
+  }
+  case TokenType::TRUE:
+    return emit(OpCode::TRUE);
+  case TokenType::FALSE:
+    return emit(OpCode::FALSE);
+  case TokenType::NUL:
+    return emit(OpCode::NIL);
+  default:
+    throw InterpretException("Unable to compile type: " +
+                             tokenutils::tokenTypeToStr(ltrl.type));
+  }
+}
+
+void CompilerVisitor::operator()(const Set &set) {
+  std::visit(*this, *set.object);
+  std::visit(*this, *set.value);
+  emit(OpCode::SET_PROPERTY);
+  emitShort(identifierConstant(set.property));
+}
+
+void CompilerVisitor::operator()(const Unary &unry) {
+  std::visit(*this, *unry.right);
+  switch (unry.op.type) {
+  case TokenType::MINUS:
+    return emit(OpCode::NEGATE);
+  case TokenType::BANG:
+    return emit(OpCode::NOT);
+  default:
+    throw InterpretException("Unable to compile unary op: " +
+                             tokenutils::tokenTypeToStr(unry.op.type));
+  }
+}
+
+void CompilerVisitor::operator()(const Variable &var) {
+  namedVariable(var.name, false);
+}
+
+Chunk &CompilerVisitor::chunk() { return d_fn->function->chunk; }
+
+void CompilerVisitor::emit(OpCode op) {
+  chunk().code.push_back(static_cast<uint8_t>(op));
+  // Every loop leaves the stack as it found it, so counting each instruction
+  // that pushes once bounds how far the stack can grow
+  switch (op) {
+  case OpCode::CONSTANT:
+  case OpCode::NIL:
+  case OpCode::TRUE:
+  case OpCode::FALSE:
+  case OpCode::GET_LOCAL:
+  case OpCode::GET_UPVALUE:
+  case OpCode::GET_GLOBAL:
+  case OpCode::CLOSURE:
+  case OpCode::CLASS:
+    d_fn->function->maxStack++;
+    break;
+  default:
+    break;
+  }
+}
+
+void CompilerVisitor::emitByte(uint8_t byte) { chunk().code.push_back(byte); }
+
+void CompilerVisitor::emitShort(uint16_t val) {
+  emitByte(val >> 8);
+  emitByte(val & 0xff);
+}
+
+int CompilerVisitor::emitJump(OpCode op) {
+  emit(op);
+  emitShort(0xffff);
+  return chunk().code.size() - 2;
+}
+
+void CompilerVisitor::patchJump(int operand) {
+  // Jump from the end of the operand to the current instruction
+  int jump = chunk().code.size() - operand - 2;
+  if (jump > k_maxShort) {
+    throw InterpretException("Too much code to jump over");
+  }
+  chunk().code[operand] = (jump >> 8) & 0xff;
+  chunk().code[operand + 1] = jump & 0xff;
+}
+
+void CompilerVisitor::emitLoop(int loopStart) {
+  emit(OpCode::LOOP);
+  int offset = chunk().code.size() - loopStart + 2;
+  if (offset > k_maxShort) {
+    throw InterpretException("Loop body too large");
+  }
+  emitShort(offset);
+}
+
+uint16_t CompilerVisitor::makeConstant(Value v) {
+  auto &constants = chunk().constants;
+  if (constants.size() > k_maxShort) {
+    throw InterpretException("Too many constants in one function");
+  }
+  constants.push_back(v);
+  return constants.size() - 1;
+}
+
+uint16_t CompilerVisitor::identifierConstant(std::string_view name) {
+  // Names are used over and over, so only store each once per function
+  ObjString *str = d_vm.intern(name);
+  auto it = d_fn->stringConstants.find(str);
+  if (it != d_fn->stringConstants.end()) {
+    return it->second;
+  }
+  uint16_t idx = makeConstant(Value::obj(str));
+  d_fn->stringConstants[str] = idx;
+  return idx;
+}
+
+void CompilerVisitor::beginScope() { d_fn->scopeDepth++; }
+
+void CompilerVisitor::endScope() {
+  d_fn->scopeDepth--;
+  auto &locals = d_fn->locals;
+  while (!locals.empty() && locals.back().depth > d_fn->scopeDepth) {
+    emit(locals.back().isCaptured ? OpCode::CLOSE_UPVALUE : OpCode::POP);
+    locals.pop_back();
+  }
+}
+
+int CompilerVisitor::addLocal(std::string_view name) {
+  auto &locals = d_fn->locals;
+  if (locals.size() == k_maxLocals) {
+    throw InterpretException("Too many local variables in function");
+  }
+  // Lox allows shadowing variables in higher scopes, but not within a scope
+  for (auto it = locals.rbegin(); it != locals.rend(); it++) {
+    if (it->depth < d_fn->scopeDepth) {
+      break;
+    }
+    if (!name.empty() && it->name == name) {
+      throw InterpretException("Cannot redefine variable: " +
+                               std::string(name));
+    }
+  }
+  locals.push_back({name, d_fn->scopeDepth, false});
+  return locals.size() - 1;
+}
+
+void CompilerVisitor::hoistDeclarations(const Stmt &stmt) {
+  // Branches of if/while/for statements can declare variables in the
+  // enclosing scope without a block. Locals must have a fixed stack slot, so
+  // reserve the slot before the branch and fill it in if the branch runs.
+  if (d_fn->scopeDepth == 0) {
+    return;
+  }
+
+  auto reserve = [&](const void *decl) {
+    emit(OpCode::NIL);
+    d_hoisted[decl] = addLocal("");
+  };
+  if (auto *varDecl = std::get_if<VarDecl>(&stmt)) {
+    reserve(varDecl);
+  } else if (auto *fun = std::get_if<Fun>(&stmt)) {
+    reserve(fun);
+  } else if (auto *cls = std::get_if<Class>(&stmt)) {
+    reserve(cls);
+  } else if (auto *ifStmt = std::get_if<If>(&stmt)) {
+    hoistDeclarations(*ifStmt->ifBranch);
+    if (ifStmt->elseBranch) {
+      hoistDeclarations(*ifStmt->elseBranch);
+    }
+  } else if (auto *whileStmt = std::get_if<While>(&stmt)) {
+    hoistDeclarations(*whileStmt->body);
+  } else if (auto *forStmt = std::get_if<For>(&stmt)) {
+    if (forStmt->initialiser) {
+      hoistDeclarations(*forStmt->initialiser);
+    }
+    hoistDeclarations(*forStmt->body);
+  }
+}
+
+void CompilerVisitor::defineVariable(const void *decl, std::string_view name) {
+  // The value of the variable is on top of the stack
+  auto hoisted = d_hoisted.find(decl);
+  if (hoisted != d_hoisted.end()) {
+    d_fn->locals[hoisted->second].name = name;
+    emit(OpCode::SET_LOCAL);
+    emitByte(hoisted->second);
+    emit(OpCode::POP);
+  } else if (d_fn->scopeDepth > 0) {
+    addLocal(name);
+  } else {
+    emit(OpCode::DEFINE_GLOBAL);
+    emitShort(d_vm.globalIndex(d_vm.intern(name)));
+  }
+}
+
+int CompilerVisitor::resolveLocal(const FunctionState &fs,
+                                  std::string_view name) const {
+  for (int i = fs.locals.size() - 1; i >= 0; i--) {
+    if (fs.locals[i].name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int CompilerVisitor::resolveUpvalue(FunctionState &fs, std::string_view name) {
+  if (!fs.enclosing) {
+    return -1;
+  }
+
+  int local = resolveLocal(*fs.enclosing, name);
+  if (local != -1) {
+    fs.enclosing->locals[local].isCaptured = true;
+    return addUpvalue(fs, local, true);
+  }
+
+  int upvalue = resolveUpvalue(*fs.enclosing, name);
+  if (upvalue != -1) {
+    return addUpvalue(fs, upvalue, false);
+  }
+  return -1;
+}
+
+int CompilerVisitor::addUpvalue(FunctionState &fs, uint8_t index,
+                                bool isLocal) {
+  for (int i = 0; i < fs.upvalues.size(); i++) {
+    if (fs.upvalues[i].index == index && fs.upvalues[i].isLocal == isLocal) {
+      return i;
+    }
+  }
+  if (fs.upvalues.size() == k_maxLocals) {
+    throw InterpretException("Too many closure variables in function");
+  }
+  fs.upvalues.push_back({index, isLocal});
+  fs.function->upvalueCount = fs.upvalues.size();
+  return fs.upvalues.size() - 1;
+}
+
+bool CompilerVisitor::isMethodMember(std::string_view name) const {
+  // Locals of the method, or of functions within it, shadow the instance.
+  // Anything else may be a field or method.
+  for (const FunctionState *fs = d_fn; fs; fs = fs->enclosing) {
+    if (resolveLocal(*fs, name) != -1) {
+      return false;
+    }
+    if (fs->type == FunctionType::METHOD ||
+        fs->type == FunctionType::INITIALISER) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void CompilerVisitor::namedVariable(std::string_view name, bool isAssign) {
+  if (!isMethodMember(name)) {
+    return lexicalVariable(name, isAssign);
+  }
+
+  // Check the instance first, jumping over the lexical lookup if the name is
+  // found
+  lexicalVariable("this", false);
+  emit(isAssign ? OpCode::SET_IMPLICIT : OpCode::GET_IMPLICIT);
+  emitShort(identifierConstant(name));
+  int foundJump = chunk().code.size();
+  emitShort(0xffff);
+  lexicalVariable(name, isAssign);
+  patchJump(foundJump);
+}
+
+void CompilerVisitor::lexicalVariable(std::string_view name, bool isAssign) {
+  int arg = resolveLocal(*d_fn, name);
+  if (arg != -1) {
+    emit(isAssign ? OpCode::SET_LOCAL : OpCode::GET_LOCAL);
+    return emitByte(arg);
+  }
+
+  arg = resolveUpvalue(*d_fn, name);
+  if (arg != -1) {
+    emit(isAssign ? OpCode::SET_UPVALUE : OpCode::GET_UPVALUE);
+    return emitByte(arg);
+  }
+
+  emit(isAssign ? OpCode::SET_GLOBAL : OpCode::GET_GLOBAL);
+  emitShort(d_vm.globalIndex(d_vm.intern(name)));
+}
+
+bool CompilerVisitor::isSuper(const Expr &expr) const {
+  auto *var = std::get_if<Variable>(&expr);
+  return var && var->name == "super" && d_cls && d_cls->hasSuperclass;
+}
+
+void CompilerVisitor::function(const Fun &funStmt, FunctionType type) {
+  FunctionState fs{d_fn, d_vm.allocate<ObjFunction>(), type};
+  fs.function->name = d_vm.intern(funStmt.name);
+  fs.function->arity = funStmt.params.size();
+  fs.function->maxStack = fs.function->arity + 1;
+  fs.function->isInitialiser = type == FunctionType::INITIALISER;
+  for (auto p : funStmt.params) {
+    fs.function->params.emplace_back(p);
+  }
+  if (funStmt.params.size() > k_maxArgs) {
+    throw InterpretException("Too many params for function " +
+                             std::string(funStmt.name));
+  }
+
+  // Slot 0 holds the receiver for methods, or the function itself otherwise
+  bool isMethod =
+      type == FunctionType::METHOD || type == FunctionType::INITIALISER;
+  fs.locals.push_back({isMethod ? "this" : "", 0, false});
+  fs.scopeDepth = 1;
+  d_fn = &fs;
+
+  for (auto p : funStmt.params) {
+    addLocal(p);
+  }
+  for (auto &s : funStmt.stmts) {
+    std::visit(*this, *s);
+  }
+  if (type == FunctionType::INITIALISER) {
+    emit(OpCode::NIL);
+    emit(OpCode::RETURN_INIT);
+  } else {
+    emit(OpCode::NIL);
+    emit(OpCode::RETURN);
+  }
+  d_fn = fs.enclosing;
+
+  // The upvalues are captured when the closure is created
+  emit(OpCode::CLOSURE);
+  emitShort(makeConstant(Value::obj(fs.function)));
+  for (auto &upvalue : fs.upvalues) {
+    emitByte(upvalue.isLocal);
+    emitByte(upvalue.index);
+  }
+}
+
+} // namespace vm
+} // namespace treewalk
+} // namespace plox
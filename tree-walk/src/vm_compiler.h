@@ -0,0 +1,129 @@
+#ifndef TREEWALK_VM_COMPILER_H
+#define TREEWALK_VM_COMPILER_H
+
+#include <stmt.h>
+#include <vm.h>
+#include <vm_object.h>
+#include <vm_opcode.h>
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace vm {
+
+// Compiles the statements to bytecode, returning the function for the top
+// level script. Throws an InterpretException if the code cannot be compiled.
+ObjFunction *compile(const std::vector<stmt::Stmt> &stmts, VM &vm);
+
+/*
+ Walks the AST once, emitting bytecode for each node.
+
+ Locals live on the VM stack and are resolved here to stack slots, with
+ variables from enclosing functions captured as upvalues. The compiler does
+ not use the slots from the resolver pass as the VM lays out its stack
+ differently to the tree walk Environments.
+
+ Bare names used inside methods may refer to fields or methods of the
+ instance. Unless the name is a local of the method these are compiled to
+ check the instance first and fall back to the normal variable lookup.
+*/
+class CompilerVisitor {
+public:
+  explicit CompilerVisitor(VM &vm);
+
+  ObjFunction *compileScript(const std::vector<stmt::Stmt> &stmts);
+
+  // Statements
+  void operator()(const stmt::Block &blk);
+  void operator()(const stmt::Class &cls);
+  void operator()(const stmt::Expression &expr);
+  void operator()(const stmt::For &forStmt);
+  void operator()(const stmt::Fun &funStmt);
+  void operator()(const stmt::If &ifStmt);
+  void operator()(const stmt::Print &print);
+  void operator()(const stmt::Return &ret);
+  void operator()(const stmt::VarDecl &varDecl);
+  void operator()(const stmt::While &whileStmt);
+
+  // Expressions
+  void operator()(const ast::Assign &assign);
+  void operator()(const ast::Binary &bnry);
+  void operator()(const ast::Call &call);
+  void operator()(const ast::Get &get);
+  void operator()(const ast::Grouping &grp);
+  void operator()(const ast::Literal &ltrl);
+  void operator()(const ast::Set &set);
+  void operator()(const ast::Unary &unry);
+  void operator()(const ast::Variable &var);
+
+private:
+  enum class FunctionType { SCRIPT, FUNCTION, METHOD, INITIALISER };
+
+  struct Local {
+    std::string_view name;
+    int depth;
+    bool isCaptured;
+  };
+
+  struct Upvalue {
+    uint8_t index;
+    bool isLocal;
+  };
+
+  struct FunctionState {
+    FunctionState *enclosing;
+    ObjFunction *function;
+    FunctionType type;
+    std::vector<Local> locals;
+    std::vector<Upvalue> upvalues;
+    std::unordered_map<ObjString *, uint16_t> stringConstants;
+    int scopeDepth;
+  };
+
+  struct ClassState {
+    ClassState *enclosing;
+    bool hasSuperclass;
+  };
+
+  // Emitting bytecode
+  Chunk &chunk();
+  void emit(OpCode op);
+  void emitByte(uint8_t byte);
+  void emitShort(uint16_t val);
+  int emitJump(OpCode op);
+  void patchJump(int operand);
+  void emitLoop(int loopStart);
+  uint16_t makeConstant(Value v);
+  uint16_t identifierConstant(std::string_view name);
+
+  // Scopes and variables
+  void beginScope();
+  void endScope();
+  int addLocal(std::string_view name);
+  void hoistDeclarations(const stmt::Stmt &stmt);
+  void defineVariable(const void *decl, std::string_view name);
+  int resolveLocal(const FunctionState &fs, std::string_view name) const;
+  int resolveUpvalue(FunctionState &fs, std::string_view name);
+  int addUpvalue(FunctionState &fs, uint8_t index, bool isLocal);
+  bool isMethodMember(std::string_view name) const;
+  void namedVariable(std::string_view name, bool isAssign);
+  void lexicalVariable(std::string_view name, bool isAssign);
+  bool isSuper(const ast::Expr &expr) const;
+
+  void function(const stmt::Fun &funStmt, FunctionType type);
+
+  VM &d_vm;
+  FunctionState *d_fn;
+  ClassState *d_cls;
+  // Stack slots reserved for declarations within if/while/for branches
+  std::unordered_map<const void *, int> d_hoisted;
+};
+
+} // namespace vm
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -0,0 +1,117 @@
+#include <vm_object.h>
+
+#include <sstream>
+
+namespace plox {
+namespace treewalk {
+namespace vm {
+
+namespace {
+std::string functionToString(ObjString *name, const ObjFunction *fn) {
+  std::ostringstream ss;
+  ss << "fun " << (name ? name->chars : fn->name->chars) << "(";
+  for (int i = 0; i < fn->params.size(); i++) {
+    ss << (i ? ", " : "") << fn->params[i];
+  }
+  ss << ")";
+  return ss.str();
+}
+} // namespace
+
+bool isTruthy(Value v) {
+  switch (v.type()) {
+  case Value::Type::NIL:
+    return false;
+  case Value::Type::BOOL:
+    return v.asBool();
+  case Value::Type::NUMBER:
+    return static_cast<bool>(v.asNumber());
+  default:
+    return true;
+  }
+}
+
+bool valuesEqual(Value a, Value b) {
+  if (a.type() != b.type()) {
+    return false;
+  }
+  switch (a.type()) {
+  case Value::Type::NIL:
+    return true;
+  case Value::Type::BOOL:
+    return a.asBool() == b.asBool();
+  case Value::Type::NUMBER:
+    return a.asNumber() == b.asNumber();
+  default:
+    // Strings are interned so comparing pointers is enough
+    return a.asObj() == b.asObj();
+  }
+}
+
+std::string typeName(Value v) {
+  switch (v.type()) {
+  case Value::Type::NIL:
+    return "nil";
+  case Value::Type::BOOL:
+    return "bool";
+  case Value::Type::NUMBER:
+    return "number";
+  default:
+    break;
+  }
+
+  switch (v.asObj()->type) {
+  case ObjType::STRING:
+    return "string";
+  case ObjType::CLASS:
+    return "class";
+  case ObjType::INSTANCE:
+    return "class instance";
+  default:
+    return "function";
+  }
+}
+
+std::string toString(Value v) {
+  std::ostringstream ss;
+  switch (v.type()) {
+  case Value::Type::NIL:
+    return "NULL";
+  case Value::Type::BOOL:
+    ss << v.asBool();
+    return ss.str();
+  case Value::Type::NUMBER:
+    ss << v.asNumber();
+    return ss.str();
+  case Value::Type::OBJ:
+    break;
+  }
+
+  switch (v.asObj()->type) {
+  case ObjType::BOUND_METHOD: {
+    ObjClosure *method = v.as<ObjBoundMethod>()->method;
+    return functionToString(method->name, method->function);
+  }
+  case ObjType::CLASS:
+    return "class " + v.as<ObjClass>()->name->chars;
+  case ObjType::CLOSURE: {
+    ObjClosure *closure = v.as<ObjClosure>();
+    return functionToString(closure->name, closure->function);
+  }
+  case ObjType::FUNCTION:
+    return functionToString(nullptr, v.as<ObjFunction>());
+  case ObjType::INSTANCE:
+    return "class instance " + v.as<ObjInstance>()->klass->name->chars;
+  case ObjType::NATIVE:
+    return "fun " + v.as<ObjNative>()->name->chars + "()";
+  case ObjType::STRING:
+    return v.as<ObjString>()->chars;
+  case ObjType::UPVALUE:
+    return "upvalue";
+  }
+  return "__unknown__";
+}
+
+} // namespace vm
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,204 @@
+#ifndef TREEWALK_VM_OBJECT_H
+#define TREEWALK_VM_OBJECT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace vm {
+
+/*
+ Values and heap objects used by the bytecode VM.
+
+ Unlike the tree walk interpreter, the VM does not use std::variant or
+ std::shared_ptr for its values. A Value is a small tagged union so it can be
+ copied around the value stack cheaply, and heap objects are owned by the VM
+ which frees them with a mark and sweep garbage collector.
+*/
+
+struct Obj;
+struct ObjBoundMethod;
+struct ObjClass;
+struct ObjClosure;
+struct ObjFunction;
+struct ObjInstance;
+struct ObjNative;
+struct ObjString;
+struct ObjUpvalue;
+
+enum class ObjType : uint8_t {
+  BOUND_METHOD,
+  CLASS,
+  CLOSURE,
+  FUNCTION,
+  INSTANCE,
+  NATIVE,
+  STRING,
+  UPVALUE
+};
+
+// Values are left uninitialised by default so the value stack can be
+// allocated without touching every slot. Use the factories to create them.
+class Value {
+public:
+  enum class Type : uint8_t { NIL, BOOL, NUMBER, OBJ };
+
+  Value() = default;
+
+  static Value nil() { return Value(Type::NIL); }
+  static Value boolean(bool b) {
+    Value v(Type::BOOL);
+    v.d_as.boolean = b;
+    return v;
+  }
+  static Value number(double d) {
+    Value v(Type::NUMBER);
+    v.d_as.number = d;
+    return v;
+  }
+  static Value obj(Obj *o) {
+    Value v(Type::OBJ);
+    v.d_as.obj = o;
+    return v;
+  }
+
+  Type type() const { return d_type; }
+  bool isNil() const { return d_type == Type::NIL; }
+  bool isBool() const { return d_type == Type::BOOL; }
+  bool isNumber() const { return d_type == Type::NUMBER; }
+  bool isObj() const { return d_type == Type::OBJ; }
+  bool isObjType(ObjType t) const;
+
+  bool asBool() const { return d_as.boolean; }
+  double asNumber() const { return d_as.number; }
+  Obj *asObj() const { return d_as.obj; }
+  template <typename T> T *as() const { return static_cast<T *>(d_as.obj); }
+
+private:
+  explicit Value(Type t) : d_type(t) {}
+
+  Type d_type;
+  union {
+    bool boolean;
+    double number;
+    Obj *obj;
+  } d_as;
+};
+
+struct Obj {
+  explicit Obj(ObjType t) : type(t) {}
+  virtual ~Obj() = default;
+
+  ObjType type;
+  bool isMarked = false;
+  Obj *next = nullptr; // All objects are chained so the GC can sweep them
+  // The bytes counted for the object when it was allocated, which are taken
+  // off the VM's total when it's freed
+  size_t size = 0;
+};
+
+inline bool Value::isObjType(ObjType t) const {
+  return isObj() && d_as.obj->type == t;
+}
+
+// Strings are interned by the VM, so two strings are equal only if they are
+// the same object.
+struct ObjString : Obj {
+  explicit ObjString(std::string s)
+      : Obj(ObjType::STRING), chars(std::move(s)) {}
+
+  std::string chars;
+};
+
+// Bytecode for a function, along with the constants it refers to
+struct Chunk {
+  std::vector<uint8_t> code;
+  std::vector<Value> constants;
+};
+
+struct ObjFunction : Obj {
+  ObjFunction() : Obj(ObjType::FUNCTION) {}
+
+  int arity = 0;
+  int upvalueCount = 0;
+  // At least the most values a call to the function can have on the stack at
+  // once, counting the callee and args
+  int maxStack = 1;
+  bool isInitialiser = false;
+  Chunk chunk;
+  ObjString *name = nullptr; // Null for the top level script
+  std::vector<std::string> params; // Kept for printing the function
+};
+
+class VM;
+using NativeFn = Value (*)(VM &vm);
+
+struct ObjNative : Obj {
+  ObjNative(ObjString *n, NativeFn f) : Obj(ObjType::NATIVE), name(n), fn(f) {}
+
+  ObjString *name;
+  NativeFn fn;
+};
+
+// A variable captured by a closure. While the variable is still on the stack
+// the upvalue is 'open' and points at the stack slot. Once the variable goes
+// out of scope it is 'closed' and the value is moved into the upvalue.
+struct ObjUpvalue : Obj {
+  explicit ObjUpvalue(Value *slot) : Obj(ObjType::UPVALUE), location(slot) {}
+
+  Value *location;
+  Value closed = Value::nil();
+  ObjUpvalue *nextOpen = nullptr;
+};
+
+struct ObjClosure : Obj {
+  ObjClosure(ObjFunction *fn, int globalsVisible)
+      : Obj(ObjType::CLOSURE), function(fn),
+        upvalues(fn->upvalueCount, nullptr), globalsVisible(globalsVisible) {}
+
+  ObjFunction *function;
+  std::vector<ObjUpvalue *> upvalues;
+  // Closures only see globals defined before them. This is the number of
+  // globals that had been defined when the closure was created.
+  int globalsVisible;
+  // Functions stored as a property take the name of the property
+  ObjString *name = nullptr;
+};
+
+struct ObjClass : Obj {
+  explicit ObjClass(ObjString *n) : Obj(ObjType::CLASS), name(n) {}
+
+  ObjString *name;
+  std::unordered_map<ObjString *, Value> methods;
+};
+
+struct ObjInstance : Obj {
+  explicit ObjInstance(ObjClass *k) : Obj(ObjType::INSTANCE), klass(k) {}
+
+  ObjClass *klass;
+  std::unordered_map<ObjString *, Value> fields;
+};
+
+struct ObjBoundMethod : Obj {
+  ObjBoundMethod(Value r, ObjClosure *m)
+      : Obj(ObjType::BOUND_METHOD), receiver(r), method(m) {}
+
+  Value receiver;
+  ObjClosure *method;
+};
+
+// Helpers matching the semantics of the tree walk interpreter
+bool isTruthy(Value v);
+bool valuesEqual(Value a, Value b);
+std::string typeName(Value v);
+std::string toString(Value v);
+
+} // namespace vm
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef TREEWALK_VM_OPCODE_H
+#define TREEWALK_VM_OPCODE_H
+
+#include <cstdint>
+
+namespace plox {
+namespace treewalk {
+namespace vm {
+
+// Operands follow the opcode in the bytecode. 'u8'/'u16' give their size.
+enum class OpCode : uint8_t {
+  CONSTANT,      // u16 constant index
+  NIL,
+  TRUE,
+  FALSE,
+  POP,
+  GET_LOCAL,     // u8 stack slot
+  SET_LOCAL,     // u8 stack slot
+  GET_UPVALUE,   // u8 upvalue index
+  SET_UPVALUE,   // u8 upvalue index
+  GET_GLOBAL,    // u16 global index
+  DEFINE_GLOBAL, // u16 global index
+  SET_GLOBAL,    // u16 global index
+  GET_PROPERTY,  // u16 name constant
+  SET_PROPERTY,  // u16 name constant
+  GET_SUPER,     // u16 name constant
+  GET_IMPLICIT,  // u16 name constant, u16 jump if found
+  SET_IMPLICIT,  // u16 name constant, u16 jump if found
+  EQUAL,
+  NOT_EQUAL,
+  GREATER,
+  GREATER_EQUAL,
+  LESS,
+  LESS_EQUAL,
+  ADD,
+  SUBTRACT,
+  MULTIPLY,
+  DIVIDE,
+  NOT,
+  NEGATE,
+  PRINT,
+  JUMP,          // u16 forward offset
+  JUMP_IF_FALSE, // u16 forward offset
+  LOOP,          // u16 backward offset
+  CALL,          // u8 arg count
+  INVOKE,        // u16 name constant, u8 arg count
+  SUPER_INVOKE,  // u16 name constant, u8 arg count
+  CLOSURE,       // u16 function constant, then (u8 isLocal, u8 index) pairs
+  CLOSE_UPVALUE,
+  RETURN,
+  RETURN_INIT,
+  CLASS,         // u16 name constant
+  INHERIT,
+  METHOD         // u16 name constant
+};
+
+} // namespace vm
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -4,12 +4,17 @@ from pathlib import Path
 import subprocess
 
 
-@pytest.fixture
-def lox_runner():
+# Every system test runs against each engine
+@pytest.fixture(params=["tree-walk", "closure", "stack", "vm"])
+def lox_runner(request):
     BIN = Path(__file__).resolve().parent / "../../build/tree-walk/src/tree-walk"
 
     def run(code):
-        result = subprocess.run([BIN, "-c", code], capture_output=True, text=True)
+        result = subprocess.run(
+            [BIN, f"--engine={request.param}", "-c", code],
+            capture_output=True,
+            text=True,
+        )
         return (result.stdout, result.stderr)
 
     return run
@@ -375,3 +375,122 @@ def test_super_init_is_not_implicitly_called(lox_runner):
     # THEN
     assert stdout.strip().splitlines() == ["initing Bar!"]
     assert stderr == ""
+
+
+def test_method_uses_block_var(lox_runner):
+    # GIVEN
+    code = """
+    {
+        var greeting = "hello";
+        class Greeter {
+            greet() {
+                print greeting;
+            }
+        }
+        Greeter().greet();
+    }
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["hello"]
+    assert stderr == ""
+
+
+def test_field_shadows_captured_var(lox_runner):
+    # GIVEN
+    code = """
+    {
+        var name = "block";
+        class Named {
+            getName() {
+                return name;
+            }
+        }
+        var n = Named();
+        print n.getName();
+        n.name = "field";
+        print n.getName();
+    }
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["block", "field"]
+    assert stderr == ""
+
+
+def test_same_property_on_different_classes(lox_runner):
+    # GIVEN
+    code = """
+    class A {
+        init() { this.x = "a"; }
+    }
+    class B {
+        init() { this.y = 0; this.x = "b"; }
+    }
+    fun getX(obj) {
+        return obj.x;
+    }
+    var a = A();
+    var b = B();
+    print getX(a);
+    print getX(b);
+    print getX(a);
+    b.x = "b2";
+    a.y = "new";
+    print getX(b);
+    print a.y;
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["a", "b", "a", "b2", "new"]
+    assert stderr == ""
+
+
+def test_method_calls_method_by_name(lox_runner):
+    # GIVEN
+    code = """
+    class Greeter {
+        init(name) { this.name = name; }
+        greeting() { return "hello " + this.name; }
+        greet() { print greeting(); }
+    }
+    Greeter("a").greet();
+    Greeter("b").greet();
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["hello a", "hello b"]
+    assert stderr == ""
+
+
+def test_field_hides_method_on_one_instance(lox_runner):
+    # GIVEN
+    code = """
+    class A {
+        name() { return "method"; }
+    }
+    var a = A();
+    var b = A();
+    a.name = "field";
+    print a.name;
+    print b.name();
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["field", "method"]
+    assert stderr == ""
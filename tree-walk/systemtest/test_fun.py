@@ -161,3 +161,191 @@ def test_fun_closure_resolve(lox_runner):
     # THEN
     assert stdout.strip().splitlines() == ["global"]
     assert stderr == ""
+
+
+def test_fun_closure_resolve_shadowed_later(lox_runner):
+    # GIVEN
+    code = """
+    var a = "global";
+    {
+        fun showA() {
+            print a;
+        }
+
+        showA();
+        var a = "block";
+        showA();
+        print a;
+    }
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["global", "global", "block"]
+    assert stderr == ""
+
+
+def test_fun_closure_shares_block_var(lox_runner):
+    # GIVEN
+    code = """
+    {
+        var count = 0;
+        fun increment() {
+            count = count + 1;
+        }
+        increment();
+        increment();
+        print count;
+    }
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["2"]
+    assert stderr == ""
+
+
+def test_fun_closures_have_own_captures(lox_runner):
+    # GIVEN
+    code = """
+    fun makeCounter() {
+        var count = 0;
+        fun increment() {
+            count = count + 1;
+            return count;
+        }
+        return increment;
+    }
+    var a = makeCounter();
+    var b = makeCounter();
+    a();
+    print a();
+    print b();
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["2", "1"]
+    assert stderr == ""
+
+
+def test_fun_closures_share_capture_after_scope_ends(lox_runner):
+    # GIVEN
+    code = """
+    var get;
+    var set;
+    {
+        var shared = "before";
+        fun getter() { return shared; }
+        fun setter(v) { shared = v; }
+        get = getter;
+        set = setter;
+    }
+    set("after");
+    print get();
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["after"]
+    assert stderr == ""
+
+
+def test_fun_return_from_nested_loops(lox_runner):
+    # GIVEN
+    code = """
+    fun firstOver(limit) {
+        for (var i = 0; i < 10; i = i + 1) {
+            var j = 0;
+            while (j < 10) {
+                if (i * j > limit) {
+                    return i * j;
+                };
+                j = j + 1;
+            };
+        };
+        print "unreachable";
+    }
+    print firstOver(20);
+    print firstOver(20);
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["21", "21"]
+    assert stderr == ""
+
+
+def test_return_stops_script(lox_runner):
+    # GIVEN
+    code = """
+    print "before";
+    return;
+    print "after";
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["before"]
+    assert stderr == ""
+
+
+def test_fun_only_sees_globals_declared_before_it(lox_runner):
+    # GIVEN
+    code = """
+    var before = "before";
+    fun countdown(n) {
+        if (n == 0) return before;;
+        return countdown(n - 1);
+    }
+    fun readAfter() {
+        return after;
+    }
+    var after = "after";
+    print countdown(3);
+    print readAfter();
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["before"]
+    assert "Unknown variable: after" in stderr
+
+
+def test_fun_returns_result_of_tail_call(lox_runner):
+    # GIVEN
+    code = """
+    class Counter {
+        init(n) { this.n = n; }
+        next() { return Counter(this.n + 1); }
+    }
+    fun describe(c) { return "counted"; }
+    fun countTo(c, limit) {
+        if (c.n == limit) return describe(c);;
+        return countTo(c.next(), limit);
+    }
+    fun wrap(c) { return c.next(); }
+    print countTo(Counter(0), 1000);
+    print wrap(Counter(1)).n;
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["counted", "2"]
+    assert stderr == ""
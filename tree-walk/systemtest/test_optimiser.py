@@ -0,0 +1,49 @@
+def test_constant_expressions_are_folded(lox_runner):
+    # GIVEN
+    code = """
+    var ms = 60 * 60 * 1000;
+    print ms;
+    print "prefix" + "suffix";
+    print -(1 + 2) * 3;
+    print !(1 < 2);
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["3.6e+06", "prefixsuffix", "-9", "0"]
+    assert stderr == ""
+
+
+def test_invalid_constant_expression_errors_at_runtime(lox_runner):
+    # GIVEN
+    code = """
+    print "before";
+    print 1 + "a";
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["before"]
+    assert "Unable to add types" in stderr
+
+
+def test_constant_branch_declares_in_enclosing_scope(lox_runner):
+    # GIVEN
+    code = """
+    {
+        if (true) var a = "taken"; else var a = "not taken";;
+        while (false) print "never";;
+        print a;
+    }
+    """
+
+    # WHEN
+    stdout, stderr = lox_runner(code)
+
+    # THEN
+    assert stdout.strip().splitlines() == ["taken"]
+    assert stderr == ""
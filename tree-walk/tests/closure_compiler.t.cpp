@@ -0,0 +1,138 @@
+#include <closure_compiler.h>
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <parse_code.h>
+
+using ::testing::HasSubstr;
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+namespace {
+std::string runCode(const std::string &code, std::shared_ptr<Environment> &env,
+                    std::vector<InterpretException> &errs) {
+  auto stmts = testutil::resolveCode(code);
+  ::testing::internal::CaptureStdout();
+  closure::interpret(stmts, env, errs);
+  return ::testing::internal::GetCapturedStdout();
+}
+} // namespace
+
+TEST(ClosureCompiler, Arithmetic) {
+  // Given
+  std::string code = "var a = (5/1+2)*--8; print a; print -a + 1;";
+  auto env = Environment::create();
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, env, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("56\n-55\n", out);
+}
+
+TEST(ClosureCompiler, ClosuresCaptureVariables) {
+  // Given
+  std::string code = R"(
+    fun makeCounter() {
+      var i = 0;
+      fun count() { i = i + 1; return i; }
+      return count;
+    }
+    var c1 = makeCounter();
+    var c2 = makeCounter();
+    print c1(); print c1(); print c2();
+  )";
+  auto env = Environment::create();
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, env, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("1\n2\n1\n", out);
+}
+
+TEST(ClosureCompiler, ClassesCallThroughSuper) {
+  // Given
+  std::string code = R"(
+    class A {
+      init(n) { this.n = n; }
+      get() { return this.n; }
+    }
+    class B < A {
+      init(n) { super.init(n * 2); }
+      get() { return super.get() + 1; }
+    }
+    print B(3).get();
+  )";
+  auto env = Environment::create();
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, env, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("7\n", out);
+}
+
+TEST(ClosureCompiler, FunctionsOutliveTheirStatements) {
+  // Given
+  auto env = Environment::create();
+  std::vector<InterpretException> errs;
+  {
+    auto stmts = testutil::resolveCode("fun twice(x) { return x + x; }");
+    closure::interpret(stmts, env, errs);
+  }
+
+  // When
+  auto out = runCode("print twice(\"ab\");", env, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("abab\n", out);
+}
+
+TEST(ClosureCompiler, TailCallsDontGrowTheStack) {
+  // Given
+  std::string code = R"(
+    fun count(n, total) {
+      if (n == 0) return total;;
+      return count(n - 1, total + 1);
+    }
+    print count(100000, 0);
+  )";
+  auto env = Environment::create();
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, env, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("100000\n", out);
+}
+
+TEST(ClosureCompiler, ReportsRuntimeErrors) {
+  // Given
+  std::string code = "fun f(a) { return a; } f(1, 2);";
+  auto env = Environment::create();
+  std::vector<InterpretException> errs;
+
+  // When
+  runCode(code, env, errs);
+
+  // Then
+  ASSERT_EQ(1, errs.size());
+  EXPECT_THAT(errs[0].what(), HasSubstr("Tried to call f with 2 args"));
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
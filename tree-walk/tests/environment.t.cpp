@@ -84,7 +84,7 @@ TEST(Environment, AssignUndefinedThrows) {
   EXPECT_THROW(envPtr->assign("x", {}), InterpretException);
 }
 
-TEST(Environment, multipleEnvForScope) {
+TEST(Environment, SnapshotHidesLaterDeclarations) {
   // GIVEN
   auto globalPtr = Environment::create();
   globalPtr->define("x", 12.0);
@@ -92,16 +92,155 @@ TEST(Environment, multipleEnvForScope) {
   auto scopePtr = Environment::create(globalPtr);
   scopePtr->define("y", 50.0);
 
-  auto scopePtr2 = Environment::extend(scopePtr);
-  scopePtr2->define("z", 15.0);
+  // WHEN
+  auto snapshot = Environment::snapshot(scopePtr);
+  scopePtr->define("z", 15.0);
+  auto inner = Environment::create(snapshot);
+
+  // THEN
+  EXPECT_EQ(inner->get("x"), Value{12.0});
+  EXPECT_EQ(inner->get("y"), Value{50.0});
+  EXPECT_THROW(inner->get("z"), InterpretException);
+  EXPECT_THROW(inner->assign("z", 1.0), InterpretException);
+  EXPECT_EQ(scopePtr->get("z"), Value{15.0});
+
+  // Later declarations still can't reuse a name from the scope
+  EXPECT_NO_THROW(scopePtr->define("x", "abc"));
+  EXPECT_THROW(scopePtr->define("y", "abc"), InterpretException);
+}
+
+TEST(Environment, DefineAtAndGetAt) {
+  // GIVEN
+  auto envPtr = Environment::create(nullptr, 2);
+  Value v = 42.0;
+
+  // WHEN
+  envPtr->defineAt(1, v);
+
+  // THEN
+  EXPECT_EQ(envPtr->getAt({0, 1}, "x"), v);
+  EXPECT_EQ(envPtr->getAt({0, 0}, "y"), Value{});
+}
+
+TEST(Environment, SlotsGrowPastInlineStorage) {
+  // GIVEN
+  auto envPtr = Environment::create(nullptr, 2);
+  envPtr->defineAt(0, "first");
+  envPtr->defineAt(1, 1.0);
+
+  // WHEN
+  envPtr->defineAt(Slots::k_numInline + 1, "last");
+  Environment copy(*envPtr);
+
+  // THEN
+  for (const Environment *env : {envPtr.get(), &copy}) {
+    EXPECT_EQ(env->getAt({0, 0}, "x"), Value{"first"});
+    EXPECT_EQ(env->getAt({0, 1}, "x"), Value{1.0});
+    EXPECT_EQ(env->getAt({0, 2}, "x"), Value{});
+    EXPECT_EQ(env->getAt({0, Slots::k_numInline + 1}, "x"), Value{"last"});
+  }
+}
+
+TEST(Environment, SlotsNotVisibleByName) {
+  // GIVEN
+  auto envPtr = Environment::create(nullptr, 1);
+
+  // WHEN
+  envPtr->defineAt(0, 42.0);
+
+  // THEN
+  EXPECT_THROW(envPtr->get("x"), InterpretException);
+}
+
+TEST(Environment, AssignAtInParentEnv) {
+  // GIVEN
+  auto parentPtr = Environment::create(nullptr, 1);
+  parentPtr->defineAt(0, 50.0);
+  auto childPtr = Environment::create(parentPtr);
+  Value updated = true;
+
+  // WHEN
+  childPtr->assignAt({1, 0}, "x", updated);
+
+  // THEN
+  EXPECT_EQ(childPtr->getAt({1, 0}, "x"), updated);
+  EXPECT_EQ(parentPtr->getAt({0, 0}, "x"), updated);
+}
+
+TEST(Environment, NamedVarShadowsSlotInParent) {
+  // GIVEN
+  auto scopePtr = Environment::create(nullptr, 1);
+  scopePtr->defineAt(0, 1.0);
+  auto instancePtr = Environment::create(scopePtr);
+  instancePtr->define("x", 2.0);
+  auto fnPtr = Environment::create(instancePtr);
+
+  // THEN
+  EXPECT_EQ(fnPtr->getAt({2, 0}, "x"), Value{2.0});
+  EXPECT_EQ(fnPtr->getAt({2, 0}, "y"), Value{1.0});
+}
+
+TEST(Environment, UpvalueOutlivesScope) {
+  // GIVEN
+  auto parentPtr = Environment::create(nullptr, 1);
+  auto scopePtr = Environment::create(parentPtr, 2);
+  scopePtr->defineAt(1, "captured");
+  std::weak_ptr<Environment> parent = parentPtr;
+  parentPtr.reset();
+
+  // WHEN
+  auto upvalue = scopePtr->capture({0, 1});
+  EXPECT_EQ(upvalue, scopePtr->capture({0, 1}));
+  upvalue->set("updated");
+  EXPECT_EQ(scopePtr->getAt({0, 1}, "x"), Value{"updated"});
+  scopePtr.reset();
+
+  // THEN
+  EXPECT_TRUE(parent.expired());
+  EXPECT_EQ(upvalue->get(), Value{"updated"});
+}
+
+TEST(Environment, GlobalCacheFollowsLayoutVersion) {
+  // GIVEN
+  auto globalsPtr = Environment::create();
+  globalsPtr->define("x", 1.0);
+  auto fnPtr = Environment::create(globalsPtr, 1);
+  GlobalCache cache;
+
+  // WHEN
+  Value first = fnPtr->getGlobal("x", *globalsPtr, cache);
+  GlobalCache filled = cache;
+  fnPtr->assignGlobal("x", 2.0, *globalsPtr, cache);
+  Value assigned = globalsPtr->get("x");
+  globalsPtr->define("y", 3.0);
+  Value declared = fnPtr->getGlobal("y", *globalsPtr, cache);
+
+  // THEN
+  EXPECT_EQ(first, Value{1.0});
+  EXPECT_NE(0, filled.layoutVersion);
+  EXPECT_EQ(assigned, Value{2.0});
+  // Declaring a global moves the globals to a new version, so the cache is
+  // filled again
+  EXPECT_EQ(declared, Value{3.0});
+  EXPECT_NE(filled.layoutVersion, cache.layoutVersion);
+}
+
+TEST(Environment, GlobalCacheOnlyHoldsTheGivenGlobals) {
+  // GIVEN
+  auto otherPtr = Environment::create();
+  otherPtr->define("x", 1.0);
+  auto globalsPtr = Environment::create();
+  globalsPtr->define("x", 2.0);
+  auto fnPtr = Environment::create(otherPtr, 1);
+  GlobalCache cache;
 
   // WHEN
-  auto tailOfScope = Environment::extend(scopePtr2);
+  Value v = fnPtr->getGlobal("x", *globalsPtr, cache);
 
   // THEN
-  EXPECT_THROW(scopePtr->define("newVar", "_"), InterpretException);
-  EXPECT_NO_THROW(tailOfScope->define("x", "abc"));
-  EXPECT_THROW(tailOfScope->define("y", "abc"), InterpretException);
+  EXPECT_EQ(v, Value{1.0});
+  EXPECT_EQ(0, cache.layoutVersion);
+  EXPECT_THROW(fnPtr->getGlobal("y", *globalsPtr, cache), InterpretException);
 }
 
 } // namespace test
@@ -0,0 +1,93 @@
+#include <gc.h>
+
+#include <gtest/gtest.h>
+
+#include <class.h>
+#include <environment.h>
+#include <interpreter.h>
+#include <parse_code.h>
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+TEST(GarbageCollector, CollectsCycles) {
+  // GIVEN
+  // An instance whose fields hold the instance itself
+  std::weak_ptr<Environment> weakEnv;
+  {
+    auto env = Environment::create();
+    env->define("this", makeRef<ClassInstance>("A", env));
+    weakEnv = env;
+  }
+  ASSERT_FALSE(weakEnv.expired());
+
+  // WHEN
+  gc::collect();
+
+  // THEN
+  EXPECT_TRUE(weakEnv.expired());
+}
+
+TEST(GarbageCollector, KeepsObjectsHeldOutsideTheHeap) {
+  // GIVEN
+  // The same cycle, held by a temporary and by a variable in another scope
+  auto globals = Environment::create();
+  Value temporary;
+  std::weak_ptr<Environment> weakEnvs[2];
+  for (int i = 0; i < 2; i++) {
+    auto env = Environment::create();
+    ClsInstShrdPtr inst = makeRef<ClassInstance>("A", env);
+    env->define("this", inst);
+    if (i == 0) {
+      temporary = inst;
+    } else {
+      globals->define("inst", inst);
+    }
+    weakEnvs[i] = env;
+  }
+
+  // WHEN
+  gc::collect();
+
+  // THEN
+  for (auto &weakEnv : weakEnvs) {
+    ASSERT_FALSE(weakEnv.expired());
+    EXPECT_EQ(1, weakEnv.lock()->shape()->size());
+  }
+  EXPECT_EQ(temporary, weakEnvs[0].lock()->get("this"));
+  EXPECT_EQ(globals->get("inst"), weakEnvs[1].lock()->get("this"));
+}
+
+TEST(GarbageCollector, CollectsWhileInterpreting) {
+  // GIVEN
+  // Each iteration leaks an instance holding itself and a recursive closure
+  std::string code = R"(
+    var i = 0;
+    class Node { init() { this.self = this; } }
+    while (i < 50000) {
+      var n = Node();
+      fun count(x) { if (x > 0) { return count(x - 1); }; return x; }
+      i = i + count(1) + 1;
+    };
+  )";
+  auto statements = testutil::resolveCode(code);
+  std::vector<InterpretException> errs;
+  auto env = Environment::create();
+  int numCollections = gc::stats().numCollections;
+
+  // WHEN
+  interpret(statements, env, errs);
+
+  // THEN
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ(Value{50000.0}, env->get("i"));
+  EXPECT_LT(numCollections, gc::stats().numCollections);
+  EXPECT_LT(0, gc::stats().maxPause.count());
+  // Without collecting, every iteration would leave several objects behind
+  EXPECT_GT(50000, gc::numObjects());
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
@@ -2,6 +2,11 @@
 
 #include <gtest/gtest.h>
 
+#include <allocations.h>
+#include <class.h>
+#include <func.h>
+#include <parse_code.h>
+#include <scanner.h>
 #include <stmt_printer.h>
 
 namespace plox {
@@ -41,7 +46,7 @@ TEST(Interpreter, smoke) {
 
   // Then
   auto val = env->get("myVar");
-  ASSERT_EQ(56.0, std::get<double>(val));
+  ASSERT_EQ(56.0, val.get<double>());
   ASSERT_EQ(0, errs.size());
 }
 
@@ -91,7 +96,7 @@ TEST(Interpreter, UseVar) {
 
   // Then
   auto b = env->get("b");
-  ASSERT_EQ(6, std::get<double>(b));
+  ASSERT_EQ(6, b.get<double>());
   ASSERT_EQ(0, errs.size());
 }
 
@@ -119,10 +124,95 @@ TEST(Interpreter, ReassignVar) {
 
   // Then
   auto a = env->get("a");
-  ASSERT_EQ(6, std::get<double>(a));
+  ASSERT_EQ(6, a.get<double>());
   ASSERT_EQ(0, errs.size());
 }
 
+TEST(Interpreter, InstancesShareClassMethods) {
+  // Given
+  std::string code = R"(
+    var a;
+    var b;
+    class A { f() { return 1; } g() { return 2; } }
+    a = A();
+    b = A();
+  )";
+  auto statements = testutil::parseCode(code);
+  std::vector<InterpretException> errs;
+  auto env = Environment::create();
+
+  // When
+  interpret(statements, env, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  auto a = env->get("a").get<ClsInstShrdPtr>();
+  auto b = env->get("b").get<ClsInstShrdPtr>();
+  // Instances only hold 'this', not copies of the methods
+  EXPECT_EQ(1, a->getClosure()->shape()->size());
+
+  // Methods are bound to the instance they're accessed through
+  auto aF = a->getClosure()->get("f").get<FnDescShrdPtr>();
+  auto bF = b->getClosure()->get("f").get<FnDescShrdPtr>();
+  EXPECT_EQ(a->getClosure(), aF->getClosure());
+  EXPECT_EQ(b->getClosure(), bF->getClosure());
+  EXPECT_EQ(aF->getFunction(), bF->getFunction());
+}
+
+TEST(Interpreter, SmallCallsDontAllocate) {
+  // Given
+  auto statements = testutil::resolveCode(R"(
+    fun add(a, b) { var sum = a + b; return sum; }
+    {
+      for (var i = 0; i < 1000; i = i + 1) {
+        add(i, i);
+      };
+    }
+  )");
+  std::vector<InterpretException> errs;
+  auto env = Environment::create();
+  interpret(statements, env, errs);
+  std::vector<stmt::Stmt> calls;
+  calls.push_back(std::move(statements[1]));
+
+  // When
+  long before = testutil::numAllocations();
+  interpret(calls, env, errs);
+  long allocations = testutil::numAllocations() - before;
+
+  // Then
+  // Each call and loop iteration reuses the memory of the last
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ(0, allocations);
+}
+
+TEST(Interpreter, TailCallsDontGrowTheStack) {
+  // Given
+  // Deep enough to overflow the C++ stack if each call recursed on it
+  std::string code = R"(
+    fun ping(n, pong) { if (n == 0) return "ping";; return pong(n - 1, ping); }
+    fun pong(n, ping) { if (n == 0) return "pong";; return ping(n - 1, pong); }
+    fun count(n, total) {
+      if (n == 0) return total;;
+      return count(n - 1, total + 1);
+    }
+    print ping(100001, pong);
+    print count(100000, 0);
+  )";
+  auto statements = testutil::resolveCode(code);
+  std::vector<InterpretException> errs;
+  auto env = Environment::create();
+
+  // When
+  ::testing::internal::CaptureStdout();
+  interpret(statements, env, errs);
+  auto out = ::testing::internal::GetCapturedStdout();
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("pong\n100000\n", out);
+}
+
 } // namespace test
 } // namespace treewalk
 } // namespace plox
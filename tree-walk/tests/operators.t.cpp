@@ -0,0 +1,48 @@
+#include <operators.h>
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <errs.h>
+
+#include <string>
+
+using ::testing::HasSubstr;
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+TEST(Operators, NumbersUseTheFastPath) {
+  EXPECT_EQ(Value(3.5), operators::add(1.5, 2.0));
+  EXPECT_EQ(-0.5, operators::subtract(1.5, 2.0));
+  EXPECT_EQ(3.0, operators::multiply(1.5, 2.0));
+  EXPECT_EQ(0.75, operators::divide(1.5, 2.0));
+}
+
+TEST(Operators, OtherTypesUseTheVisitors) {
+  EXPECT_EQ(Value("ab"), operators::add("a", "b"));
+
+  try {
+    operators::add("a", 1.0);
+    FAIL() << "Expected adding a string and a number to throw";
+  } catch (const InterpretException &e) {
+    EXPECT_THAT(e.what(), HasSubstr("Unable to add types"));
+  }
+  EXPECT_THROW(operators::subtract(1.0, true), InterpretException);
+  EXPECT_THROW(operators::multiply(Value(), 1.0), InterpretException);
+  EXPECT_THROW(operators::divide("a", "b"), InterpretException);
+}
+
+TEST(Operators, OnlyNilFalseAndZeroAreFalsey) {
+  EXPECT_FALSE(operators::isTruthy(Value()));
+  EXPECT_FALSE(operators::isTruthy(false));
+  EXPECT_FALSE(operators::isTruthy(0.0));
+  EXPECT_TRUE(operators::isTruthy(true));
+  EXPECT_TRUE(operators::isTruthy(-1.0));
+  EXPECT_TRUE(operators::isTruthy(""));
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
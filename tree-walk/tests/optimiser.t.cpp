@@ -0,0 +1,100 @@
+#include <optimiser.h>
+
+#include <gtest/gtest.h>
+
+#include <parse_code.h>
+#include <stmt_printer.h>
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+namespace {
+std::vector<std::string> print(const std::vector<stmt::Stmt> &stmts) {
+  std::vector<std::string> printed;
+  for (auto &s : stmts) {
+    printed.push_back(std::visit(stmt::PrinterVisitor{}, s));
+  }
+  return printed;
+}
+} // namespace
+
+TEST(Optimiser, FoldsConstantExpressions) {
+  // Given
+  std::string code = R"(
+    var ms = 60 * 60 * 1000;
+    var s = "prefix" + "suffix";
+    var b = !(1 < 2);
+    var neg = -(2 + 3);
+  )";
+  auto stmts = testutil::parseCode(code);
+  std::list<std::string> constants;
+
+  // When
+  optimise(stmts, constants);
+
+  // Then
+  std::vector<std::string> expected{"var ms = 3600000", "var s = prefixsuffix",
+                                    "var b = false", "var neg = -5"};
+  EXPECT_EQ(expected, print(stmts));
+}
+
+TEST(Optimiser, LeavesNonConstantAndInvalidExpressions) {
+  // Given
+  std::string code = R"(
+    var a = x * (2 + 3);
+    var b = 1 + "a";
+  )";
+  auto stmts = testutil::parseCode(code);
+  std::list<std::string> constants;
+
+  // When
+  optimise(stmts, constants);
+
+  // Then
+  std::vector<std::string> expected{"var a = ((var x)*5)", "var b = (1+a)"};
+  EXPECT_EQ(expected, print(stmts));
+}
+
+TEST(Optimiser, RemovesDeadBranches) {
+  // Given
+  std::string code = R"(
+    if (1 + 1 == 2) print "yes"; else print "no";;
+    if (nul) print "never";;
+    while (false) print "never";;
+    for (var i = 0; false; i = i + 1) print "never";;
+  )";
+  auto stmts = testutil::parseCode(code);
+  std::list<std::string> constants;
+
+  // When
+  optimise(stmts, constants);
+
+  // Then
+  std::vector<std::string> expected{"print yes", "var i = 0"};
+  EXPECT_EQ(expected, print(stmts));
+}
+
+TEST(Optimiser, DropsCodeAfterReturn) {
+  // Given
+  std::string code = R"(
+    fun f() {
+      if (x) { return 1; print "unreachable"; };
+      return 2;
+      print "unreachable";
+    }
+  )";
+  auto stmts = testutil::parseCode(code);
+  std::list<std::string> constants;
+
+  // When
+  optimise(stmts, constants);
+
+  // Then
+  std::vector<std::string> expected{"fun()if((var x))({return 1;;})return 2;"};
+  EXPECT_EQ(expected, print(stmts));
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
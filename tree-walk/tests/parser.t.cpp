@@ -253,6 +253,47 @@ TEST(Parser, BlockNotClosed) {
   ASSERT_EQ(0, stmts.size());
 }
 
+TEST(Parser, LiteralsAreDecoded) {
+  // Given
+  std::vector<ParseException> errs;
+  // 2.5 + "str";
+  std::vector<Token> toks{{TokenType::NUMBER, "2.5", 0},
+                          {TokenType::PLUS, "+", 0},
+                          {TokenType::STRING, "str", 0},
+                          {TokenType::SEMICOLON, ";", 0}};
+
+  // When
+  auto stmts = parse(toks, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  ASSERT_EQ(1, stmts.size());
+  auto &bin = std::get<ast::Binary>(*std::get<stmt::Expression>(stmts[0]).expr);
+  auto &lhs = std::get<ast::Literal>(*bin.left);
+  ASSERT_TRUE(lhs.constant);
+  EXPECT_EQ(2.5, lhs.constant->get<double>());
+  auto &rhs = std::get<ast::Literal>(*bin.right);
+  ASSERT_TRUE(rhs.constant);
+  EXPECT_EQ("str", rhs.constant->get<std::string>());
+}
+
+TEST(Parser, MalformedNumberIsParseError) {
+  // Given
+  std::vector<ParseException> errs;
+  // print 1.2.3;
+  std::vector<Token> toks{{TokenType::PRINT, "print", 3},
+                          {TokenType::NUMBER, "1.2.3", 3},
+                          {TokenType::SEMICOLON, ";", 3}};
+
+  // When
+  auto stmts = parse(toks, errs);
+
+  // Then
+  ASSERT_EQ(1, errs.size());
+  ASSERT_THAT(errs[0].what(), ::HasSubstr("Unable to read number: 1.2.3"));
+  ASSERT_EQ(0, stmts.size());
+}
+
 } // namespace test
 } // namespace treewalk
 } // namespace plox
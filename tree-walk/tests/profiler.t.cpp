@@ -0,0 +1,135 @@
+#include <profiler.h>
+
+#include <gtest/gtest.h>
+
+#include <environment.h>
+#include <interpreter.h>
+#include <parse_code.h>
+
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+namespace {
+// The nanoseconds spent in each stack of the folded output
+std::map<std::string, long> runProfiled(const std::string &code) {
+  auto stmts = testutil::resolveCode(code);
+  auto env = Environment::create();
+  std::vector<InterpretException> errs;
+  Profiler profiler;
+  interpret(stmts, env, errs, &profiler);
+  EXPECT_EQ(0, errs.size());
+
+  std::ostringstream os;
+  profiler.writeFolded(os);
+  std::map<std::string, long> stacks;
+  std::istringstream is(os.str());
+  std::string stack;
+  long nanos;
+  while (is >> stack >> nanos) {
+    stacks[stack] = nanos;
+  }
+  return stacks;
+}
+} // namespace
+
+TEST(Profiler, AttributesTimeToCallStacks) {
+  // GIVEN
+  std::string code = R"(
+    fun inner() {
+      var total = 0;
+      for (var i = 0; i < 100; i = i + 1) total = total + i;;
+      return total;
+    }
+    fun outer() {
+      return inner() +
+        inner();
+    }
+    outer();
+    inner();
+  )";
+
+  // WHEN
+  auto stacks = runProfiled(code);
+
+  // THEN
+  // Calls on different lines are different frames
+  EXPECT_EQ(5, stacks.size());
+  EXPECT_TRUE(stacks.count("script"));
+  EXPECT_TRUE(stacks.count("script;outer:11"));
+  EXPECT_TRUE(stacks.count("script;outer:11;inner:8"));
+  EXPECT_TRUE(stacks.count("script;outer:11;inner:9"));
+  EXPECT_TRUE(stacks.count("script;inner:12"));
+  for (auto &[stack, nanos] : stacks) {
+    EXPECT_LT(0, nanos) << stack;
+  }
+}
+
+TEST(Profiler, MergesRepeatedCalls) {
+  // GIVEN
+  std::string code = R"(
+    fun f(n) { if (n > 0) return 1 + f(n - 1);; return n; }
+    for (var i = 0; i < 3; i = i + 1) f(2);;
+  )";
+
+  // WHEN
+  auto stacks = runProfiled(code);
+
+  // THEN
+  EXPECT_EQ(4, stacks.size());
+  EXPECT_TRUE(stacks.count("script;f:3;f:2;f:2"));
+}
+
+TEST(Profiler, TailCallsStayUnderTheirCaller) {
+  // GIVEN
+  std::string code = R"(
+    fun leaf(n) {
+      var total = 0;
+      for (var i = 0; i < n; i = i + 1) total = total + i;;
+      return total;
+    }
+    fun mid(n) { return leaf(n); }
+    mid(100);
+  )";
+
+  // WHEN
+  auto stacks = runProfiled(code);
+
+  // THEN
+  // leaf is called from mid's line, with mid still on the stack
+  EXPECT_EQ(3, stacks.size());
+  EXPECT_TRUE(stacks.count("script"));
+  EXPECT_TRUE(stacks.count("script;mid:8"));
+  EXPECT_TRUE(stacks.count("script;mid:8;leaf:7"));
+}
+
+TEST(Profiler, FoldsTailRecursion) {
+  // GIVEN
+  std::string code = R"(
+    fun f(n) { if (n > 0) return f(n - 1);; return n; }
+    fun ping(n, pong) { if (n == 0) return n;; return pong(n - 1, ping); }
+    fun pong(n, ping) { if (n == 0) return n;; return ping(n - 1, pong); }
+    f(1000);
+    ping(1000, pong);
+  )";
+
+  // WHEN
+  auto stacks = runProfiled(code);
+
+  // THEN
+  // Each call in the chain is shown once, however many times it's made
+  EXPECT_EQ(6, stacks.size());
+  EXPECT_TRUE(stacks.count("script;f:5"));
+  EXPECT_TRUE(stacks.count("script;f:5;f:2"));
+  EXPECT_TRUE(stacks.count("script;ping:6"));
+  EXPECT_TRUE(stacks.count("script;ping:6;pong:3"));
+  EXPECT_TRUE(stacks.count("script;ping:6;pong:3;ping:4"));
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
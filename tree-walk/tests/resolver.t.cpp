@@ -0,0 +1,186 @@
+#include <resolver.h>
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <parse_code.h>
+
+using ::testing::HasSubstr;
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+TEST(Resolver, GlobalsAreNotResolved) {
+  // Given
+  std::string code = "var a = 1; print a;";
+  auto stmts = testutil::parseCode(code);
+  std::vector<ResolveException> errs;
+
+  // When
+  resolve(stmts, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_FALSE(std::get<stmt::VarDecl>(stmts[0]).slot);
+  auto &print = std::get<stmt::Print>(stmts[1]);
+  auto loc = std::get<ast::Variable>(*print.expr).loc;
+  ASSERT_TRUE(loc);
+  EXPECT_TRUE(loc->isGlobal);
+}
+
+TEST(Resolver, BlockVarsGetSlots) {
+  // Given
+  std::string code = "{ var a = 1; var b = 2; print b; }";
+  auto stmts = testutil::parseCode(code);
+  std::vector<ResolveException> errs;
+
+  // When
+  resolve(stmts, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  auto &blk = std::get<stmt::Block>(stmts[0]);
+  EXPECT_EQ(2, blk.numSlots);
+  EXPECT_EQ(0, std::get<stmt::VarDecl>(*blk.stmts[0]).slot);
+  EXPECT_EQ(1, std::get<stmt::VarDecl>(*blk.stmts[1]).slot);
+  auto &print = std::get<stmt::Print>(*blk.stmts[2]);
+  auto loc = std::get<ast::Variable>(*print.expr).loc;
+  ASSERT_TRUE(loc);
+  EXPECT_EQ(0, loc->depth);
+  EXPECT_EQ(1, loc->slot);
+}
+
+TEST(Resolver, FunctionSeesOnlyEarlierDeclarations) {
+  // Given
+  std::string code = R"(
+    {
+      var a = 1;
+      fun f(x) { print a; print b; print x; }
+      var b = 2;
+    }
+  )";
+  auto stmts = testutil::parseCode(code);
+  std::vector<ResolveException> errs;
+
+  // When
+  resolve(stmts, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  auto &blk = std::get<stmt::Block>(stmts[0]);
+  auto &fun = std::get<stmt::Fun>(*blk.stmts[1]);
+  EXPECT_EQ(1, fun.slot);
+  EXPECT_EQ(1, fun.numSlots);
+
+  auto locOf = [&](int i) {
+    auto &print = std::get<stmt::Print>(*fun.stmts[i]);
+    return std::get<ast::Variable>(*print.expr).loc;
+  };
+  // 'a' is captured from the block the function is defined in
+  ASSERT_TRUE(locOf(0));
+  EXPECT_TRUE(locOf(0)->isUpvalue);
+  EXPECT_EQ(0, locOf(0)->slot);
+  ASSERT_EQ(1, fun.upvalues.size());
+  EXPECT_EQ((VarLocation{0, 0}), fun.upvalues[0]);
+  // 'b' is declared after the function so must be looked up as a global
+  ASSERT_TRUE(locOf(1));
+  EXPECT_TRUE(locOf(1)->isGlobal);
+  ASSERT_TRUE(locOf(2));
+  EXPECT_EQ(0, locOf(2)->depth);
+  EXPECT_EQ(0, locOf(2)->slot);
+}
+
+TEST(Resolver, MethodsResolvePastClassScope) {
+  // Given
+  std::string code = R"(
+    {
+      var a = 1;
+      class A { f() { print a; print this; } }
+    }
+  )";
+  auto stmts = testutil::parseCode(code);
+  std::vector<ResolveException> errs;
+
+  // When
+  resolve(stmts, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  auto &blk = std::get<stmt::Block>(stmts[0]);
+  auto &cls = std::get<stmt::Class>(*blk.stmts[1]);
+  auto &method = std::get<stmt::Fun>(*cls.methods[0]);
+  EXPECT_FALSE(method.slot);
+
+  auto &printA = std::get<stmt::Print>(*method.stmts[0]);
+  auto loc = std::get<ast::Variable>(*printA.expr).loc;
+  ASSERT_TRUE(loc);
+  EXPECT_TRUE(loc->isUpvalue);
+  EXPECT_EQ(0, loc->slot);
+  EXPECT_EQ(1, loc->shadowingScopes); // fields of the instance shadow 'a'
+  // Captured from the block, past the class scope
+  ASSERT_EQ(1, method.upvalues.size());
+  EXPECT_EQ((VarLocation{0, 0}), method.upvalues[0]);
+
+  // Names the instance may hold aren't treated as globals
+  auto &printThis = std::get<stmt::Print>(*method.stmts[1]);
+  EXPECT_FALSE(std::get<ast::Variable>(*printThis.expr).loc);
+}
+
+TEST(Resolver, NestedFunctionsCaptureThroughEnclosing) {
+  // Given
+  std::string code = R"(
+    {
+      var a = 1;
+      fun outer() {
+        var b = 2;
+        fun inner() { print b; print a; print a; }
+      }
+    }
+  )";
+  auto stmts = testutil::parseCode(code);
+  std::vector<ResolveException> errs;
+
+  // When
+  resolve(stmts, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  auto &blk = std::get<stmt::Block>(stmts[0]);
+  auto &outer = std::get<stmt::Fun>(*blk.stmts[1]);
+  auto &inner = std::get<stmt::Fun>(*outer.stmts[1]);
+
+  // 'outer' captures 'a' so that 'inner' can capture it from 'outer'
+  ASSERT_EQ(1, outer.upvalues.size());
+  EXPECT_EQ((VarLocation{0, 0}), outer.upvalues[0]);
+  ASSERT_EQ(2, inner.upvalues.size());
+  EXPECT_EQ((VarLocation{0, 0}), inner.upvalues[0]);
+  EXPECT_EQ((VarLocation{0, 0, true}), inner.upvalues[1]);
+
+  // Both uses of 'a' share an upvalue
+  auto locOf = [&](int i) {
+    auto &print = std::get<stmt::Print>(*inner.stmts[i]);
+    return std::get<ast::Variable>(*print.expr).loc;
+  };
+  EXPECT_EQ((VarLocation{0, 0, true}), locOf(0));
+  EXPECT_EQ((VarLocation{0, 1, true}), locOf(1));
+  EXPECT_EQ((VarLocation{0, 1, true}), locOf(2));
+}
+
+TEST(Resolver, RedefineInScopeErrors) {
+  // Given
+  std::string code = "{ var a = 1; var a = 2; }";
+  auto stmts = testutil::parseCode(code);
+  std::vector<ResolveException> errs;
+
+  // When
+  resolve(stmts, errs);
+
+  // Then
+  ASSERT_EQ(1, errs.size());
+  ASSERT_THAT(errs[0].what(), ::HasSubstr("Cannot redefine"));
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
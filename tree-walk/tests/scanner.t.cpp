@@ -84,6 +84,74 @@ TEST(Scanner, Print) {
   ASSERT_EQ(0, errors.size());
 }
 
+TEST(Scanner, KeywordsIgnoreCase) {
+  // Given
+  // Keywords in any case, and identifiers a char off from one
+  std::vector<SyntaxException> errors;
+  std::string code = "ClAsS WHILE whiles Nul_ fo r0r anD Return";
+  std::vector<Token> expected{
+      Token{TokenType::CLASS, "ClAsS", 1},
+      Token{TokenType::WHILE, "WHILE", 1},
+      Token{TokenType::IDENTIFIER, "whiles", 1},
+      Token{TokenType::IDENTIFIER, "Nul_", 1},
+      Token{TokenType::IDENTIFIER, "fo", 1},
+      Token{TokenType::IDENTIFIER, "r0r", 1},
+      Token{TokenType::AND, "anD", 1},
+      Token{TokenType::RETURN, "Return", 1},
+      Token{TokenType::EOF_, "", 1}};
+
+  // When
+  auto vec = scanTokens(code, errors);
+
+  // Then
+  ASSERT_EQ(expected, vec);
+  ASSERT_EQ(0, errors.size());
+}
+
+TEST(Scanner, LongRunsCrossBlocks) {
+  // Given
+  // Runs longer than a block, ending part way through one, and at the end of
+  // the code where there isn't a whole block left
+  std::vector<SyntaxException> errors;
+  std::string ident(70, 'a');
+  ident += "_Z9";
+  std::string number(40, '7');
+  std::string str = std::string(20, 'x') + "\n" + std::string(30, 'y');
+  std::string code = std::string(45, ' ') + "\n\t\r\n" + ident + " = " +
+                     number + ";" + std::string(33, '\n') + "\"" + str +
+                     "\" " + ident;
+  std::vector<Token> expected{
+      Token{TokenType::IDENTIFIER, ident, 3},
+      Token{TokenType::EQUAL, "=", 3},
+      Token{TokenType::NUMBER, number, 3},
+      Token{TokenType::SEMICOLON, ";", 3},
+      Token{TokenType::STRING, str, 37},
+      Token{TokenType::IDENTIFIER, ident, 37},
+      Token{TokenType::EOF_, "", 37}};
+
+  // When
+  auto vec = scanTokens(code, errors);
+
+  // Then
+  ASSERT_EQ(expected, vec);
+  ASSERT_EQ(0, errors.size());
+}
+
+TEST(Scanner, LinesCountedUpToErrors) {
+  // Given
+  std::vector<SyntaxException> errors;
+  std::string code = "1.;" + std::string(40, '\n') + "\"" +
+                     std::string(50, '\n');
+
+  // When
+  auto vec = scanTokens(code, errors);
+
+  // Then
+  ASSERT_EQ(2, errors.size());
+  EXPECT_STREQ("Trailing dot found in number on line 1", errors[0].what());
+  EXPECT_STREQ("Unterminated string! on line 91", errors[1].what());
+}
+
 } // namespace test
 } // namespace treewalk
 } // namespace plox
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <environment.h>
+#include <shape.h>
+
+#include <string>
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+TEST(Shape, SharedBySameDefinitions) {
+  // GIVEN
+  auto a = Environment::create();
+  auto b = Environment::create();
+
+  // WHEN
+  a->define("x", 1.0);
+  a->define("y", 2.0);
+  b->define("x", "other");
+  b->define("y", "values");
+
+  // THEN
+  EXPECT_EQ(a->shape(), b->shape());
+  EXPECT_EQ(0, a->shape()->find("x"));
+  EXPECT_EQ(1, a->shape()->find("y"));
+  EXPECT_EQ(-1, a->shape()->find("z"));
+}
+
+TEST(Shape, DefinitionOrderMatters) {
+  // GIVEN
+  auto a = Environment::create();
+  auto b = Environment::create();
+
+  // WHEN
+  a->define("x");
+  a->define("y");
+  b->define("y");
+  b->define("x");
+
+  // THEN
+  EXPECT_NE(a->shape(), b->shape());
+}
+
+TEST(Shape, UnsharedOnceLarge) {
+  // GIVEN
+  auto env = Environment::create();
+
+  // WHEN
+  for (int i = 0; i <= Shape::k_maxSharedSize; i++) {
+    env->define("shapeTestVar" + std::to_string(i), double(i));
+  }
+
+  // THEN
+  EXPECT_FALSE(env->shape()->isShared());
+  EXPECT_EQ(Shape::k_maxSharedSize + 1, env->shape()->size());
+  EXPECT_EQ(env->get("shapeTestVar0"), Value{0.0});
+
+  auto copy = std::make_shared<Environment>(*env);
+  copy->define("extra");
+  EXPECT_NE(env->shape(), copy->shape());
+  EXPECT_FALSE(env->isVarInScope("extra"));
+}
+
+TEST(Shape, CacheRemembersPropertyIndex) {
+  // GIVEN
+  PropertyCache getCache;
+  PropertyCache setCache;
+  auto a = Environment::create();
+  auto b = Environment::create();
+  a->define("x", 1.0);
+  b->define("x", 2.0);
+
+  // WHEN
+  a->setProperty("y", "a", setCache);
+  b->setProperty("y", "b", setCache);
+  Value fromA = a->getProperty("y", getCache);
+  Value fromB = b->getProperty("y", getCache);
+
+  // THEN
+  EXPECT_EQ(Value{"a"}, fromA);
+  EXPECT_EQ(Value{"b"}, fromB);
+  EXPECT_EQ(a->shape(), b->shape());
+  ASSERT_TRUE(getCache.find(a->shape()));
+  EXPECT_EQ(1, getCache.find(a->shape())->index);
+
+  // The second Set took the transition the first one cached
+  auto *added = setCache.find(Shape::empty()->withName("x"));
+  ASSERT_TRUE(added);
+  EXPECT_EQ(a->shape(), added->added);
+}
+
+TEST(Shape, CacheHoldsSeveralShapes) {
+  // GIVEN
+  PropertyCache cache;
+  std::vector<std::shared_ptr<Environment>> envs;
+  for (const char *first : {"a", "b", "c"}) {
+    auto env = Environment::create();
+    env->define(first);
+    env->define("x", first);
+    envs.push_back(env);
+  }
+
+  // WHEN
+  for (auto &env : envs) {
+    env->getProperty("x", cache);
+  }
+
+  // THEN
+  EXPECT_EQ(Value{"a"}, envs[0]->getProperty("x", cache));
+  EXPECT_EQ(Value{"b"}, envs[1]->getProperty("x", cache));
+  EXPECT_EQ(Value{"c"}, envs[2]->getProperty("x", cache));
+  for (auto &env : envs) {
+    ASSERT_TRUE(cache.find(env->shape()));
+    EXPECT_EQ(1, cache.find(env->shape())->index);
+  }
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
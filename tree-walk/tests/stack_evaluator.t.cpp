@@ -0,0 +1,117 @@
+#include <stack_evaluator.h>
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <parse_code.h>
+
+using ::testing::HasSubstr;
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+namespace {
+std::string runCode(const std::string &code,
+                    std::vector<InterpretException> &errs,
+                    std::size_t stackBudget = stack::k_defaultStackBudget) {
+  auto stmts = testutil::resolveCode(code);
+  auto env = Environment::create();
+  ::testing::internal::CaptureStdout();
+  stack::interpret(stmts, env, errs, nullptr, stackBudget);
+  return ::testing::internal::GetCapturedStdout();
+}
+} // namespace
+
+TEST(StackEvaluator, ClassesAndClosures) {
+  // Given
+  std::string code = R"(
+    class A {
+      init(n) { this.n = n; }
+      get() { return this.n; }
+    }
+    class B < A {
+      init(n) { super.init(n * 2); }
+      get() { return super.get() + 1; }
+    }
+    fun makeCounter() {
+      var i = 0;
+      fun count() { i = i + 1; return i; }
+      return count;
+    }
+    var c = makeCounter();
+    c();
+    print B(3).get();
+    print c();
+  )";
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("7\n2\n", out);
+}
+
+TEST(StackEvaluator, RecursesPastTheNativeStack) {
+  // Given
+  // Deep enough to overflow the C++ stack if each call recursed on it
+  std::string code = R"(
+    fun depth(n) {
+      if (n == 0) return 0;;
+      return depth(n - 1) + 1;
+    }
+    print depth(200000);
+  )";
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("200000\n", out);
+}
+
+TEST(StackEvaluator, OverflowingTheBudgetIsAnError) {
+  // Given
+  std::string code = R"(
+    fun forever(n) { return forever(n + 1) + 1; }
+    print "before";
+    forever(0);
+    print "after";
+  )";
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, errs, 64 * 1024);
+
+  // Then
+  EXPECT_EQ("before\n", out);
+  ASSERT_EQ(1, errs.size());
+  EXPECT_THAT(errs[0].what(), HasSubstr("Stack overflow"));
+}
+
+TEST(StackEvaluator, TailCallsDontGrowTheStack) {
+  // Given
+  std::string code = R"(
+    fun count(n, total) {
+      if (n == 0) return total;;
+      return count(n - 1, total + 1);
+    }
+    print count(100000, 0);
+  )";
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, errs, 64 * 1024);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("100000\n", out);
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
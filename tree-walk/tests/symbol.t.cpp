@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <parser.h>
+#include <scanner.h>
+#include <symbol.h>
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+TEST(Symbol, SameNameSharesId) {
+  // GIVEN
+  std::string name = "symbolTestName";
+
+  // WHEN
+  Symbol a(name);
+  Symbol b(std::string_view(name).substr(0));
+  Symbol c("symbolTestOther");
+
+  // THEN
+  EXPECT_EQ(a.id(), b.id());
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ("symbolTestName", a.str());
+}
+
+TEST(Symbol, OutlivesSource) {
+  // GIVEN
+  auto name = std::make_unique<std::string>("symbolTestTemporary");
+  Symbol sym(*name);
+
+  // WHEN
+  name.reset();
+
+  // THEN
+  EXPECT_EQ("symbolTestTemporary", sym.str());
+  EXPECT_EQ(sym, Symbol("symbolTestTemporary"));
+}
+
+TEST(Symbol, ParserInternsIdentifiers) {
+  // GIVEN
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens("var symbolTestVar = 1; symbolTestVar;", syntErrs);
+  int countBefore = symbols::count();
+
+  // WHEN
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+
+  // THEN
+  ASSERT_EQ(2, stmts.size());
+  auto &decl = std::get<stmt::VarDecl>(stmts[0]);
+  auto &expr = std::get<stmt::Expression>(stmts[1]);
+  auto &var = std::get<ast::Variable>(*expr.expr);
+  EXPECT_EQ(decl.name.id(), var.name.id());
+  EXPECT_EQ(countBefore + 1, symbols::count());
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <class.h>
+#include <value.h>
+#include <value_printer.h>
+
+#include <cmath>
+#include <limits>
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+TEST(Value, HoldsEachType) {
+  // GIVEN
+  auto clsDef = makeRef<ClassDefinition>("A", Environment::create(),
+                                         ClsDefShrdPtr());
+
+  // WHEN
+  Value nil;
+  Value str = "str";
+  Value b = true;
+  Value d = 2.5;
+  Value cls = clsDef;
+
+  // THEN
+  EXPECT_EQ(8, sizeof(Value));
+  EXPECT_TRUE(nil.is<std::monostate>());
+  EXPECT_EQ("str", str.get<std::string>());
+  EXPECT_EQ(true, b.get<bool>());
+  EXPECT_EQ(2.5, d.get<double>());
+  EXPECT_EQ(clsDef, cls.get<ClsDefShrdPtr>());
+  EXPECT_THROW(d.get<std::string>(), std::bad_variant_access);
+}
+
+TEST(Value, StoresAnyDouble) {
+  // GIVEN
+  double inf = std::numeric_limits<double>::infinity();
+  double nan = std::numeric_limits<double>::quiet_NaN();
+
+  // WHEN
+  Value negZero = -0.0;
+  Value negInf = -inf;
+  Value notANumber = nan;
+
+  // THEN
+  EXPECT_TRUE(std::signbit(negZero.get<double>()));
+  EXPECT_EQ(-inf, negInf.get<double>());
+  EXPECT_TRUE(std::isnan(notANumber.get<double>()));
+}
+
+TEST(Value, OrdersLikeVariant) {
+  // Values of different types are ordered by type, then by value
+  EXPECT_LT(Value(), Value("a"));
+  EXPECT_LT(Value("a"), Value(false));
+  EXPECT_LT(Value(true), Value(1.0));
+  EXPECT_LT(Value("a"), Value("b"));
+  EXPECT_EQ(Value("ab"), Value("ab"));
+  EXPECT_NE(Value(1.0), Value(true));
+  EXPECT_LE(Value(), Value());
+}
+
+TEST(Value, ComparesNumbersAsDoubles) {
+  // Numbers take the fast path, but compare as they did through the variant
+  Value nan = std::numeric_limits<double>::quiet_NaN();
+  EXPECT_FALSE(nan == nan);
+  EXPECT_TRUE(nan != nan);
+  EXPECT_FALSE(nan < Value(1.0));
+  EXPECT_FALSE(nan >= Value(1.0));
+  EXPECT_EQ(Value(0.0), Value(-0.0));
+  EXPECT_LE(Value(1.0), Value(1.0));
+  EXPECT_GT(Value(2.0), Value(1.0));
+
+  // A number and another type are still ordered by type
+  EXPECT_GT(Value(1.0), Value("a"));
+  EXPECT_GE(Value(1.0), Value(true));
+  EXPECT_NE(Value(0.0), Value());
+}
+
+TEST(Value, JoinsStringsWhenRead) {
+  // GIVEN
+  std::string line(40, 'a');
+  Value joined = "";
+  std::string expected;
+
+  // WHEN
+  for (int i = 0; i < 100; i++) {
+    std::string piece = line + std::to_string(i);
+    joined = concat(concat(joined, piece), "");
+    expected += piece;
+  }
+  Value prefix = joined;
+  joined = concat(joined, "!");
+
+  // THEN
+  EXPECT_EQ(expected + "!", joined.get<std::string>());
+  EXPECT_EQ(expected, prefix.get<std::string>());
+  EXPECT_EQ(Value(expected), prefix);
+  EXPECT_EQ("ab", concat("a", "b").get<std::string>());
+}
+
+TEST(Value, SharesStringsBetweenCopies) {
+  // GIVEN
+  Value str = std::string(1024, 'a');
+
+  // WHEN
+  Value copy = str;
+
+  // THEN
+  EXPECT_EQ(&str.asString(), &copy.asString());
+  EXPECT_EQ(&str.get<std::string>(), &copy.get<std::string>());
+}
+
+TEST(Value, ComparesStringsBySizeAndHash) {
+  // GIVEN
+  Value a = "abcdefgh";
+  Value b = concat(Value(std::string(32, 'x')), Value(std::string(40, 'y')));
+  Value c = std::string(32, 'x') + std::string(40, 'y');
+  Value d = std::string(32, 'x') + std::string(40, 'z');
+
+  // WHEN/THEN
+  EXPECT_EQ(a, a);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(b, c);
+  EXPECT_NE(c, d);
+  EXPECT_NE(c, Value(1.0));
+  EXPECT_EQ(b.asString().hash(), c.asString().hash());
+  EXPECT_EQ(std::hash<std::string>{}(d.get<std::string>()),
+            d.asString().hash());
+}
+
+TEST(Value, FreesLongChainsOfJoins) {
+  // GIVEN
+  Value joined = std::string(100, 'a');
+  for (int i = 0; i < 1000000; i++) {
+    joined = concat(joined, "b");
+  }
+
+  // WHEN/THEN freeing the chain doesn't recurse through every join
+  joined = Value();
+}
+
+TEST(Value, ReleasesObjects) {
+  // GIVEN
+  auto inst = makeRef<ClassInstance>("A", Environment::create());
+  std::weak_ptr<Environment> env = inst->getClosure();
+
+  // WHEN
+  {
+    Value v = inst;
+    Value copy = v;
+    inst = ClsInstShrdPtr();
+    EXPECT_FALSE(env.expired());
+  }
+
+  // THEN
+  EXPECT_TRUE(env.expired());
+}
+
+TEST(Value, VisitsHeldType) {
+  // GIVEN
+  ValuePrinter printer;
+
+  // WHEN/THEN
+  EXPECT_EQ("NULL", visit(printer, Value()));
+  EXPECT_EQ("str", visit(printer, Value("str")));
+  EXPECT_EQ("1", visit(printer, Value(true)));
+  EXPECT_EQ("class A",
+            visit(printer, Value(makeRef<ClassDefinition>(
+                               "A", nullptr, ClsDefShrdPtr()))));
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,162 @@
+#include <vm.h>
+
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+#include <parse_code.h>
+
+using ::testing::HasSubstr;
+
+namespace plox {
+namespace treewalk {
+namespace test {
+
+namespace {
+std::string runCode(const std::string &code, vm::VM &vm,
+                    std::vector<InterpretException> &errs) {
+  auto stmts = testutil::resolveCode(code);
+  ::testing::internal::CaptureStdout();
+  vm::interpret(stmts, vm, errs);
+  return ::testing::internal::GetCapturedStdout();
+}
+} // namespace
+
+TEST(VM, Arithmetic) {
+  // Given
+  std::string code = "var a = (5/1+2)*--8; print a; print -a + 1;";
+  vm::VM vm;
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, vm, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("56\n-55\n", out);
+}
+
+TEST(VM, ClosuresCaptureVariables) {
+  // Given
+  std::string code = R"(
+    fun makeCounter() {
+      var i = 0;
+      fun count() { i = i + 1; return i; }
+      return count;
+    }
+    var c1 = makeCounter();
+    var c2 = makeCounter();
+    print c1(); print c1(); print c2();
+  )";
+  vm::VM vm;
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, vm, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("1\n2\n1\n", out);
+}
+
+TEST(VM, GlobalsPersistBetweenRuns) {
+  // Given
+  vm::VM vm;
+  std::vector<InterpretException> errs;
+  runCode("var a = 1; fun inc() { a = a + 1; }", vm, errs);
+
+  // When
+  auto out = runCode("inc(); print a;", vm, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("2\n", out);
+}
+
+TEST(VM, FunctionOnlySeesEarlierGlobals) {
+  // Given
+  std::string code = R"(
+    fun f() { print b; }
+    var b = 2;
+    f();
+  )";
+  vm::VM vm;
+  std::vector<InterpretException> errs;
+
+  // When
+  runCode(code, vm, errs);
+
+  // Then
+  ASSERT_EQ(1, errs.size());
+  EXPECT_THAT(errs[0].what(), HasSubstr("Unknown variable: b"));
+}
+
+TEST(VM, GarbageIsCollected) {
+  // Given
+  std::string code = R"(
+    class Node { init(next) { this.next = next; } }
+    var i = 0;
+    while (i < 50000) {
+      var n = Node(Node(nul));
+      i = i + 1;
+    };
+    print i;
+  )";
+  vm::VM vm;
+  std::vector<InterpretException> errs;
+
+  // When
+  auto out = runCode(code, vm, errs);
+
+  // Then
+  ASSERT_EQ(0, errs.size());
+  EXPECT_EQ("50000\n", out);
+  EXPECT_LT(0, vm.getNumCollections());
+}
+
+TEST(VM, DeepExpressionsOverflowTheStack) {
+  // Given
+  // Each call leaves hundreds of operands on the stack, so the stack fills up
+  // long before there are too many frames
+  std::string nested;
+  for (int i = 0; i < 300; i++) {
+    nested += "1 + (";
+  }
+  nested += "f(n - 1)" + std::string(300, ')');
+  std::string code =
+      "fun f(n) { if (n == 0) return 0;; return " + nested + "; } f(4000);";
+  vm::VM vm(1024 * 1024);
+  std::vector<InterpretException> errs;
+
+  // When
+  runCode(code, vm, errs);
+  auto out = runCode("print 1 + 2;", vm, errs);
+
+  // Then
+  ASSERT_EQ(1, errs.size());
+  EXPECT_THAT(errs[0].what(), HasSubstr("Stack overflow"));
+  EXPECT_EQ("3\n", out);
+}
+
+TEST(VM, RecursionDepthFollowsTheBudget) {
+  // Given
+  std::string code = "fun f(n) { if (n == 0) return 0;; return 1 + f(n - 1); }"
+                     "print f(50000);";
+  vm::VM small(1024 * 1024);
+  vm::VM large;
+  std::vector<InterpretException> smallErrs;
+  std::vector<InterpretException> largeErrs;
+
+  // When
+  runCode(code, small, smallErrs);
+  auto out = runCode(code, large, largeErrs);
+
+  // Then
+  ASSERT_EQ(1, smallErrs.size());
+  EXPECT_THAT(smallErrs[0].what(), HasSubstr("Stack overflow"));
+  ASSERT_EQ(0, largeErrs.size());
+  EXPECT_EQ("50000\n", out);
+}
+
+} // namespace test
+} // namespace treewalk
+} // namespace plox
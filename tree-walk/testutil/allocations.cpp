@@ -0,0 +1,32 @@
+#include <allocations.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace plox {
+namespace treewalk {
+namespace testutil {
+
+namespace {
+// The benchmarks and tests count allocations on one thread
+long s_numAllocations = 0;
+} // namespace
+
+long numAllocations() { return s_numAllocations; }
+
+} // namespace testutil
+} // namespace treewalk
+} // namespace plox
+
+// The other forms of new and delete forward to these
+void *operator new(std::size_t size) {
+  ++plox::treewalk::testutil::s_numAllocations;
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,16 @@
+#ifndef TREEWALK_TESTUTIL_ALLOCATIONS_H
+#define TREEWALK_TESTUTIL_ALLOCATIONS_H
+
+namespace plox {
+namespace treewalk {
+namespace testutil {
+
+// The number of calls to the global operator new since the program started.
+// Linking this in replaces operator new to count them.
+long numAllocations();
+
+} // namespace testutil
+} // namespace treewalk
+} // namespace plox
+
+#endif
@@ -0,0 +1,34 @@
+#include <parse_code.h>
+
+#include <gtest/gtest.h>
+
+#include <errs.h>
+#include <parser.h>
+#include <resolver.h>
+#include <scanner.h>
+
+namespace plox {
+namespace treewalk {
+namespace testutil {
+
+std::vector<stmt::Stmt> parseCode(const std::string &code) {
+  std::vector<SyntaxException> syntErrs;
+  auto tokens = scanTokens(code, syntErrs);
+  std::vector<ParseException> parsErrs;
+  auto stmts = parse(tokens, parsErrs);
+  EXPECT_EQ(0, syntErrs.size());
+  EXPECT_EQ(0, parsErrs.size());
+  return stmts;
+}
+
+std::vector<stmt::Stmt> resolveCode(const std::string &code) {
+  auto stmts = parseCode(code);
+  std::vector<ResolveException> resolveErrs;
+  resolve(stmts, resolveErrs);
+  EXPECT_EQ(0, resolveErrs.size());
+  return stmts;
+}
+
+} // namespace testutil
+} // namespace treewalk
+} // namespace plox
@@ -0,0 +1,25 @@
+#ifndef TREEWALK_TESTUTIL_PARSE_CODE_H
+#define TREEWALK_TESTUTIL_PARSE_CODE_H
+
+#include <stmt.h>
+
+#include <string>
+#include <vector>
+
+namespace plox {
+namespace treewalk {
+namespace testutil {
+
+// Scans and parses the code, failing the test on any errors. For testing the
+// passes that run before the resolver.
+std::vector<stmt::Stmt> parseCode(const std::string &code);
+
+// Scans, parses and resolves the code, failing the test on any errors. The
+// statements are ready to run on any engine.
+std::vector<stmt::Stmt> resolveCode(const std::string &code);
+
+} // namespace testutil
+} // namespace treewalk
+} // namespace plox
+
+#endif
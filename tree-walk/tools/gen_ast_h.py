@@ -107,28 +107,28 @@ class NamespaceGuard:
 
 if __name__ == "__main__":
     # fmt: off
-    define_ast("tree-walk/src/ast.h", "AST", "Expr", ["plox", "treewalk", "ast"], ["memory", "string", "variant", "scanner.h"], [
-        {"name": "Assign", "members": [{"type": "std::string_view", "name": "name"}, {"type": "std::unique_ptr<Expr>", "name": "value"}]},
+    define_ast("tree-walk/src/ast.h", "AST", "Expr", ["plox", "treewalk", "ast"], ["location.h", "memory", "optional", "string", "variant", "scanner.h", "shape.h", "symbol.h", "value.h"], [
+        {"name": "Assign", "members": [{"type": "Symbol", "name": "name"}, {"type": "std::unique_ptr<Expr>", "name": "value"}, {"type": "std::optional<VarLocation>", "name": "loc"}, {"type": "GlobalCache", "name": "cache"}]},
         {"name": "Binary", "members": [{"type": "std::unique_ptr<Expr>", "name": "left"}, {"type": "Token", "name": "op"}, {"type": "std::unique_ptr<Expr>", "name": "right"}]},
-        {"name": "Call", "members": [{"type": "std::unique_ptr<Expr>", "name": "callee"}, {"type": "std::vector<std::unique_ptr<Expr>>", "name": "args"}]},
-        {"name": "Get", "members": [{"type": "std::unique_ptr<Expr>", "name": "object"}, {"type": "std::string_view", "name": "property"}]},
+        {"name": "Call", "members": [{"type": "std::unique_ptr<Expr>", "name": "callee"}, {"type": "std::vector<std::unique_ptr<Expr>>", "name": "args"}, {"type": "int", "name": "line"}]},
+        {"name": "Get", "members": [{"type": "std::unique_ptr<Expr>", "name": "object"}, {"type": "Symbol", "name": "property"}, {"type": "PropertyCache", "name": "cache"}]},
         {"name": "Grouping", "members": [{"type": "std::unique_ptr<Expr>", "name": "expr"}]},
-        {"name": "Literal", "members": [{"type": "std::string_view", "name": "value"}, {"type": "TokenType", "name": "type"}]},
-        {"name": "Set", "members": [{"type": "std::unique_ptr<Expr>", "name": "object"}, {"type": "std::string_view", "name": "property"}, {"type": "std::unique_ptr<Expr>", "name": "value"}]},
+        {"name": "Literal", "members": [{"type": "std::string_view", "name": "value"}, {"type": "TokenType", "name": "type"}, {"type": "std::optional<Value>", "name": "constant"}]},
+        {"name": "Set", "members": [{"type": "std::unique_ptr<Expr>", "name": "object"}, {"type": "Symbol", "name": "property"}, {"type": "std::unique_ptr<Expr>", "name": "value"}, {"type": "PropertyCache", "name": "cache"}]},
         {"name": "Unary", "members": [{"type": "Token", "name": "op"}, {"type": "std::unique_ptr<Expr>", "name": "right"}]},
-        {"name": "Variable", "members": [{"type": "std::string_view", "name": "name"}]}
+        {"name": "Variable", "members": [{"type": "Symbol", "name": "name"}, {"type": "std::optional<VarLocation>", "name": "loc"}, {"type": "GlobalCache", "name": "cache"}]}
     ])
 
     define_ast("tree-walk/src/stmt.h", "STMT", "Stmt", ["plox", "treewalk", "stmt"], ["ast.h", "memory", "optional", "variant"], [
-        {"name": "Block", "members": [{"type": "std::vector<std::unique_ptr<stmt::Stmt>>", "name": "stmts"}]},
-        {"name": "Class", "members": [{"type": "std::string_view", "name": "name"}, {"type": "std::optional<std::string_view>", "name": "super"}, {"type": "std::vector<std::unique_ptr<stmt::Stmt>>", "name": "methods"}]},
+        {"name": "Block", "members": [{"type": "std::vector<std::unique_ptr<stmt::Stmt>>", "name": "stmts"}, {"type": "std::optional<int>", "name": "numSlots"}]},
+        {"name": "Class", "members": [{"type": "Symbol", "name": "name"}, {"type": "std::optional<Symbol>", "name": "super"}, {"type": "std::vector<std::unique_ptr<stmt::Stmt>>", "name": "methods"}, {"type": "std::optional<int>", "name": "slot"}, {"type": "std::optional<VarLocation>", "name": "superLoc"}]},
         {"name": "Expression", "members": [{"type": "std::unique_ptr<ast::Expr>", "name": "expr"}]},
         {"name": "For", "members": [{"type": "std::unique_ptr<stmt::Stmt>", "name": "initialiser"}, {"type": "std::unique_ptr<ast::Expr>", "name": "condition"}, {"type": "std::unique_ptr<ast::Expr>", "name": "incrementer"}, {"type": "std::unique_ptr<stmt::Stmt>", "name": "body"}]},
-        {"name": "Fun", "members": [{"type": "std::string_view", "name": "name"}, {"type": "std::vector<std::string_view>", "name": "params"}, {"type": "std::vector<std::unique_ptr<stmt::Stmt>>", "name": "stmts"}, {"type": "bool", "name": "isMethod"}]},
+        {"name": "Fun", "members": [{"type": "Symbol", "name": "name"}, {"type": "std::vector<Symbol>", "name": "params"}, {"type": "std::vector<std::unique_ptr<stmt::Stmt>>", "name": "stmts"}, {"type": "bool", "name": "isMethod"}, {"type": "std::optional<int>", "name": "slot"}, {"type": "std::optional<int>", "name": "numSlots"}, {"type": "std::vector<VarLocation>", "name": "upvalues"}, {"type": "std::shared_ptr<const Function>", "name": "function"}]},
         {"name": "If", "members": [{"type": "std::unique_ptr<ast::Expr>", "name": "condition"}, {"type": "std::unique_ptr<stmt::Stmt>", "name": "ifBranch"}, {"type": "std::unique_ptr<stmt::Stmt>", "name": "elseBranch"}]},
         {"name": "Print", "members": [{"type": "std::unique_ptr<ast::Expr>", "name": "expr"}]},
         {"name": "Return", "members": [{"type": "std::unique_ptr<ast::Expr>", "name": "expr"}]},
-        {"name": "VarDecl", "members": [{"type": "std::string_view", "name": "name"}, {"type": "std::unique_ptr<ast::Expr>", "name": "expr"}]},
+        {"name": "VarDecl", "members": [{"type": "Symbol", "name": "name"}, {"type": "std::unique_ptr<ast::Expr>", "name": "expr"}, {"type": "std::optional<int>", "name": "slot"}]},
         {"name": "While", "members": [{"type": "std::unique_ptr<ast::Expr>", "name": "condition"}, {"type": "std::unique_ptr<stmt::Stmt>", "name": "body"}]},
     ])
     # fmt: on